@@ -0,0 +1,165 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "AllocationTracker.h"
+#include <cstdlib>
+#include <cerrno>
+#include <new>
+
+/*
+Allocation hooks feeding AllocationTracker. On glibc every malloc() goes through
+here, which also covers operator new and the C code in the md5 parsers. Elsewhere,
+only the global operator new and delete are replaced. While recording is disabled
+the calls are passed straight on, without looking up the size of any block.
+*/
+
+#if defined(__GLIBC__)
+
+#include <malloc.h>
+
+extern "C"
+{
+
+void *__libc_malloc( size_t size );
+void *__libc_calloc( size_t count, size_t size );
+void *__libc_realloc( void *ptr, size_t size );
+void *__libc_memalign( size_t alignment, size_t size );
+void __libc_free( void *ptr );
+
+void *malloc( size_t size )
+{
+	void *ptr = __libc_malloc( size );
+	if ( ptr && AllocationTracker::isEnabled() )
+		AllocationTracker::recordAllocation( malloc_usable_size( ptr ) );
+	return ptr;
+}
+
+void *calloc( size_t count, size_t size )
+{
+	void *ptr = __libc_calloc( count, size );
+	if ( ptr && AllocationTracker::isEnabled() )
+		AllocationTracker::recordAllocation( malloc_usable_size( ptr ) );
+	return ptr;
+}
+
+void *realloc( void *ptr, size_t size )
+{
+	if ( !AllocationTracker::isEnabled() )
+		return __libc_realloc( ptr, size );
+
+	size_t oldSize = ptr ? malloc_usable_size( ptr ) : 0;
+	void *newPtr = __libc_realloc( ptr, size );
+	if ( newPtr )
+	{
+		AllocationTracker::recordFree( oldSize );
+		AllocationTracker::recordAllocation( malloc_usable_size( newPtr ) );
+	}
+	else if ( size == 0 )
+	{
+		AllocationTracker::recordFree( oldSize );
+	}
+	return newPtr;
+}
+
+void *memalign( size_t alignment, size_t size )
+{
+	void *ptr = __libc_memalign( alignment, size );
+	if ( ptr && AllocationTracker::isEnabled() )
+		AllocationTracker::recordAllocation( malloc_usable_size( ptr ) );
+	return ptr;
+}
+
+void *aligned_alloc( size_t alignment, size_t size )
+{
+	return memalign( alignment, size );
+}
+
+int posix_memalign( void **result, size_t alignment, size_t size )
+{
+	if ( alignment % sizeof( void* ) != 0 || (alignment & (alignment - 1)) != 0 )
+		return EINVAL;
+
+	void *ptr = memalign( alignment, size );
+	if ( !ptr )
+		return ENOMEM;
+
+	*result = ptr;
+	return 0;
+}
+
+void free( void *ptr )
+{
+	if ( ptr && AllocationTracker::isEnabled() )
+		AllocationTracker::recordFree( malloc_usable_size( ptr ) );
+	__libc_free( ptr );
+}
+
+}
+
+#else
+
+// Every block starts with a header holding its size, padded to keep the block aligned
+static const size_t HEADER_SIZE = 16;
+
+static void *trackedNew( size_t size )
+{
+	char *block = (char*)malloc( size + HEADER_SIZE );
+	if ( !block )
+		throw std::bad_alloc();
+
+	*(size_t*)block = size;
+	if ( AllocationTracker::isEnabled() )
+		AllocationTracker::recordAllocation( size );
+	return block + HEADER_SIZE;
+}
+
+static void trackedDelete( void *ptr )
+{
+	if ( !ptr )
+		return;
+
+	char *block = (char*)ptr - HEADER_SIZE;
+	if ( AllocationTracker::isEnabled() )
+		AllocationTracker::recordFree( *(size_t*)block );
+	free( block );
+}
+
+void *operator new( size_t size ) { return trackedNew( size ); }
+void *operator new[]( size_t size ) { return trackedNew( size ); }
+void operator delete( void *ptr ) throw() { trackedDelete( ptr ); }
+void operator delete[]( void *ptr ) throw() { trackedDelete( ptr ); }
+
+void *operator new( size_t size, const std::nothrow_t & ) throw()
+{
+	try { return trackedNew( size ); } catch ( ... ) { return NULL; }
+}
+
+void *operator new[]( size_t size, const std::nothrow_t & ) throw()
+{
+	try { return trackedNew( size ); } catch ( ... ) { return NULL; }
+}
+
+void operator delete( void *ptr, const std::nothrow_t & ) throw() { trackedDelete( ptr ); }
+void operator delete[]( void *ptr, const std::nothrow_t & ) throw() { trackedDelete( ptr ); }
+
+#endif
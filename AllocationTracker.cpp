@@ -0,0 +1,138 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "AllocationTracker.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+// Constant initialised, as these get used from inside malloc, possibly before main()
+std::atomic<bool> AllocationTracker::sEnabled( false );
+static std::atomic<long long> sAllocations( 0 );
+static std::atomic<long long> sBytesAllocated( 0 );
+static std::atomic<long long> sCurrentBytes( 0 );
+static std::atomic<long long> sPeakBytes( 0 );
+static std::atomic<bool> sHooked( false );
+
+static void raisePeak( long long bytes )
+{
+	long long peak = sPeakBytes.load( std::memory_order_relaxed );
+	while ( bytes > peak && !sPeakBytes.compare_exchange_weak( peak, bytes, std::memory_order_relaxed ) )
+		;
+}
+
+void AllocationTracker::recordAllocation( size_t size )
+{
+	sAllocations.fetch_add( 1, std::memory_order_relaxed );
+	sBytesAllocated.fetch_add( size, std::memory_order_relaxed );
+	raisePeak( sCurrentBytes.fetch_add( size, std::memory_order_relaxed ) + size );
+	sHooked.store( true, std::memory_order_relaxed );
+}
+
+void AllocationTracker::recordFree( size_t size )
+{
+	sCurrentBytes.fetch_sub( size, std::memory_order_relaxed );
+}
+
+AllocationTracker::Stats AllocationTracker::getStats()
+{
+	Stats stats;
+	stats.allocations = sAllocations.load( std::memory_order_relaxed );
+	stats.bytesAllocated = sBytesAllocated.load( std::memory_order_relaxed );
+	stats.currentBytes = sCurrentBytes.load( std::memory_order_relaxed );
+	stats.peakBytes = sPeakBytes.load( std::memory_order_relaxed );
+	return stats;
+}
+
+bool AllocationTracker::isHooked()
+{
+	return sHooked.load( std::memory_order_relaxed );
+}
+
+long long AllocationTracker::resetPeak()
+{
+	return sPeakBytes.exchange( sCurrentBytes.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+}
+
+void AllocationTracker::restorePeak( long long peakBytes )
+{
+	raisePeak( peakBytes );
+}
+
+long long AllocationTracker::getPeakRSS()
+{
+#if defined(__linux__)
+	// Read with plain system calls, so reading doesn't show up in the allocation counts
+	int fd = open( "/proc/self/status", O_RDONLY );
+	if ( fd < 0 )
+		return 0;
+
+	char buffer[4096];
+	ssize_t length = read( fd, buffer, sizeof( buffer ) - 1 );
+	close( fd );
+	if ( length <= 0 )
+		return 0;
+	buffer[length] = '\0';
+
+	const char *line = strstr( buffer, "VmHWM:" );
+	long long kilobytes = 0;
+	if ( !line || sscanf( line + 6, "%lld", &kilobytes ) != 1 )
+		return 0;
+
+	return kilobytes * 1024;
+#elif defined(_WIN32)
+	return 0;
+#else
+	struct rusage usage;
+	if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+		return 0;
+
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return (long long)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+void AllocationTracker::resetPeakRSS()
+{
+#if defined(__linux__)
+	// Supported since Linux 4.0; on older kernels the peak simply covers the whole process
+	int fd = open( "/proc/self/clear_refs", O_WRONLY );
+	if ( fd < 0 )
+		return;
+
+	if ( write( fd, "5", 1 ) < 0 )
+	{
+		// Nothing to be done about it
+	}
+	close( fd );
+#endif
+}
@@ -0,0 +1,79 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __ALLOCATIONTRACKER_H__
+#define __ALLOCATIONTRACKER_H__
+
+#include <cstddef>
+#include <atomic>
+
+/**
+Counts the heap allocations of the whole process. The counters only move when the
+allocation hooks from 'AllocationHooks.cpp' are linked into the program, which is the
+case for the QuakeToOgre tool, and recording has been enabled (with --memory). Until
+then the hooks pass every call straight on. Applications embedding the library can
+link the same file, or call recordAllocation() and recordFree() from their own allocator.
+
+Because the counts cover every thread, memory allocated by helper threads (like the
+tangents computed on the worker pool) is counted, and memory freed by another thread
+than the one that allocated it (like output files written by a BackgroundOutputSink)
+is balanced out. Anything else running at the same time is counted as well, such as
+the previous mesh's files being written, so only one conversion should be measured
+at a time.
+*/
+class AllocationTracker
+{
+public:
+	struct Stats
+	{
+		long long allocations;
+		long long bytesAllocated;
+		long long currentBytes;		// still in use
+		long long peakBytes;		// highest value of currentBytes
+	};
+
+	// Recording is off by default, so the hooks cost next to nothing unless memory is profiled
+	static void setEnabled( bool enable ) { sEnabled.store( enable, std::memory_order_relaxed ); }
+	static bool isEnabled() { return sEnabled.load( std::memory_order_relaxed ); }
+
+	static void recordAllocation( size_t size );
+	static void recordFree( size_t size );
+
+	static Stats getStats();
+	static bool isHooked();
+
+	// Starts looking for a new peak from the current usage, and returns the previous peak
+	static long long resetPeak();
+
+	// Puts back a peak returned by resetPeak(), unless a higher one has been reached since
+	static void restorePeak( long long peakBytes );
+
+	// Peak resident set size of the whole process in bytes, or 0 if not available
+	static long long getPeakRSS();
+	static void resetPeakRSS();
+
+private:
+	static std::atomic<bool> sEnabled;
+};
+
+#endif	// __ALLOCATIONTRACKER_H__
@@ -23,6 +23,7 @@ THE SOFTWARE.
 */
 #include "Common.h"
 #include "Animation.h"
+#include "Storage.h"
 
 #define PM_ANIMATION_COUNT	25
 
@@ -37,22 +38,49 @@ static const char *pmAnimationNames[PM_ANIMATION_COUNT] =
 static const int pmTorsoStart = 6;
 static const int pmLegsStart = 13;
 
+void getAnimationFrames( const AnimationMap &animations, set<int> &frames )
+{
+	for ( AnimationMap::const_iterator iter = animations.begin(); iter != animations.end(); ++iter )
+	{
+		const AnimationInfo &anim = iter->second;
+		for ( int i = 0; i < anim.numFrames; i++ )
+			frames.insert( anim.startFrame + i );
+	}
+}
+
 bool AnimationFile::load( const string &filename )
 {
-	FILE *f = fopen( filename.c_str(), "r" );
-	if ( !f )
+	FileInputSource source;
+	string data;
+	if ( !source.read( filename, data ) )
 		return false;
 
+	return load( data.data(), data.size() );
+}
+
+bool AnimationFile::load( const char *data, size_t size )
+{
 	char line[256], token[16];
 	const char *linePtr;
 	int animationIndex = 0;
 	int numBothFrames = 0, numTorsoFrames = 0;
+	size_t pos = 0;
+
+	mTooManyAnimations = false;
 
-	while ( !feof( f ) )
+	while ( pos < size )
 	{
-		linePtr = fgets( line, 256, f );
-		if ( !linePtr )
-			break;
+		// Copy the next line, the same way fgets() would
+		size_t lineLen = 0;
+		while ( pos < size && lineLen < sizeof( line ) - 1 )
+		{
+			char c = data[pos++];
+			line[lineLen++] = c;
+			if ( c == '\n' )
+				break;
+		}
+		line[lineLen] = '\0';
+		linePtr = line;
 
 		linePtr = getNextToken( linePtr, token, 16 );
 		if ( !*token )	// empty line
@@ -71,9 +99,8 @@ bool AnimationFile::load( const string &filename )
 		if ( animationIndex >= PM_ANIMATION_COUNT )
 		{
 			// With proper animation files we shouldn't get here
-			// Let's just give off a warning
-			cout << "[Warning] Too many animations in animation file, "
-				<< "the resulting animation list may not be correct." << endl;
+			// Let the caller give off a warning
+			mTooManyAnimations = true;
 			break;
 		}
 
@@ -113,7 +140,6 @@ bool AnimationFile::load( const string &filename )
 		animationIndex++;
 	}
 
-	fclose( f );
 	return true;
 }
 
@@ -38,14 +38,21 @@ public:
 
 typedef map<string, AnimationInfo> AnimationMap;
 
+// Adds every frame used by the animations to the set
+void getAnimationFrames( const AnimationMap &animations, set<int> &frames );
+
 class AnimationFile
 {
 public:
+	AnimationFile(): mTooManyAnimations(false) {}
+
 	bool load( const string &filename );
+	bool load( const char *data, size_t size );
 
 	const AnimationMap &getAnimations() const { return mAnimations; }
 	const AnimationMap &getLowerAnimations() const { return mLowerAnimations; }
 	const AnimationMap &getUpperAnimations() const { return mUpperAnimations; }
+	bool hasTooManyAnimations() const { return mTooManyAnimations; }
 
 private:
 	const char *getNextToken( const char *src, char *dest, int destLen );
@@ -53,6 +60,7 @@ private:
 	AnimationMap mAnimations;
 	AnimationMap mLowerAnimations;
 	AnimationMap mUpperAnimations;
+	bool mTooManyAnimations;
 };
 
 #endif
@@ -0,0 +1,447 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "ModelGenerator.h"
+#include "MD2Model.h"
+#include "MD3Model.h"
+#include "md5model.h"
+#include "Q2ModelToMesh.h"
+#include "MD5ModelToMesh.h"
+#include "Storage.h"
+#include "ThreadPool.h"
+#include <chrono>
+
+/**
+Microbenchmarks for the individual stages of a conversion, run on synthetic models
+so the results are comparable between machines and builds. Every benchmark runs its
+stage repeatedly for at least the requested amount of time, and reports how many
+vertices, keyframes and bytes it processed per second.
+*/
+class Benchmark
+{
+public:
+	Benchmark( const GeneratorOptions &options, double minSeconds );
+
+	void run( const string &filter );
+
+private:
+	template<typename Function>
+	void measure( const string &name, double vertices, double keyframes, double bytes, Function function );
+
+	void benchLoaders();
+	void benchMD2Builder();
+	void benchMD5Builder();
+	void benchStrings();
+
+	GeneratorOptions mOptions;
+	double mMinSeconds;
+	string mFilter;
+
+	string mMD2Data;
+	string mMD3Data;
+	string mMD5MeshData;
+	string mMD5AnimData;
+
+	MemoryInputSource mInput;
+	MemoryOutputSink mOutput;
+	ostream mNullLog;
+	ConversionContext mContext;
+	GlobalOptions mGlobals;
+};
+
+// Keeps the optimizer from throwing away results that are never used
+static volatile size_t sSink;
+
+Benchmark::Benchmark( const GeneratorOptions &options, double minSeconds ):
+	mOptions( options ), mMinSeconds( minSeconds ), mNullLog( NULL ), mContext( mInput, mOutput, mNullLog )
+{
+	ModelGenerator generator( options );
+	mOptions = generator.getOptions();
+	generator.generateMD2( mMD2Data );
+	generator.generateMD3( mMD3Data );
+	generator.generateMD5Mesh( mMD5MeshData );
+	generator.generateMD5Anim( mMD5AnimData );
+
+	mInput.add( "bench.md2", mMD2Data );
+	mInput.add( "bench.md3", mMD3Data );
+	mInput.add( "bench.md5mesh", mMD5MeshData );
+	mInput.add( "bench.md5anim", mMD5AnimData );
+}
+
+void Benchmark::run( const string &filter )
+{
+	mFilter = filter;
+
+	printf( "Synthetic models: %d vertices, %d triangles, %d frames, %d surfaces, %d joints\n\n", 
+		mOptions.numVertices, mOptions.numTriangles, mOptions.numFrames, mOptions.numSurfaces, mOptions.numJoints );
+	printf( "%-24s %10s %12s %12s %12s %10s\n", "benchmark", "iterations", "ms/iter", "vertices/s", "keyframes/s", "MB/s" );
+
+	benchLoaders();
+	benchMD2Builder();
+	benchMD5Builder();
+	benchStrings();
+}
+
+static string formatRate( double amount, double seconds, bool bytes = false )
+{
+	if ( amount <= 0.0 )
+		return "-";
+
+	char buffer[32];
+	double rate = amount / seconds;
+	if ( bytes )
+		snprintf( buffer, sizeof( buffer ), "%.1f", rate / (1024.0 * 1024.0) );
+	else if ( rate >= 1e6 )
+		snprintf( buffer, sizeof( buffer ), "%.2fM", rate / 1e6 );
+	else if ( rate >= 1e3 )
+		snprintf( buffer, sizeof( buffer ), "%.2fK", rate / 1e3 );
+	else
+		snprintf( buffer, sizeof( buffer ), "%.2f", rate );
+	return buffer;
+}
+
+template<typename Function>
+void Benchmark::measure( const string &name, double vertices, double keyframes, double bytes, Function function )
+{
+	if ( !mFilter.empty() && name.find( mFilter ) == string::npos )
+		return;
+
+	typedef std::chrono::steady_clock Clock;
+
+	// Run once up front, so first-use costs don't end up in the measurement
+	function();
+
+	int iterations = 0;
+	double elapsed = 0.0;
+	Clock::time_point start = Clock::now();
+	do
+	{
+		function();
+		iterations++;
+		elapsed = std::chrono::duration<double>( Clock::now() - start ).count();
+	} while ( elapsed < mMinSeconds );
+
+	double seconds = elapsed / iterations;
+	printf( "%-24s %10d %12.3f %12s %12s %10s\n", name.c_str(), iterations, seconds * 1000.0, 
+		formatRate( vertices, seconds ).c_str(), formatRate( keyframes, seconds ).c_str(),
+		formatRate( bytes, seconds, true ).c_str() );
+	fflush( stdout );
+}
+
+void Benchmark::benchLoaders()
+{
+	MD2Model md2;
+	md2.load( mMD2Data.data(), mMD2Data.size() );
+	measure( "MD2Model::load", (double)md2.header.numVertices * md2.header.numFrames, md2.header.numFrames, 
+		mMD2Data.size(), [&]()
+	{
+		MD2Model model;
+		sSink = model.load( mMD2Data.data(), mMD2Data.size() );
+	} );
+
+	MD3Model md3;
+	md3.load( mMD3Data.data(), mMD3Data.size() );
+	double md3Vertices = 0.0;
+	for ( int i = 0; i < md3.header.numMeshes; i++ )
+		md3Vertices += (double)md3.meshes[i].header.numVertices * md3.meshes[i].header.numFrames;
+	measure( "MD3Model::load", md3Vertices, md3.header.numFrames, mMD3Data.size(), [&]()
+	{
+		MD3Model model;
+		sSink = model.load( mMD3Data.data(), mMD3Data.size() );
+	} );
+
+	measure( "ReadMD5Model", (double)mOptions.numVertices * mOptions.numSurfaces, 0, mMD5MeshData.size(), [&]()
+	{
+		struct md5_model_t model;
+		sSink = ReadMD5ModelBuffer( mMD5MeshData.data(), mMD5MeshData.size(), &model );
+		FreeModel( &model );
+	} );
+
+	measure( "ReadMD5Anim", 0, (double)mOptions.numFrames * mOptions.numJoints, mMD5AnimData.size(), [&]()
+	{
+		struct md5_anim_t anim;
+		sSink = ReadMD5AnimBuffer( mMD5AnimData.data(), mMD5AnimData.size(), &anim );
+		FreeAnim( &anim );
+	} );
+}
+
+void Benchmark::benchMD2Builder()
+{
+	Q2ModelToMesh builder( mGlobals, mContext );
+	builder.setInputFile( "bench.md2" );
+
+	// Only animated frames are loaded, and the track below animates all of them
+	builder.getAnimation( "bench" ) = AnimationInfo( 0, mOptions.numFrames, 10 );
+	builder.setTriangleStrips( true );
+	if ( !builder.loadModel() )
+	{
+		printf( "[Error] Could not load the synthetic MD2 model\n" );
+		return;
+	}
+
+	int numFrames = builder.mModel.header.numFrames;
+	measure( "restructureVertices", builder.mModel.header.numTriangles * 3.0, 0, 0, [&]()
+	{
+		builder.mNewTriangles.clear();
+		builder.mNewVertices.clear();
+		builder.restructureVertices();
+		sSink = builder.mNewVertices.size();
+	} );
+
+	// The benchmark above may have been filtered out
+	if ( builder.mNewVertices.empty() )
+		builder.restructureVertices();
+
+	double numVertices = (double)builder.mNewVertices.size();
+	IndexList indices;
+	for ( size_t i = 0; i < builder.mNewTriangles.size(); i++ )
+		indices.insert( indices.end(), builder.mNewTriangles[i].indices, builder.mNewTriangles[i].indices + 3 );
+	measure( "optimizeVertexCache", (double)indices.size(), 0, 0, [&]()
+	{
+		IndexList optimized( indices );
+		MeshOptimizer::optimizeVertexCache( optimized, (int)numVertices );
+		sSink = optimized.size();
+	} );
+
+	PositionList positions;
+	builder.getPositions( builder.mModel.frames[0], positions );
+
+	IndexList cacheOrder( indices );
+	MeshOptimizer::optimizeVertexCache( cacheOrder, (int)numVertices );
+	measure( "optimizeOverdraw", (double)indices.size(), 0, 0, [&]()
+	{
+		IndexList optimized( cacheOrder );
+		MeshOptimizer::optimizeOverdraw( optimized, positions, 1.05f );
+		sSink = optimized.size();
+	} );
+
+	measure( "optimizeVertexFetch", (double)indices.size(), 0, 0, [&]()
+	{
+		IndexList optimized( indices );
+		IndexList vertexOrder;
+		MeshOptimizer::optimizeVertexFetch( optimized, (int)numVertices, vertexOrder );
+		sSink = vertexOrder.size();
+	} );
+
+	// Halve the triangles, judged in as many keyframes as a conversion would
+	vector<LodLevel> lodLevels( 1 );
+	lodLevels[0].distance = 100.0f;
+	lodLevels[0].reduction = 0.5f;
+	vector<PositionList> frames( min( numFrames, (int)MeshSimplifier::MAX_FRAMES ) );
+	for ( size_t i = 0; i < frames.size(); i++ )
+		builder.getPositions( builder.mModel.frames[i], frames[i] );
+	measure( "simplify", (double)indices.size(), (double)frames.size(), 0, [&]()
+	{
+		vector<IndexList> levels;
+		MeshSimplifier::simplify( indices, frames, lodLevels, levels );
+		sSink = levels[0].size();
+	} );
+
+	measure( "EdgeListBuilder", (double)indices.size(), 0, 0, [&]()
+	{
+		EdgeListBuilder edgeLists;
+		edgeLists.addSubMesh( positions, indices, vector<IndexList>() );
+		sSink = edgeLists.getNumEdges();
+	} );
+
+	// Weld on the positions of the same keyframes, as cleanup compares every converted frame
+	int stride = (int)frames.size() * 3;
+	vector<float> attributes( builder.mNewVertices.size() * stride );
+	for ( size_t i = 0; i < builder.mNewVertices.size(); i++ )
+	{
+		for ( size_t frame = 0; frame < frames.size(); frame++ )
+		{
+			const Vector3 &position = frames[frame][i];
+			attributes[i * stride + frame * 3] = position.x;
+			attributes[i * stride + frame * 3 + 1] = position.y;
+			attributes[i * stride + frame * 3 + 2] = position.z;
+		}
+	}
+	measure( "weldVertices", numVertices, (double)frames.size(), 0, [&]()
+	{
+		IndexList remap;
+		sSink = GeometryCleaner::weldVertices( attributes, stride, 0.0001f, remap );
+	} );
+
+	measure( "sortByGLCommands", (double)builder.mNewTriangles.size() * 3, 0, 0, [&]()
+	{
+		builder.sortByGLCommands();
+		sSink = builder.mNewTriangles.size();
+	} );
+
+	IndexList stripOrder;
+	for ( size_t i = 0; i < builder.mNewTriangles.size(); i++ )
+		stripOrder.insert( stripOrder.end(), builder.mNewTriangles[i].indices, builder.mNewTriangles[i].indices + 3 );
+	measure( "convertToStrip", (double)stripOrder.size(), 0, 0, [&]()
+	{
+		IndexList strip;
+		MeshOptimizer::convertToStrip( stripOrder, strip );
+		sSink = strip.size();
+	} );
+
+	// The XML output below is the usual triangle list
+	builder.setTriangleStrips( false );
+
+	AnimationInfo animInfo( 0, numFrames, 10 );
+	measure( "Q2 buildTrack", numVertices * numFrames, numFrames, 0, [&]()
+	{
+		// Cancelling the tag throws away everything built, leaving the writer empty again
+		builder.mMeshWriter.openTag( "tracks" );
+		builder.buildTrack( animInfo );
+		builder.mMeshWriter.cancelTag();
+	} );
+
+	builder.mAnimations["bench"] = animInfo;
+	builder.convert();
+
+	string xml = builder.mMeshWriter;
+	measure( "XmlWriter serialise", numVertices * (numFrames + 1), numFrames, xml.size(), [&]()
+	{
+		string output = builder.mMeshWriter;
+		sSink = output.size();
+	} );
+}
+
+void Benchmark::benchMD5Builder()
+{
+	MD5ModelToMesh builder( mGlobals, mContext );
+
+	struct md5_model_t model;
+	if ( !ReadMD5ModelBuffer( mMD5MeshData.data(), mMD5MeshData.size(), &model ) )
+	{
+		printf( "[Error] Could not load the synthetic md5mesh\n" );
+		return;
+	}
+
+	struct md5_anim_t anim;
+	if ( !ReadMD5AnimBuffer( mMD5AnimData.data(), mMD5AnimData.size(), &anim ) )
+	{
+		printf( "[Error] Could not load the synthetic md5anim\n" );
+		FreeModel( &model );
+		return;
+	}
+
+	measure( "PrepareMesh", (double)mOptions.numVertices * model.num_meshes, 0, 0, [&]()
+	{
+		for ( int i = 0; i < model.num_meshes; i++ )
+			PrepareMesh( &model.meshes[i], model.baseSkel );
+	} );
+
+	vector<Vector3> normals( mOptions.numVertices );
+	measure( "generateNormals", (double)mOptions.numVertices * model.num_meshes, 0, 0, [&]()
+	{
+		for ( int i = 0; i < model.num_meshes; i++ )
+			MD5ModelToMesh::generateNormals( &model.meshes[i], &normals[0] );
+	} );
+
+	vector<struct md5_mesh_t*> meshes;
+	for ( int i = 0; i < model.num_meshes; i++ )
+		meshes.push_back( &model.meshes[i] );
+	ThreadPool workers;
+	measure( "generateTangents", (double)mOptions.numVertices * model.num_meshes, 0, 0, [&]()
+	{
+		vector<TangentList> tangents( meshes.size() );
+		MD5ModelToMesh::generateTangents( meshes, tangents, &workers );
+		sSink = tangents[0].size();
+	} );
+
+	// Downsampling only, as that is what resampling is normally used for
+	int fps = anim.frameRate * 2 / 3;
+	measure( "resampleAnimation", 0, (double)(anim.num_frames * fps / anim.frameRate) * anim.num_joints, 0, [&]()
+	{
+		struct md5_anim_t resampled;
+		MD5ModelToMesh::resampleAnimation( &anim, &resampled, fps );
+		FreeAnim( &resampled );
+	} );
+
+	MD5ModelToMesh::AnimationInfo animInfo;
+	measure( "MD5 buildTrack", 0, (double)anim.num_frames * anim.num_joints, 0, [&]()
+	{
+		builder.mSkelWriter.openTag( "tracks" );
+		for ( int i = 0; i < anim.num_joints; i++ )
+			builder.buildTrack( &model, &anim, i, animInfo );
+		builder.mSkelWriter.cancelTag();
+	} );
+
+	FreeAnim( &anim );
+	FreeModel( &model );
+}
+
+void Benchmark::benchStrings()
+{
+	vector<float> values( 3 * mOptions.numVertices );
+	for ( size_t i = 0; i < values.size(); i++ )
+		values[i] = sinf( (float)i ) * 100.0f;
+
+	size_t bytes = 0;
+	for ( size_t i = 0; i < values.size(); i++ )
+		bytes += StringUtil::toString( values[i] ).size();
+
+	measure( "StringUtil::toString", mOptions.numVertices, 0, bytes, [&]()
+	{
+		size_t total = 0;
+		for ( size_t i = 0; i < values.size(); i++ )
+			total += StringUtil::toString( values[i] ).size();
+		sSink = total;
+	} );
+}
+
+static void printUsage()
+{
+	cout << "Usage:" << endl;
+	cout << "QuakeToOgreBench [-s scale] [-t seconds] [-r seed] [benchmark name filter]" << endl;
+}
+
+int main( int argc, char **argv )
+{
+	GeneratorOptions options;
+	double minSeconds = 0.5;
+	int scale = 1;
+	string filter;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( !strcmp( argv[i], "-s" ) && i + 1 < argc )
+			scale = atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-t" ) && i + 1 < argc )
+			minSeconds = atof( argv[++i] );
+		else if ( !strcmp( argv[i], "-r" ) && i + 1 < argc )
+			options.seed = (unsigned int)strtoul( argv[++i], NULL, 10 );
+		else if ( argv[i][0] == '-' )
+		{
+			printUsage();
+			return 1;
+		}
+		else
+			filter = argv[i];
+	}
+
+	scale = MAX( scale, 1 );
+	options.numVertices *= scale;
+	options.numTriangles *= scale;
+
+	Benchmark benchmark( options, minSeconds );
+	benchmark.run( filter );
+	return 0;
+}
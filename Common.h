@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include <sstream>
 #include <map>
 #include <vector>
+#include <set>
 #include <algorithm>
 #include <locale>
 
@@ -48,16 +49,39 @@ THE SOFTWARE.
 #define MIN(x,y) ((x)<(y)?(x):(y))
 #endif
 
+#ifndef MAX
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#endif
+
 using namespace std;
 
 #include "StringUtil.h"
 
+struct LodLevel
+{
+	float distance;		// From the camera, where the level takes over
+	float reduction;	// Fraction of the triangles removed
+
+	bool operator<( const LodLevel &other ) const { return distance < other.distance; }
+};
+
 struct GlobalOptions
 {
 	GlobalOptions();
 
 	bool convertCoords;
 	bool writeMaterials;
+	bool optimizeVertexCache;
+	bool optimizeVertexFetch;
+	bool optimizeOverdraw;
+	bool generateTangents;
+	bool buildEdgeLists;
+	bool cleanupGeometry;
+	bool mergeSubMeshes;
+	bool sharedGeometry;		// All submeshes use one vertex buffer
+	float overdrawThreshold;	// ACMR the overdraw optimisation may cost, relative to cache order
+	float weldTolerance;		// Largest difference between the attributes of vertices that are welded
+	vector<LodLevel> lodLevels;	// Automatically generated levels of detail, nearest first
 };
 
 #endif
@@ -0,0 +1,66 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "ConversionContext.h"
+#include "XmlWriter.h"
+#include "ConversionStats.h"
+
+bool ConversionContext::readInput( const string &name, string &data )
+{
+	if ( !input.read( name, data ) )
+		return false;
+
+	if ( stats )
+		stats->addInput( data.size() );
+	return true;
+}
+
+BlockReader ConversionContext::getInputReader( const string &name )
+{
+	BlockReader reader = input.getBlockReader( name );
+	return [this, reader]( size_t offset, size_t length, void *dest )
+	{
+		if ( !reader( offset, length, dest ) )
+			return false;
+
+		if ( stats )
+			stats->addInput( length );
+		return true;
+	};
+}
+
+bool ConversionContext::writeXml( const string &name, const XmlWriter &writer )
+{
+	string data;
+	{
+		ProfileScope scope( profiler, "serialise" );
+		data = writer;
+	}
+
+	if ( stats )
+		stats->addOutput( data.size() );
+
+	ProfileScope scope( profiler, "write" );
+	return output.write( name, data );
+}
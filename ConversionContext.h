@@ -0,0 +1,77 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __CONVERSIONCONTEXT_H__
+#define __CONVERSIONCONTEXT_H__
+
+#include "Storage.h"
+#include "Profiler.h"
+#include "LogBuffer.h"
+
+class ParsedInputCache;
+class ConversionStats;
+class XmlWriter;
+class ThreadPool;
+
+/**
+Everything a converter needs to talk to the outside world. Builders never open files
+or write to the console themselves; they go through the context instead, so the same
+conversion code can run from the command line or embedded in another application.
+*/
+struct ConversionContext
+{
+	ConversionContext( InputSource &input, OutputSink &output, ostream &log ):
+		input( input ), output( output ), log( log ), logLevel( LOG_INFO ), 
+		parseCache( NULL ), profiler( NULL ), stats( NULL ), workers( NULL ) {}
+
+	InputSource &input;
+	OutputSink &output;
+	ostream &log;
+
+	// Builders check this before writing debug messages; the log itself drops info messages when quiet
+	LogLevel logLevel;
+
+	// Reads an input file, counting its size in the statistics
+	bool readInput( const string &name, string &data );
+
+	// Reads blocks of an input file, counting the bytes read in the statistics
+	BlockReader getInputReader( const string &name );
+
+	// Serialises an XML document and hands it to the output
+	bool writeXml( const string &name, const XmlWriter &writer );
+
+	// Optional, lets parsed input files be shared between conversions
+	ParsedInputCache *parseCache;
+
+	// Optional, records how long each phase of the conversion takes
+	Profiler *profiler;
+
+	// Optional, counts the size and throughput of each converted asset
+	ConversionStats *stats;
+
+	// Optional, shared by every conversion that runs parts of its work (like the tangents of
+	// each submesh) in parallel; without it those parts run one after another
+	ThreadPool *workers;
+};
+
+#endif	// __CONVERSIONCONTEXT_H__
@@ -0,0 +1,154 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "ConversionStats.h"
+#include "Profiler.h"
+
+long long ConversionStats::Asset::getKeyframes() const
+{
+	long long keyframes = 0;
+	for ( size_t i = 0; i < animations.size(); i++ )
+		keyframes += animations[i].keyframes;
+	return keyframes;
+}
+
+ConversionStats::ConversionStats():
+	mAssetOpen( false ), mAssetStart( 0.0 )
+{
+}
+
+void ConversionStats::beginAsset( const string &name )
+{
+	Asset asset;
+	asset.name = name;
+	asset.success = false;
+	asset.wallTime = 0.0;
+	asset.inputBytes = asset.outputBytes = 0;
+	asset.sourceVertices = asset.sourceTriangles = 0;
+	asset.vertices = asset.triangles = 0;
+	asset.boneAssignments = 0;
+	mAssets.push_back( asset );
+
+	mAssetOpen = true;
+	mAssetStart = Profiler::getWallTime();
+}
+
+void ConversionStats::endAsset( bool success )
+{
+	if ( !mAssetOpen )
+		return;
+
+	Asset &asset = mAssets.back();
+	asset.success = success;
+	asset.wallTime = Profiler::getWallTime() - mAssetStart;
+	mAssetOpen = false;
+}
+
+void ConversionStats::addInput( size_t bytes )
+{
+	if ( mAssetOpen )
+		mAssets.back().inputBytes += bytes;
+}
+
+void ConversionStats::addOutput( size_t bytes )
+{
+	if ( mAssetOpen )
+		mAssets.back().outputBytes += bytes;
+}
+
+void ConversionStats::addSourceGeometry( int vertices, int triangles )
+{
+	if ( mAssetOpen )
+	{
+		mAssets.back().sourceVertices += vertices;
+		mAssets.back().sourceTriangles += triangles;
+	}
+}
+
+void ConversionStats::addGeometry( int vertices, int triangles )
+{
+	if ( mAssetOpen )
+	{
+		mAssets.back().vertices += vertices;
+		mAssets.back().triangles += triangles;
+	}
+}
+
+void ConversionStats::addBoneAssignments( int count )
+{
+	if ( mAssetOpen )
+		mAssets.back().boneAssignments += count;
+}
+
+void ConversionStats::addAnimation( const string &name, int tracks, long long keyframes )
+{
+	if ( !mAssetOpen )
+		return;
+
+	Animation animation;
+	animation.name = name;
+	animation.tracks = tracks;
+	animation.keyframes = keyframes;
+	mAssets.back().animations.push_back( animation );
+}
+
+static double getRate( double amount, double seconds )
+{
+	return seconds > 0.0 ? amount / seconds : 0.0;
+}
+
+void ConversionStats::writeJSON( ostream &os ) const
+{
+	char line[512];
+
+	os << "{\n  \"assets\": [";
+	for ( size_t i = 0; i < mAssets.size(); i++ )
+	{
+		const Asset &asset = mAssets[i];
+		long long keyframes = asset.getKeyframes();
+
+		os << (i > 0 ? "," : "") << "\n    {\"name\": " << StringUtil::toJSON( asset.name ) 
+			<< ", \"success\": " << (asset.success ? "true" : "false");
+
+		snprintf( line, sizeof( line ), ", \"wall_ms\": %.3f, \"input_bytes\": %lld, \"output_bytes\": %lld,"
+			"\n     \"source_vertices\": %lld, \"source_triangles\": %lld, \"vertices\": %lld, \"triangles\": %lld,"
+			"\n     \"bone_assignments\": %lld, \"keyframes\": %lld,"
+			"\n     \"vertices_per_second\": %.1f, \"keyframes_per_second\": %.1f, \"output_mb_per_second\": %.3f,",
+			asset.wallTime * 1000.0, asset.inputBytes, asset.outputBytes, 
+			asset.sourceVertices, asset.sourceTriangles, asset.vertices, asset.triangles,
+			asset.boneAssignments, keyframes, 
+			getRate( (double)asset.vertices, asset.wallTime ), getRate( (double)keyframes, asset.wallTime ),
+			getRate( asset.outputBytes / (1024.0 * 1024.0), asset.wallTime ) );
+		os << line;
+
+		os << "\n     \"animations\": [";
+		for ( size_t j = 0; j < asset.animations.size(); j++ )
+		{
+			const Animation &animation = asset.animations[j];
+			os << (j > 0 ? "," : "") << "\n       {\"name\": " << StringUtil::toJSON( animation.name ) 
+				<< ", \"tracks\": " << animation.tracks << ", \"keyframes\": " << animation.keyframes << "}";
+		}
+		os << (asset.animations.empty() ? "" : "\n     ") << "]}";
+	}
+	os << (mAssets.empty() ? "" : "\n  ") << "]\n}\n";
+}
@@ -0,0 +1,87 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __CONVERSIONSTATS_H__
+#define __CONVERSIONSTATS_H__
+
+#include "Common.h"
+
+/**
+Counts what went into and came out of each converted asset: file sizes, geometry
+before and after the builders restructure it, keyframes per animation and bone
+assignments. Together with the time each asset took, this gives the throughput of
+a conversion, in a form a build dashboard can track over time. Like a Profiler,
+a ConversionStats belongs to a single conversion, and the builders only report to
+it if one is set.
+*/
+class ConversionStats
+{
+public:
+	struct Animation
+	{
+		string name;
+		int tracks;
+		long long keyframes;	// summed over all tracks
+	};
+
+	struct Asset
+	{
+		string name;
+		bool success;
+		double wallTime;	// in seconds
+		long long inputBytes;
+		long long outputBytes;
+		long long sourceVertices;	// as stored in the input file
+		long long sourceTriangles;
+		long long vertices;			// as written to the mesh
+		long long triangles;
+		long long boneAssignments;
+		vector<Animation> animations;
+
+		long long getKeyframes() const;
+	};
+
+	ConversionStats();
+
+	void beginAsset( const string &name );
+	void endAsset( bool success );
+
+	// These add to the asset that is currently being converted, if any
+	void addInput( size_t bytes );
+	void addOutput( size_t bytes );
+	void addSourceGeometry( int vertices, int triangles );
+	void addGeometry( int vertices, int triangles );
+	void addBoneAssignments( int count );
+	void addAnimation( const string &name, int tracks, long long keyframes );
+
+	const vector<Asset> &getAssets() const { return mAssets; }
+
+	void writeJSON( ostream &os ) const;
+
+private:
+	bool mAssetOpen;
+	double mAssetStart;
+	vector<Asset> mAssets;
+};
+
+#endif	// __CONVERSIONSTATS_H__
@@ -0,0 +1,627 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "Converter.h"
+#include "Q2ModelToMesh.h"
+#include "Q3ModelToMesh.h"
+#include "MD5ModelToMesh.h"
+#include "ConversionStats.h"
+
+GlobalOptions::GlobalOptions():
+	convertCoords( true ), writeMaterials( false ), optimizeVertexCache( false ), optimizeVertexFetch( false ),
+	optimizeOverdraw( false ), generateTangents( false ), buildEdgeLists( false ), cleanupGeometry( false ), 
+	mergeSubMeshes( false ), sharedGeometry( false ), overdrawThreshold( 1.05f ), weldTolerance( 0.0001f )
+{
+}
+
+Converter::Converter( InputSource &input, OutputSink &output, ostream *log ):
+	mLogBuffer( log ), mLogStream( &mLogBuffer ), mContext( input, output, mLogStream ), mLog( mContext.log )
+{
+}
+
+void Converter::setLogLevel( LogLevel level )
+{
+	mLogBuffer.setLevel( level );
+	mContext.logLevel = level;
+}
+
+bool Converter::convert( const string &config )
+{
+	TiXmlDocument doc;
+	{
+		ProfileJob job( mContext.profiler, "configuration" );
+		ProfileScope scope( mContext.profiler, "config parse" );
+		doc.Parse( config.c_str() );
+	}
+
+	if ( doc.Error() )
+	{
+		mLog << "[Error] Could not parse configuration, reason:" 
+			<< endl << "Error " << doc.ErrorId() << " on row " << doc.ErrorRow() 
+			<< " column " << doc.ErrorCol() << ":" << endl << doc.ErrorDesc() << endl;
+		mLogBuffer.flushPending();
+		return false;
+	}
+
+	return convert( doc.RootElement() );
+}
+
+bool Converter::convert( TiXmlElement *root )
+{
+	if ( !root || root->ValueStr() != "quake2ogre" )
+	{
+		mLog << "[Error] This is not a valid QuakeToOgre configuration file" << endl;
+		mLogBuffer.flushPending();
+		return false;
+	}
+	
+	mOptions.convertCoords = root->FirstChildElement( "convertcoordinates" ) ? true : false;
+	mOptions.optimizeVertexCache = root->FirstChildElement( "optimizevertexcache" ) ? true : false;
+	mOptions.optimizeVertexFetch = root->FirstChildElement( "optimizevertexfetch" ) ? true : false;
+	mOptions.generateTangents = root->FirstChildElement( "generatetangents" ) ? true : false;
+	mOptions.buildEdgeLists = root->FirstChildElement( "buildedgelists" ) ? true : false;
+	mOptions.mergeSubMeshes = root->FirstChildElement( "mergesubmeshes" ) ? true : false;
+	mOptions.sharedGeometry = root->FirstChildElement( "sharedgeometry" ) ? true : false;
+
+	TiXmlElement *overdrawNode = root->FirstChildElement( "optimizeoverdraw" );
+	mOptions.optimizeOverdraw = overdrawNode ? true : false;
+	double threshold = GlobalOptions().overdrawThreshold;
+	if ( overdrawNode )
+		overdrawNode->Attribute( "threshold", &threshold );
+	mOptions.overdrawThreshold = (float)threshold;
+
+	TiXmlElement *cleanupNode = root->FirstChildElement( "cleanupgeometry" );
+	mOptions.cleanupGeometry = cleanupNode ? true : false;
+	double tolerance = GlobalOptions().weldTolerance;
+	if ( cleanupNode )
+		cleanupNode->Attribute( "tolerance", &tolerance );
+	mOptions.weldTolerance = (float)tolerance;
+
+	mOptions.lodLevels.clear();
+	if ( TiXmlElement *lodNode = root->FirstChildElement( "generatelod" ) )
+	{
+		for ( TiXmlElement *levelNode = lodNode->FirstChildElement( "lodlevel" ); levelNode; levelNode = levelNode->NextSiblingElement( "lodlevel" ) )
+		{
+			double distance, reduction;
+			if ( !levelNode->Attribute( "distance", &distance ) || !levelNode->Attribute( "reduction", &reduction ) ||
+				distance <= 0 || reduction <= 0 || reduction >= 1 )
+			{
+				mLog << "[Warning] Skipping LOD level, it needs a positive distance and a reduction between 0 and 1" << endl;
+				continue;
+			}
+
+			LodLevel level;
+			level.distance = (float)distance;
+			level.reduction = (float)reduction;
+			mOptions.lodLevels.push_back( level );
+		}
+		sort( mOptions.lodLevels.begin(), mOptions.lodLevels.end() );
+	}
+
+	bool success = false;
+
+	TiXmlElement *node = root->FirstChildElement();
+	if ( node )
+		prefetchInputs( node );
+	
+	for ( ; node; node = node->NextSiblingElement() )
+	{			
+		// Have the input source read the next mesh's files while this one is converted
+		if ( TiXmlElement *next = node->NextSiblingElement() )
+			prefetchInputs( next );
+
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "md2mesh" )
+		{
+			success = convertMD2Mesh( node );
+		}
+		else if ( nodeName == "md3mesh" )
+		{
+			success = convertMD3Mesh( node );
+		}
+		else if ( nodeName == "md5mesh" )
+		{
+			success = convertMD5Mesh( node );
+		}
+
+		mLogBuffer.flushPending();
+	}
+
+	// Outputs may still be on their way to disk
+	if ( !mContext.output.flush() )
+	{
+		mLog << "[Error] Could not write all output files" << endl;
+		success = false;
+	}
+	
+	if ( success )
+	{
+		mLog << "Conversion succeeded!" << endl;
+		mLogBuffer.flushPending();
+		return true;
+	}
+	else
+	{
+		mLog << "Conversion failed..." << endl;
+		mLogBuffer.flushPending();
+		return false;
+	}
+}
+
+void Converter::prefetchInputs( TiXmlElement *node )
+{
+	for ( TiXmlElement *child = node->FirstChildElement(); child; child = child->NextSiblingElement() )
+	{
+		if ( child->ValueStr() == "inputfile" )
+		{
+			// MD2 and MD3 models are read in ranges, reading them whole ahead of time would defeat that
+			if ( node->ValueStr() == "md2mesh" || node->ValueStr() == "md3mesh" )
+				continue;
+
+			if ( const char *name = child->GetText() )
+				mContext.input.prefetch( name );
+		}
+		else
+		{
+			prefetchInputs( child );
+		}
+	}
+}
+
+bool Converter::processAnimationFile( TiXmlElement *animFileNode, Q3ModelToMesh &builder )
+{
+	mLog << "Processing animation file" << endl;
+
+	TiXmlElement *filenameNode = animFileNode->FirstChildElement( "inputfile" );
+	if ( !filenameNode )
+	{
+		mLog << "[Warning] Animation file declaration misses input filename" << endl;
+		return false;
+	}
+
+	AnimationFile animFile;
+	string animFilename = filenameNode->GetText();
+	string animData;
+	if ( !mContext.readInput( animFilename, animData ) || !animFile.load( animData.data(), animData.size() ) )
+	{
+		mLog << "[Warning] Could not load animation file '" << animFilename << "'" << endl;
+		return false;
+	}
+
+	if ( animFile.hasTooManyAnimations() )
+	{
+		mLog << "[Warning] Too many animations in animation file, "
+			<< "the resulting animation list may not be correct." << endl;
+	}
+
+	for ( TiXmlElement *node = animFileNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "convertlegs" )
+		{
+			mLog << "Converting all legs animations from animation file" << endl;
+			const AnimationMap &animMap = animFile.getLowerAnimations();
+			for ( AnimationMap::const_iterator i = animMap.begin(); i != animMap.end(); ++i )
+			{
+				builder.getAnimation( i->first ) = i->second;
+			}
+			break;
+		}
+		else if ( nodeName == "converttorso" )
+		{
+			mLog << "Converting all torso animations from animation file" << endl;
+			const AnimationMap &animMap = animFile.getUpperAnimations();
+			for ( AnimationMap::const_iterator i = animMap.begin(); i != animMap.end(); ++i )
+			{
+				builder.getAnimation( i->first ) = i->second;
+			}
+			break;
+		}
+		else if ( nodeName == "convertselection" )
+		{
+			mLog << "Converting a selection of animations from animation file" << endl;
+			const AnimationMap &animMap = animFile.getAnimations();
+			for ( TiXmlElement *child = node->FirstChildElement(); child; child = child->NextSiblingElement() )
+			{
+				const string &childName = child->ValueStr();
+				if ( childName == "animationname" )
+				{
+					string animName = child->GetText();
+					AnimationMap::const_iterator i = animMap.find( animName );
+					if ( i != animMap.end() )
+					{
+						mLog << "Adding animation '" << animName << "'" << endl;
+						builder.getAnimation( i->first ) = i->second;
+					}
+					else
+					{
+						mLog << "[Warning] Cannot find animation '" << animName << "'" << endl;
+					}
+				}
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool Converter::processAnimations( TiXmlElement *animsNode, AnimationMap &dest )
+{
+	mLog << "Processing manual animation definitions" << endl;
+
+	for ( TiXmlElement *node = animsNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "animationsequence" )
+		{
+			TiXmlElement *animNameNode = node->FirstChildElement( "animationname" );
+			TiXmlElement *startFrameNode = node->FirstChildElement( "startframe" );
+			TiXmlElement *numFramesNode = node->FirstChildElement( "numframes" );
+			TiXmlElement *fpsNode = node->FirstChildElement( "fps" );
+			if ( !animNameNode || !startFrameNode || !numFramesNode || !fpsNode )
+			{
+				mLog << "[Warning] Invalid animation sequence" << endl;
+				continue;
+			}
+			
+			AnimationInfo anim;
+			string animName = animNameNode->GetText();
+			anim.startFrame = atoi( startFrameNode->GetText() );
+			anim.numFrames = atoi( numFramesNode->GetText() );
+			anim.framesPerSecond = atoi( fpsNode->GetText() );
+			
+			mLog << "Adding animation '" << animName << "'" << endl;
+			dest[animName] = anim;
+		}
+	}
+
+	return true;
+}
+
+bool Converter::processMaterials( TiXmlElement *matsNode, Q3ModelToMesh &builder )
+{
+	mLog << "Processing materials" << endl;
+	
+	for ( TiXmlElement *node = matsNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "material" )
+		{
+			string key, value;
+		
+			for ( TiXmlElement *child = node->FirstChildElement(); 
+				child; child = child->NextSiblingElement() )
+			{
+				const string &childName = child->ValueStr();
+				if ( childName == "submeshname" )
+				{
+					key = child->GetText();
+				}
+				else if ( childName == "materialname" )
+				{
+					value = child->GetText();
+				}
+			}
+			
+			if ( key.empty() )
+			{
+				mLog << "[Warning] Material found without submesh name" << endl;
+				continue;
+			}
+			
+			mLog << "Using material '" << value << "' for submesh '" << key << "'" << endl;
+			builder.setSubMeshMaterial( key, value );
+		}
+	}
+	
+	return true;
+}
+
+// Names a conversion job after the mesh's input file
+static string getJobName( TiXmlElement *configNode )
+{
+	TiXmlElement *inputNode = configNode->FirstChildElement( "inputfile" );
+	if ( !inputNode || !inputNode->GetText() )
+		return configNode->ValueStr();
+
+	return configNode->ValueStr() + " '" + inputNode->GetText() + "'";
+}
+
+bool Converter::convertMD2Mesh( TiXmlElement *configNode )
+{
+	mLog << "Doing MD2 Mesh conversion" << endl;
+	string jobName = getJobName( configNode );
+	ProfileJob job( mContext.profiler, jobName );
+	if ( mContext.stats )
+		mContext.stats->beginAsset( jobName );
+
+	Q2ModelToMesh builder( mOptions, mContext );
+
+	// Process the configuration XML tree
+	for ( TiXmlElement *node = configNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "inputfile" )
+		{
+			builder.setInputFile( node->GetText() );
+		}
+		else if ( nodeName == "outputfile" )
+		{
+			builder.setOutputFile( node->GetText() );
+		}
+		else if ( nodeName == "referenceframe" )
+		{
+			builder.setReferenceFrame( atoi(node->GetText()) );
+		}
+		else if ( nodeName == "animations" )
+		{
+			if ( node->FirstChildElement( "includenormals" ) )
+				builder.setIncludeNormals( true );
+
+			AnimationMap anims;
+			processAnimations( node, anims );
+			for ( AnimationMap::const_iterator iter = anims.begin(); iter != anims.end(); ++iter )
+			{
+				builder.getAnimation( iter->first ) = iter->second;
+			}
+		}
+		else if ( nodeName == "materialname" )
+		{
+			builder.setMaterial( node->GetText() );
+		}
+		else if ( nodeName == "trianglestrips" )
+		{
+			builder.setTriangleStrips( true );
+		}
+	}
+	
+	bool success = builder.build();
+	if ( mContext.stats )
+		mContext.stats->endAsset( success );
+
+	if ( !success )
+	{
+		mLog << "[Error] Failed to convert MD2 file" << endl;
+		return false;
+	}
+	
+	return true;
+}
+
+bool Converter::convertMD3Mesh( TiXmlElement *configNode )
+{
+	mLog << "Doing MD3 Mesh conversion" << endl;
+	string jobName = getJobName( configNode );
+	ProfileJob job( mContext.profiler, jobName );
+	if ( mContext.stats )
+		mContext.stats->beginAsset( jobName );
+	
+	Q3ModelToMesh builder( mOptions, mContext );
+	
+	// Process the configuration XML tree
+	for ( TiXmlElement *node = configNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "inputfile" )
+		{
+			builder.setInputFile( node->GetText() );
+		}
+		else if ( nodeName == "outputfile" )
+		{
+			builder.setOutputFile( node->GetText() );
+		}
+		else if ( nodeName == "referenceframe" )
+		{
+			builder.setReferenceFrame( atoi( node->GetText() ) );
+		}
+		else if ( nodeName == "animationfile" )
+		{
+			if ( node->FirstChildElement( "includenormals" ) )
+				builder.setIncludeNormals( true );
+
+			if ( !processAnimationFile( node, builder ) )
+				mLog << "[Warning] Failed to process animation file" << endl;
+		}
+		else if ( nodeName == "animations" )
+		{
+			if ( node->FirstChildElement( "includenormals" ) )
+				builder.setIncludeNormals( true );
+
+			AnimationMap anims;
+			processAnimations( node, anims );
+			for ( AnimationMap::const_iterator iter = anims.begin(); iter != anims.end(); ++iter )
+			{
+				builder.getAnimation( iter->first ) = iter->second;
+			}
+		}
+		else if ( nodeName == "materials" )
+		{
+			processMaterials( node, builder );
+		}
+	}
+	
+	bool success = builder.build();
+	if ( mContext.stats )
+		mContext.stats->endAsset( success );
+
+	if ( !success )
+	{
+		mLog << "[Error] Failed to convert MD3 file" << endl;
+		return false;
+	}
+	
+	return true;
+}
+
+void Converter::processSubMesh( TiXmlElement *subMeshNode, MD5ModelToMesh &builder )
+{
+	int index = -1;
+	if ( !subMeshNode->Attribute( "index", &index ) )
+	{
+		mLog << "[Warning] Submesh with no index" << endl;
+		return;
+	}
+
+	MD5ModelToMesh::SubMeshInfo &smInfo = builder.getSubMesh( index );
+
+	const char *name;
+	if ( (name = subMeshNode->Attribute( "name" )) )
+	{
+		smInfo.name = name;
+	}
+
+	for ( TiXmlElement *node = subMeshNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "materialname" )
+		{
+			smInfo.material = node->GetText();
+		}
+	}
+}
+
+void Converter::processSubMeshes( TiXmlElement *subMeshesNode, MD5ModelToMesh &builder )
+{
+	int maxWeights;
+	if ( subMeshesNode->Attribute( "maxweights", &maxWeights ) )
+		builder.setMaxWeights( maxWeights );
+
+	for ( TiXmlElement *node = subMeshesNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "submesh" )
+		{
+			processSubMesh( node, builder );
+		}
+	}
+}
+
+void Converter::processMD5Animation( TiXmlElement *animNode, MD5ModelToMesh &builder )
+{
+	const char *name;
+	if ( !(name = animNode->Attribute( "name" )) )
+	{
+		mLog << "[Warning] MD5 Animation without a name" << endl;
+		return;
+	}
+
+	string inputfile;
+	bool lockRoot = false;
+	for ( TiXmlElement *node = animNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "inputfile" )
+		{
+			inputfile = node->GetText();
+		}
+		else if ( nodeName == "lockroot" )
+		{
+			lockRoot = true;
+		}
+	}
+
+	if ( inputfile.empty() )
+	{
+		mLog << "[Warning] MD5 Animation '" << (*name) << "' missing input file" << endl;
+		return;
+	}
+
+	MD5ModelToMesh::AnimationInfo &anim = builder.getAnimation( name );
+	anim.inputFile = inputfile;
+	anim.lockRoot = lockRoot;
+	
+	int fps;
+	if ( animNode->Attribute( "changefps", &fps ) )
+		anim.fps = fps;
+}
+
+void Converter::processMD5Skeleton( TiXmlElement *skelNode, MD5ModelToMesh &builder )
+{
+	const char *name;
+	if ( !(name = skelNode->Attribute( "name" )) )
+	{
+		mLog << "[Warning] MD5 Skeleton without a name" << endl;
+		return;
+	}
+	builder.setSkeletonName( name );
+
+	const char *originBone;
+	if ( (originBone = skelNode->Attribute( "moveorigin" )) )
+		builder.setOriginBone( originBone );
+
+	for ( TiXmlElement *node = skelNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "md5anim" )
+		{
+			processMD5Animation( node, builder );
+		}
+	}
+}
+
+bool Converter::convertMD5Mesh( TiXmlElement *configNode )
+{
+	mLog << "Doing MD5 Mesh conversion" << endl;
+	string jobName = getJobName( configNode );
+	ProfileJob job( mContext.profiler, jobName );
+	if ( mContext.stats )
+		mContext.stats->beginAsset( jobName );
+	
+	MD5ModelToMesh builder( mOptions, mContext );
+
+	// Process the configuration XML tree
+	for ( TiXmlElement *node = configNode->FirstChildElement(); node; node = node->NextSiblingElement() )
+	{
+		const string &nodeName = node->ValueStr();
+		if ( nodeName == "inputfile" )
+		{
+			builder.setInputFile( node->GetText() );
+		}
+		else if ( nodeName == "outputfile" )
+		{
+			builder.setOutputFile( node->GetText() );
+		}
+		else if ( nodeName == "submeshes" )
+		{
+			processSubMeshes( node, builder );
+		}
+		else if ( nodeName == "md5skeleton" )
+		{
+			processMD5Skeleton( node, builder );
+		}
+	}
+	
+	bool success = builder.build();
+	if ( mContext.stats )
+		mContext.stats->endAsset( success );
+
+	if ( !success )
+	{
+		mLog << "[Error] Failed to convert MD5 file" << endl;
+		return false;
+	}
+	
+	return true;
+}
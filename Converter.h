@@ -0,0 +1,91 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __CONVERTER_H__
+#define __CONVERTER_H__
+
+#include "ConversionContext.h"
+#include "Animation.h"
+
+class Q3ModelToMesh;
+class MD5ModelToMesh;
+
+/**
+Entry point of the conversion library. A Converter takes a configuration document
+(as described by examples/config.dtd), reads the input files it refers to from an
+InputSource and hands every resulting mesh and skeleton XML file to an OutputSink.
+Nothing is read from or written to disk unless the source and sink do so, and
+progress messages only go to the log stream if one is supplied. Messages are
+collected, and written to the log stream after each converted mesh.
+*/
+class Converter
+{
+public:
+	Converter( InputSource &input, OutputSink &output, ostream *log = NULL );
+
+	bool convert( const string &config );
+	bool convert( TiXmlElement *root );
+
+	GlobalOptions &getOptions() { return mOptions; }
+
+	// Anything written here ends up in the log stream, at the next flush of the log buffer
+	ostream &getLog() { return mLog; }
+
+	void setLogLevel( LogLevel level );
+
+	// Shares parsed input files between conversions, may be NULL
+	void setParseCache( ParsedInputCache *cache ) { mContext.parseCache = cache; }
+
+	// Records the time spent in each phase of the conversion, may be NULL
+	void setProfiler( Profiler *profiler ) { mContext.profiler = profiler; }
+
+	// Counts the size and throughput of each converted asset, may be NULL
+	void setStats( ConversionStats *stats ) { mContext.stats = stats; }
+
+	// Runs the parallel parts of each conversion, may be NULL to run them on the calling thread
+	void setWorkers( ThreadPool *workers ) { mContext.workers = workers; }
+
+private:
+	void prefetchInputs( TiXmlElement *node );
+
+	bool processAnimationFile( TiXmlElement *animFileNode, Q3ModelToMesh &builder );
+	bool processAnimations( TiXmlElement *animsNode, AnimationMap &dest );
+	bool processMaterials( TiXmlElement *matsNode, Q3ModelToMesh &builder );
+
+	void processSubMesh( TiXmlElement *subMeshNode, MD5ModelToMesh &builder );
+	void processSubMeshes( TiXmlElement *subMeshesNode, MD5ModelToMesh &builder );
+	void processMD5Animation( TiXmlElement *animNode, MD5ModelToMesh &builder );
+	void processMD5Skeleton( TiXmlElement *skelNode, MD5ModelToMesh &builder );
+
+	bool convertMD2Mesh( TiXmlElement *configNode );
+	bool convertMD3Mesh( TiXmlElement *configNode );
+	bool convertMD5Mesh( TiXmlElement *configNode );
+
+	GlobalOptions mOptions;
+	LogBuffer mLogBuffer;
+	ostream mLogStream;
+	ConversionContext mContext;
+	ostream &mLog;
+};
+
+#endif	// __CONVERTER_H__
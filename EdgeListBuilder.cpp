@@ -0,0 +1,219 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "EdgeListBuilder.h"
+#include "XmlWriter.h"
+
+// Ogre marks the missing second triangle of a degenerate edge with ~0
+static const char *NO_TRIANGLE = "4294967295";
+
+size_t EdgeListBuilder::PositionKeyHash::operator()( const PositionKey &key ) const
+{
+	unsigned int bits[3];
+	memcpy( bits, &key.x, sizeof(bits) );
+	return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+EdgeListBuilder::EdgeListBuilder( bool sharedVertices ):
+	mSharedVertices( sharedVertices ),
+	mNumSharedVertices( 0 ),
+	mNumSubMeshes( 0 ),
+	mVertexOffset( 0 )
+{
+}
+
+void EdgeListBuilder::addSubMesh( const PositionList &positions, const IndexList &indices, const vector<IndexList> &lodFaces )
+{
+	// Give every distinct position in the submesh an index, continuing from the previous submeshes.
+	// Submeshes sharing their vertices also share the positions, so they can share edges.
+	if ( !mSharedVertices )
+		mSharedIndexMap.clear();
+	mSharedIndexMap.reserve( mSharedIndexMap.size() + positions.size() );
+
+	IndexList sharedIndices( positions.size() );
+	for ( size_t i = 0; i < positions.size(); i++ )
+	{
+		std::pair<SharedIndexMap::iterator, bool> result = 
+			mSharedIndexMap.insert( SharedIndexMap::value_type( PositionKey( positions[i] ), mNumSharedVertices ) );
+		if ( result.second )
+			mNumSharedVertices++;
+
+		sharedIndices[i] = result.first->second;
+	}
+
+	mLevels.resize( lodFaces.size() + 1 );
+	addTriangles( mLevels[0], indices, sharedIndices );
+	for ( size_t i = 0; i < lodFaces.size(); i++ )
+		addTriangles( mLevels[i + 1], lodFaces[i], sharedIndices );
+
+	mNumSubMeshes++;
+	if ( mSharedVertices )
+		mVertexOffset += (int)positions.size();
+}
+
+void EdgeListBuilder::addTriangles( EdgeList &edgeList, const IndexList &indices, const IndexList &sharedIndices )
+{
+	// Shared vertices make a single vertex set, with a single edge group
+	if ( !mSharedVertices || edgeList.edgeGroups.empty() )
+	{
+		edgeList.edgeGroups.push_back( EdgeGroup() );
+		edgeList.openEdges.clear();
+	}
+	int vertexSet = (int)edgeList.edgeGroups.size() - 1;
+	EdgeGroup &edges = edgeList.edgeGroups.back();
+	EdgeMap &openEdges = edgeList.openEdges;
+	openEdges.reserve( openEdges.size() + indices.size() );
+
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		Triangle triangle;
+		triangle.vertexSet = vertexSet;
+		triangle.indexSet = mNumSubMeshes;
+		for ( int corner = 0; corner < 3; corner++ )
+		{
+			triangle.vertIndex[corner] = indices[i + corner] + mVertexOffset;
+			triangle.sharedVertIndex[corner] = sharedIndices[indices[i + corner]];
+		}
+
+		const int *shared = triangle.sharedVertIndex;
+		if ( shared[0] == shared[1] || shared[1] == shared[2] || shared[2] == shared[0] )
+		{
+			edgeList.numDegenerateTriangles++;
+			continue;
+		}
+
+		int triIndex = (int)edgeList.triangles.size();
+		edgeList.triangles.push_back( triangle );
+
+		for ( int corner = 0; corner < 3; corner++ )
+		{
+			int next = (corner + 1) % 3;
+			int shared0 = shared[corner], shared1 = shared[next];
+
+			// A neighbouring triangle runs along the same edge the other way
+			EdgeMap::iterator iter = openEdges.find( ((unsigned long long)shared1 << 32) | (unsigned int)shared0 );
+			if ( iter != openEdges.end() )
+			{
+				Edge &edge = edges[iter->second];
+				edge.triIndex[1] = triIndex;
+				edge.degenerate = false;
+				edgeList.numOpenEdges--;
+				openEdges.erase( iter );
+				continue;
+			}
+
+			Edge edge;
+			edge.triIndex[0] = triIndex;
+			edge.triIndex[1] = -1;
+			edge.vertIndex[0] = triangle.vertIndex[corner];
+			edge.vertIndex[1] = triangle.vertIndex[next];
+			edge.sharedVertIndex[0] = shared0;
+			edge.sharedVertIndex[1] = shared1;
+			edge.degenerate = true;
+
+			// Where another open edge already runs the same way, that one stays connectable, as in Ogre
+			openEdges.insert( EdgeMap::value_type( ((unsigned long long)shared0 << 32) | (unsigned int)shared1, (int)edges.size() ) );
+			edges.push_back( edge );
+			edgeList.numOpenEdges++;
+		}
+	}
+}
+
+void EdgeListBuilder::write( XmlWriter &writer ) const
+{
+	writer.openTag( "edgelists" );
+	for ( size_t level = 0; level < mLevels.size(); level++ )
+	{
+		const EdgeList &edgeList = mLevels[level];
+		TiXmlElement *edgeListNode = writer.openTag( "edgelist" );
+		edgeListNode->SetAttribute( "lodIndex", (int)level );
+		edgeListNode->SetAttribute( "isClosed", edgeList.numOpenEdges == 0 ? "true" : "false" );
+
+		writer.openTag( "triangles" );
+		for ( size_t i = 0; i < edgeList.triangles.size(); i++ )
+		{
+			const Triangle &triangle = edgeList.triangles[i];
+			TiXmlElement *triangleNode = writer.openTag( "triangle" );
+			triangleNode->SetAttribute( "vertexSet", triangle.vertexSet );
+			triangleNode->SetAttribute( "indexSet", triangle.indexSet );
+			triangleNode->SetAttribute( "vertIndex0", triangle.vertIndex[0] );
+			triangleNode->SetAttribute( "vertIndex1", triangle.vertIndex[1] );
+			triangleNode->SetAttribute( "vertIndex2", triangle.vertIndex[2] );
+			triangleNode->SetAttribute( "sharedVertIndex0", triangle.sharedVertIndex[0] );
+			triangleNode->SetAttribute( "sharedVertIndex1", triangle.sharedVertIndex[1] );
+			triangleNode->SetAttribute( "sharedVertIndex2", triangle.sharedVertIndex[2] );
+			writer.closeTag();
+		}
+		writer.closeTag();	// triangles
+
+		writer.openTag( "edgegroups" );
+		for ( size_t group = 0; group < edgeList.edgeGroups.size(); group++ )
+		{
+			const EdgeGroup &edges = edgeList.edgeGroups[group];
+			writer.openTag( "edgegroup" )->SetAttribute( "vertexSet", (int)group );
+			for ( size_t i = 0; i < edges.size(); i++ )
+			{
+				const Edge &edge = edges[i];
+				TiXmlElement *edgeNode = writer.openTag( "edge" );
+				edgeNode->SetAttribute( "triIndex0", edge.triIndex[0] );
+				if ( edge.degenerate )
+					edgeNode->SetAttribute( "triIndex1", NO_TRIANGLE );
+				else
+					edgeNode->SetAttribute( "triIndex1", edge.triIndex[1] );
+				edgeNode->SetAttribute( "sharedVertIndex0", edge.sharedVertIndex[0] );
+				edgeNode->SetAttribute( "sharedVertIndex1", edge.sharedVertIndex[1] );
+				edgeNode->SetAttribute( "vertIndex0", edge.vertIndex[0] );
+				edgeNode->SetAttribute( "vertIndex1", edge.vertIndex[1] );
+				edgeNode->SetAttribute( "degenerate", edge.degenerate ? "true" : "false" );
+				writer.closeTag();
+			}
+			writer.closeTag();	// edgegroup
+		}
+		writer.closeTag();	// edgegroups
+
+		writer.closeTag();	// edgelist
+	}
+	writer.closeTag();	// edgelists
+}
+
+int EdgeListBuilder::getNumEdges() const
+{
+	int numEdges = 0;
+	if ( !mLevels.empty() )
+	{
+		for ( size_t i = 0; i < mLevels[0].edgeGroups.size(); i++ )
+			numEdges += (int)mLevels[0].edgeGroups[i].size();
+	}
+	return numEdges;
+}
+
+int EdgeListBuilder::getNumOpenEdges() const
+{
+	return mLevels.empty() ? 0 : mLevels[0].numOpenEdges;
+}
+
+int EdgeListBuilder::getNumDegenerateTriangles() const
+{
+	return mLevels.empty() ? 0 : mLevels[0].numDegenerateTriangles;
+}
@@ -0,0 +1,122 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __EDGELISTBUILDER_H__
+#define __EDGELISTBUILDER_H__
+
+#include "Common.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <unordered_map>
+
+class XmlWriter;
+
+/**
+Builds the edge lists Ogre uses to extrude stencil shadow volumes, the way Ogre's own
+EdgeListBuilder does, so they don't have to be built when the mesh is loaded. Every
+submesh is a vertex set of its own with an edge group of its own, unless the submeshes
+share their vertices: then each submesh is an index set into the one shared vertex
+set, and edges connect triangles of different submeshes. Vertices at the same position
+share an index, so that edges along texture seams connect the triangles on both sides.
+Triangles whose corners share a position are left out; edges with a single triangle
+are degenerate and make the mesh open. Every level of detail gets its own edge list.
+*/
+class EdgeListBuilder
+{
+public:
+	explicit EdgeListBuilder( bool sharedVertices = false );
+
+	/**
+	Adds the triangles of the next submesh, for the full mesh and each of its levels of
+	detail. The indices refer to positions, as written to the submesh's vertices; with
+	shared vertices, these follow the vertices of the submeshes added before.
+	*/
+	void addSubMesh( const PositionList &positions, const IndexList &indices, const vector<IndexList> &lodFaces );
+
+	// Writes the edgelists element
+	void write( XmlWriter &writer ) const;
+
+	// Totals of the full-detail edge list
+	int getNumEdges() const;
+	int getNumOpenEdges() const;
+	int getNumDegenerateTriangles() const;
+
+private:
+	struct PositionKey
+	{
+		float x, y, z;
+
+		// Adding zero turns -0 into 0, so that both hash the same
+		PositionKey( const Vector3 &v ): x( v.x + 0.0f ), y( v.y + 0.0f ), z( v.z + 0.0f ) {}
+
+		bool operator==( const PositionKey &other ) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()( const PositionKey &key ) const;
+	};
+
+	typedef std::unordered_map<PositionKey, int, PositionKeyHash> SharedIndexMap;
+	typedef std::unordered_map<unsigned long long, int> EdgeMap;
+
+	struct Triangle
+	{
+		int vertexSet;
+		int indexSet;
+		int vertIndex[3];
+		int sharedVertIndex[3];
+	};
+
+	struct Edge
+	{
+		int triIndex[2];
+		int vertIndex[2];
+		int sharedVertIndex[2];
+		bool degenerate;
+	};
+	typedef vector<Edge> EdgeGroup;
+
+	struct EdgeList
+	{
+		EdgeList(): numOpenEdges( 0 ), numDegenerateTriangles( 0 ) {}
+
+		vector<Triangle> triangles;
+		vector<EdgeGroup> edgeGroups;
+		EdgeMap openEdges;	// Edges of the last group waiting for their second triangle, keyed on their shared vertex indices
+		int numOpenEdges;
+		int numDegenerateTriangles;
+	};
+
+	void addTriangles( EdgeList &edgeList, const IndexList &indices, const IndexList &sharedIndices );
+
+	bool mSharedVertices;
+	vector<EdgeList> mLevels;
+	SharedIndexMap mSharedIndexMap;
+	int mNumSharedVertices;
+	int mNumSubMeshes;
+	int mVertexOffset;	// Of the submesh being added, in the shared vertex set
+};
+
+#endif	// __EDGELISTBUILDER_H__
@@ -0,0 +1,214 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "ModelGenerator.h"
+#include "XmlWriter.h"
+#include "Storage.h"
+
+/*
+Command line front-end to ModelGenerator. Writes a synthetic model in every supported
+format, plus a configuration file that converts all of them, so scaling problems can
+be reproduced without access to large real-world models.
+*/
+
+static void writeConfig( const string &name, const GeneratorOptions &options, XmlWriter &config )
+{
+	stringstream ss;
+	ss << options.numFrames;
+	string numFrames = ss.str();
+
+	config.openTag( "quake2ogre" );
+
+	config.openTag( "md2mesh" );
+	config.openTag( "inputfile" )->LinkEndChild( new TiXmlText( name + ".md2" ) );
+	config.closeTag();
+	config.openTag( "outputfile" )->LinkEndChild( new TiXmlText( name + "_md2.mesh.xml" ) );
+	config.closeTag();
+	config.openTag( "animations" );
+	config.openTag( "animationsequence" );
+	config.openTag( "animationname" )->LinkEndChild( new TiXmlText( "all" ) );
+	config.closeTag();
+	config.openTag( "startframe" )->LinkEndChild( new TiXmlText( "0" ) );
+	config.closeTag();
+	config.openTag( "numframes" )->LinkEndChild( new TiXmlText( numFrames ) );
+	config.closeTag();
+	config.openTag( "fps" )->LinkEndChild( new TiXmlText( "10" ) );
+	config.closeTag();
+	config.closeTag();	// animationsequence
+	config.closeTag();	// animations
+	config.closeTag();	// md2mesh
+
+	config.openTag( "md3mesh" );
+	config.openTag( "inputfile" )->LinkEndChild( new TiXmlText( name + ".md3" ) );
+	config.closeTag();
+	config.openTag( "outputfile" )->LinkEndChild( new TiXmlText( name + "_md3.mesh.xml" ) );
+	config.closeTag();
+	config.openTag( "animations" );
+	config.openTag( "animationsequence" );
+	config.openTag( "animationname" )->LinkEndChild( new TiXmlText( "all" ) );
+	config.closeTag();
+	config.openTag( "startframe" )->LinkEndChild( new TiXmlText( "0" ) );
+	config.closeTag();
+	config.openTag( "numframes" )->LinkEndChild( new TiXmlText( numFrames ) );
+	config.closeTag();
+	config.openTag( "fps" )->LinkEndChild( new TiXmlText( "10" ) );
+	config.closeTag();
+	config.closeTag();	// animationsequence
+	config.closeTag();	// animations
+	config.closeTag();	// md3mesh
+
+	config.openTag( "md5mesh" );
+	config.openTag( "inputfile" )->LinkEndChild( new TiXmlText( name + ".md5mesh" ) );
+	config.closeTag();
+	config.openTag( "outputfile" )->LinkEndChild( new TiXmlText( name + "_md5.mesh.xml" ) );
+	config.closeTag();
+	config.openTag( "submeshes" );
+	for ( int i = 0; i < options.numSurfaces; i++ )
+	{
+		config.openTag( "submesh" )->SetAttribute( "index", i );
+		config.closeTag();
+	}
+	config.closeTag();	// submeshes
+	config.openTag( "md5skeleton" )->SetAttribute( "name", name );
+	config.openTag( "md5anim" )->SetAttribute( "name", "all" );
+	config.openTag( "inputfile" )->LinkEndChild( new TiXmlText( name + ".md5anim" ) );
+	config.closeTag();
+	config.closeTag();	// md5anim
+	config.closeTag();	// md5skeleton
+	config.closeTag();	// md5mesh
+
+	config.closeTag();	// quake2ogre
+}
+
+static void printUsage()
+{
+	cout << "Usage:" << endl;
+	cout << "QuakeModelGenerator [options] [output name]" << endl;
+	cout << "Options:" << endl;
+	cout << "  -v [count]  vertices per surface (default 1000)" << endl;
+	cout << "  -t [count]  triangles per surface (default 1800)" << endl;
+	cout << "  -f [count]  animation frames (default 20)" << endl;
+	cout << "  -s [count]  surfaces (default 1)" << endl;
+	cout << "  -j [count]  joints (default 32)" << endl;
+	cout << "  -w [count]  weights per vertex (default 2)" << endl;
+	cout << "  -r [seed]   random seed (default 1)" << endl;
+	cout << "  -x [scale]  multiplies the vertex and triangle counts" << endl;
+}
+
+int main( int argc, char **argv )
+{
+	GeneratorOptions options;
+	int scale = 1;
+	string name;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc )
+		{
+			int value = atoi( argv[++i] );
+			switch ( argv[i-1][1] )
+			{
+			case 'v': options.numVertices = value; break;
+			case 't': options.numTriangles = value; break;
+			case 'f': options.numFrames = value; break;
+			case 's': options.numSurfaces = value; break;
+			case 'j': options.numJoints = value; break;
+			case 'w': options.weightsPerVertex = value; break;
+			case 'r': options.seed = (unsigned int)strtoul( argv[i], NULL, 10 ); break;
+			case 'x': scale = value; break;
+			default:
+				printUsage();
+				return 1;
+			}
+		}
+		else if ( argv[i][0] != '-' && name.empty() )
+			name = argv[i];
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	if ( name.empty() )
+	{
+		printUsage();
+		return 1;
+	}
+
+	scale = MAX( scale, 1 );
+	options.numVertices *= scale;
+	options.numTriangles *= scale;
+
+	ModelGenerator generator( options );
+	if ( generator.getOptions().numVertices != options.numVertices )
+	{
+		cout << "[Warning] " << options.numTriangles << " triangles don't fit on a grid of " << options.numVertices 
+			<< " vertices, generating " << generator.getOptions().numVertices << " vertices per surface" << endl;
+	}
+
+	if ( generator.getOptions().numVertices > 32767 )
+	{
+		cout << "[Warning] MD2 models can't have more than 32767 vertices, the MD2 file will be smaller" << endl;
+	}
+
+	FileOutputSink output;
+	string data;
+	bool success = true;
+
+	cout << "Generating '" << name << ".md2'" << endl;
+	generator.generateMD2( data );
+	success = output.write( name + ".md2", data ) && success;
+
+	cout << "Generating '" << name << ".md3'" << endl;
+	generator.generateMD3( data );
+	success = output.write( name + ".md3", data ) && success;
+
+	cout << "Generating '" << name << ".md5mesh'" << endl;
+	generator.generateMD5Mesh( data );
+	success = output.write( name + ".md5mesh", data ) && success;
+
+	cout << "Generating '" << name << ".md5anim'" << endl;
+	generator.generateMD5Anim( data );
+	success = output.write( name + ".md5anim", data ) && success;
+
+	// File names in the configuration are relative to the configuration file itself
+	string baseName = name;
+	size_t slash = baseName.find_last_of( "/\\" );
+	if ( slash != string::npos )
+		baseName = baseName.substr( slash + 1 );
+
+	cout << "Writing configuration file '" << name << ".xml'" << endl;
+	XmlWriter config;
+	writeConfig( baseName, options, config );
+	success = output.write( name + ".xml", config ) && success;
+
+	if ( !success )
+	{
+		cout << "[Error] Could not write all files" << endl;
+		return 1;
+	}
+
+	return 0;
+}
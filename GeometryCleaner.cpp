@@ -0,0 +1,161 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "GeometryCleaner.h"
+
+#include <unordered_map>
+
+// Cells of the weld grid are never smaller than this, so that exact welding still hashes sensibly
+static const float MIN_CELL_SIZE = 1e-6f;
+
+struct Cell
+{
+	long long x, y, z;
+
+	bool operator==( const Cell &other ) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct CellHash
+{
+	size_t operator()( const Cell &cell ) const
+	{
+		return (size_t)(cell.x * 73856093LL ^ cell.y * 19349663LL ^ cell.z * 83492791LL);
+	}
+};
+
+int GeometryCleaner::weldVertices( const vector<float> &attributes, int stride, float tolerance, IndexList &remap )
+{
+	int numVertices = (int)(attributes.size() / stride);
+	remap.resize( numVertices );
+
+	// Vertices that may weld lie in the same or a neighbouring cell of a grid on their positions
+	typedef std::unordered_map<Cell, IndexList, CellHash> CellMap;
+	CellMap cells;
+	float cellSize = max( tolerance, MIN_CELL_SIZE );
+
+	int numWelded = 0;
+	for ( int i = 0; i < numVertices; i++ )
+	{
+		const float *vertex = &attributes[i * stride];
+		Cell cell = { (long long)floor( vertex[0] / cellSize ), (long long)floor( vertex[1] / cellSize ), 
+			(long long)floor( vertex[2] / cellSize ) };
+
+		remap[i] = i;
+		for ( int n = 0; n < 27 && remap[i] == i; n++ )
+		{
+			Cell neighbour = { cell.x + n % 3 - 1, cell.y + (n / 3) % 3 - 1, cell.z + n / 9 - 1 };
+			CellMap::const_iterator iter = cells.find( neighbour );
+			if ( iter == cells.end() )
+				continue;
+
+			const IndexList &candidates = iter->second;
+			for ( size_t j = 0; j < candidates.size(); j++ )
+			{
+				const float *other = &attributes[candidates[j] * stride];
+				int k = 0;
+				while ( k < stride && fabsf( vertex[k] - other[k] ) <= tolerance )
+					k++;
+
+				if ( k == stride )
+				{
+					remap[i] = candidates[j];
+					break;
+				}
+			}
+		}
+
+		if ( remap[i] == i )
+			cells[cell].push_back( i );
+		else
+			numWelded++;
+	}
+
+	return numWelded;
+}
+
+int GeometryCleaner::removeDegenerateTriangles( IndexList &indices, const vector<PositionList> &frames )
+{
+	size_t numIndices = 0;
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		bool degenerate = (a == b || b == c || c == a);
+		if ( !degenerate && !frames.empty() )
+		{
+			// Flat in one frame may still open up in another
+			degenerate = true;
+			for ( size_t frame = 0; frame < frames.size() && degenerate; frame++ )
+			{
+				const PositionList &positions = frames[frame];
+				Vector3 normal = (positions[b] - positions[a]).crossProduct( positions[c] - positions[a] );
+				degenerate = normal.dotProduct( normal ) == 0.0f;
+			}
+		}
+
+		if ( degenerate )
+			continue;
+
+		indices[numIndices++] = a;
+		indices[numIndices++] = b;
+		indices[numIndices++] = c;
+	}
+
+	int numRemoved = (int)(indices.size() - numIndices) / 3;
+	indices.resize( numIndices );
+	return numRemoved;
+}
+
+int GeometryCleaner::removeUnusedVertices( IndexList &indices, vector<IndexList> &otherIndices, int numVertices, IndexList &vertexOrder )
+{
+	vector<bool> used( numVertices, false );
+	for ( size_t i = 0; i < indices.size(); i++ )
+		used[indices[i]] = true;
+	for ( size_t i = 0; i < otherIndices.size(); i++ )
+	{
+		for ( size_t j = 0; j < otherIndices[i].size(); j++ )
+			used[otherIndices[i][j]] = true;
+	}
+
+	IndexList newIndices( numVertices, -1 );
+	IndexList newOrder;
+	for ( int i = 0; i < numVertices; i++ )
+	{
+		if ( !used[i] )
+			continue;
+
+		newIndices[i] = (int)newOrder.size();
+		newOrder.push_back( vertexOrder.empty() ? i : vertexOrder[i] );
+	}
+
+	for ( size_t i = 0; i < indices.size(); i++ )
+		indices[i] = newIndices[indices[i]];
+	for ( size_t i = 0; i < otherIndices.size(); i++ )
+	{
+		for ( size_t j = 0; j < otherIndices[i].size(); j++ )
+			otherIndices[i][j] = newIndices[otherIndices[i][j]];
+	}
+
+	vertexOrder.swap( newOrder );
+	return numVertices - (int)vertexOrder.size();
+}
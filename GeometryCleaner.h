@@ -0,0 +1,62 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __GEOMETRYCLEANER_H__
+#define __GEOMETRYCLEANER_H__
+
+#include "Common.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+/**
+Finds the redundant parts of a submesh's geometry: vertices that duplicate another one,
+triangles without any area and vertices that no triangle uses. The builders describe
+their vertices as rows of attribute values, so that each format can decide what makes
+two vertices the same.
+*/
+class GeometryCleaner
+{
+public:
+	/**
+	Maps every vertex onto the first vertex whose attributes all lie within tolerance of
+	its own, or onto itself if there is none. attributes holds stride values per vertex, the
+	first three of which are its position. Returns the number of vertices mapped onto others.
+	*/
+	static int weldVertices( const vector<float> &attributes, int stride, float tolerance, IndexList &remap );
+
+	/**
+	Removes the triangles that have two corners on the same vertex, or that have no area in
+	any of the frames. Returns the number of triangles removed.
+	*/
+	static int removeDegenerateTriangles( IndexList &indices, const vector<PositionList> &frames );
+
+	/**
+	Drops the vertices that no triangle uses from vertexOrder, which gives the old index of
+	every vertex as in MeshOptimizer::optimizeVertexFetch, or is empty if the vertices are in
+	their old order. indices and every index list in otherIndices are renumbered to match.
+	Returns the number of vertices dropped.
+	*/
+	static int removeUnusedVertices( IndexList &indices, vector<IndexList> &otherIndices, int numVertices, IndexList &vertexOrder );
+};
+
+#endif	// __GEOMETRYCLEANER_H__
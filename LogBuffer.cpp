@@ -0,0 +1,116 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "LogBuffer.h"
+#include "Profiler.h"
+
+// Text piling up beyond this is passed on, even if the job hasn't finished yet
+static const size_t MAX_PENDING = 65536;
+
+LogBuffer::LogBuffer( ostream *target, LogLevel level ):
+	mTarget( target ), mLevel( level )
+{
+}
+
+LogBuffer::~LogBuffer()
+{
+	if ( !mLine.empty() )
+		endLine( '\n' );
+
+	flushPending();
+}
+
+int LogBuffer::overflow( int c )
+{
+	if ( c == EOF )
+		return 0;
+
+	if ( c == '\n' || c == '\r' )
+		endLine( (char)c );
+	else
+		mLine += (char)c;
+	return c;
+}
+
+std::streamsize LogBuffer::xsputn( const char *s, std::streamsize count )
+{
+	for ( std::streamsize i = 0; i < count; i++ )
+		overflow( (unsigned char)s[i] );
+	return count;
+}
+
+void LogBuffer::endLine( char terminator )
+{
+	if ( !mTarget )
+	{
+		mLine.clear();
+		return;
+	}
+
+	if ( mLevel == LOG_QUIET && mLine.compare( 0, 7, "[Error]" ) != 0 && mLine.compare( 0, 9, "[Warning]" ) != 0 )
+	{
+		mLine.clear();
+		return;
+	}
+
+	mPending += mLine;
+	mPending += terminator;
+	mLine.clear();
+
+	// Lines ending in a carriage return are progress indicators, which are no use later on
+	if ( terminator == '\r' || mPending.size() >= MAX_PENDING )
+		flushPending();
+}
+
+void LogBuffer::flushPending()
+{
+	if ( !mTarget || mPending.empty() )
+		return;
+
+	mTarget->write( mPending.data(), mPending.size() );
+	mTarget->flush();
+	mPending.clear();
+}
+
+ProgressReporter::ProgressReporter( ostream &log, int total, double interval ):
+	mLog( log ), mTotal( total ), mInterval( interval ), mLastTime( Profiler::getWallTime() ), mLastPercentage( -1 )
+{
+}
+
+void ProgressReporter::update( int done )
+{
+	if ( mTotal <= 0 )
+		return;
+
+	int percentage = done * 100 / mTotal;
+	if ( percentage == mLastPercentage )
+		return;
+
+	double now = Profiler::getWallTime();
+	if ( done < mTotal && now - mLastTime < mInterval )
+		return;
+
+	mLog << percentage << "%\r";
+	mLastTime = now;
+	mLastPercentage = percentage;
+}
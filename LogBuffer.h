@@ -0,0 +1,89 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __LOGBUFFER_H__
+#define __LOGBUFFER_H__
+
+#include "Common.h"
+
+enum LogLevel
+{
+	LOG_QUIET,		// only warnings and errors
+	LOG_INFO,		// every step of the conversion
+	LOG_DEBUG		// every frame of every animation as well
+};
+
+/**
+Collects everything written to a conversion log, and passes it on to the target
+stream in large blocks: when a job has finished, when a lot of text has piled up,
+or when a progress indicator needs to be shown. Flushing the log stream itself
+(e.g. with endl) costs nothing. At the quiet level only lines starting with
+[Error] or [Warning] are kept. A NULL target discards everything.
+*/
+class LogBuffer : public std::streambuf
+{
+public:
+	LogBuffer( ostream *target, LogLevel level = LOG_INFO );
+	~LogBuffer();
+
+	void setLevel( LogLevel level ) { mLevel = level; }
+	LogLevel getLevel() const { return mLevel; }
+
+	// Writes all complete lines to the target stream
+	void flushPending();
+
+protected:
+	int overflow( int c );
+	std::streamsize xsputn( const char *s, std::streamsize count );
+	int sync() { return 0; }
+
+private:
+	void endLine( char terminator );
+
+	ostream *mTarget;
+	LogLevel mLevel;
+	string mLine;
+	string mPending;
+};
+
+/**
+Shows how far a long-running step has got, as a percentage on a single console line.
+Only a few updates per second are written, however often update() is called, and
+steps that finish quickly only report their completion.
+*/
+class ProgressReporter
+{
+public:
+	ProgressReporter( ostream &log, int total, double interval = 0.25 );
+
+	void update( int done );
+
+private:
+	ostream &mLog;
+	int mTotal;
+	double mInterval;	// in seconds
+	double mLastTime;
+	int mLastPercentage;
+};
+
+#endif	// __LOGBUFFER_H__
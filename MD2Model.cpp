@@ -23,9 +23,10 @@ THE SOFTWARE.
 */
 #include "Common.h"
 #include "MD2Model.h"
+#include "Storage.h"
 
 MD2Model::MD2Model():
-	skins(NULL), frames(NULL), texCoords(NULL), triangles(NULL)
+	skins(NULL), frames(NULL), texCoords(NULL), triangles(NULL), glCommands(NULL)
 {
 }
 
@@ -36,50 +37,86 @@ MD2Model::~MD2Model()
 
 bool MD2Model::load( const string &filename )
 {
-	FILE *f;
+	FileInputSource source;
+	return load( source.getBlockReader( filename ) );
+}
+
+bool MD2Model::load( const char *data, size_t size, const set<int> *frameSet, bool loadGLCommands )
+{
+	return load( MemoryInputSource::getBufferReader( data, size ), frameSet, loadGLCommands );
+}
 
-	if ( !( f = fopen( filename.c_str(), "rb" ) ) )
+bool MD2Model::load( const BlockReader &readBlock, const set<int> *frameSet, bool loadGLCommands )
+{
+	free();
+
+	if ( !readBlock( 0, sizeof( MD2Header ), &header ) )
 	{
 		return false;
 	}
 
-	fread( &header, sizeof( MD2Header ), 1, f );
 	if (	header.magic[0] != 'I' || header.magic[1] != 'D' ||
 			header.magic[2] != 'P' || header.magic[3] != '2' ||
 			header.version != 8 )
 	{
-		fclose( f );
 		return false;
 	}
 
-	skins = new MD2Skin[ header.numSkins ];
-	fseek( f, header.offsetSkins, SEEK_SET );
-	fread( skins, sizeof( MD2Skin ), header.numSkins, f );
+	if (	header.numSkins < 0 || header.numTexCoords < 0 || header.numTriangles < 0 ||
+			header.numFrames < 0 || header.numVertices < 0 || header.numGLCommands < 0 )
+	{
+		return false;
+	}
 
-	texCoords = new MD2TexCoord[ header.numTexCoords ];
-	fseek( f, header.offsetTexCoords, SEEK_SET );
-	fread( texCoords, sizeof( MD2TexCoord ), header.numTexCoords, f );
+	// The frame headers come with the vertices of their frame, whose size the first one bounds
+	size_t skinsSize, texCoordsSize, trianglesSize, glCommandsSize = 0, vertexSize, frameSize, framesSize;
+	if (	!checkBlock( readBlock, header.offsetSkins, header.numSkins, sizeof( MD2Skin ), skinsSize ) ||
+			!checkBlock( readBlock, header.offsetTexCoords, header.numTexCoords, sizeof( MD2TexCoord ), texCoordsSize ) ||
+			!checkBlock( readBlock, header.offsetTriangles, header.numTriangles, sizeof( MD2Triangle ), trianglesSize ) ||
+			(loadGLCommands && !checkBlock( readBlock, header.offsetGlCommands, header.numGLCommands, sizeof( int ), glCommandsSize )) ||
+			!checkBlock( readBlock, (long long)header.offsetFrames + sizeof( MD2FrameHeader ), header.numVertices, sizeof( MD2Vertex ), vertexSize ) ||
+			!checkBlock( readBlock, header.offsetFrames, header.numFrames, sizeof( MD2FrameHeader ) + vertexSize, framesSize ) )
+	{
+		return false;
+	}
+	frameSize = sizeof( MD2FrameHeader ) + vertexSize;
 
+	// Allocate everything up front, so free() can clean up after a truncated file
+	skins = new MD2Skin[ header.numSkins ];
+	texCoords = new MD2TexCoord[ header.numTexCoords ];
 	triangles = new MD2Triangle[ header.numTriangles ];
-	fseek( f, header.offsetTriangles, SEEK_SET );
-	fread( triangles, sizeof( MD2Triangle ), header.numTriangles, f );
-
-	frames = new MD2Frame[ header.numFrames ];
-	fseek( f, header.offsetFrames, SEEK_SET );
+	frames = new MD2Frame[ header.numFrames ]();
 	for ( int i = 0; i < header.numFrames; i++ )
+	{
+		bool needed = !frameSet || frameSet->count( i );
+		frames[i].vertices = needed ? new MD2Vertex[ header.numVertices ] : NULL;
+	}
+	if ( loadGLCommands )
+		glCommands = new int[ header.numGLCommands ];
+
+	bool success =
+		readBlock( header.offsetSkins, skinsSize, skins ) &&
+		readBlock( header.offsetTexCoords, texCoordsSize, texCoords ) &&
+		readBlock( header.offsetTriangles, trianglesSize, triangles ) &&
+		(!glCommands || readBlock( header.offsetGlCommands, glCommandsSize, glCommands ));
+
+	// Frames that aren't loaded aren't read at all
+	for ( int i = 0; success && i < header.numFrames; i++ )
 	{
 		MD2Frame &frame = frames[i];
+		if ( !frame.vertices )
+			continue;
 
-		fread( &frame.header, sizeof( MD2FrameHeader ), 1, f );
-
-		frame.vertices = new MD2Vertex[ header.numVertices ];
-		fread( frame.vertices, sizeof( MD2Vertex ), header.numVertices, f );
+		size_t offset = header.offsetFrames + i * frameSize;
+		success = readBlock( offset, sizeof( MD2FrameHeader ), &frame.header ) &&
+			readBlock( offset + sizeof( MD2FrameHeader ), vertexSize, frame.vertices );
 	}
 
-	fclose( f );
-
-	printf( "MD2Model::load() - Loaded %i skins, %i vertices, %i texture coordinates, %i triangles, %i frames\n", 
-		header.numSkins, header.numVertices, header.numTexCoords, header.numTriangles, header.numFrames );
+	if ( !success )
+	{
+		free();
+		return false;
+	}
 
 	return true;
 }
@@ -104,6 +141,12 @@ void MD2Model::free()
 		triangles = NULL;
 	}
 
+	if ( glCommands )
+	{
+		delete[] glCommands;
+		glCommands = NULL;
+	}
+
 	if ( frames )
 	{
 		for ( int i = 0; i < header.numFrames; i++ )
@@ -114,18 +157,3 @@ void MD2Model::free()
 		frames = NULL;
 	}
 }
-
-void MD2Model::printInfo() const
-{
-	cout << "MD2 file info" << endl;
-	for ( int i = 0; i < header.numSkins; i++ )
-	{
-		cout << "Skin " << i << " = " << skins[i].name << endl;
-	}
-	cout << header.numSkins << " skins total" << endl;
-	for ( int i = 0; i < header.numFrames; i++ )
-	{
-		cout << "Frame " << i << " = " << frames[i].header.name << endl;
-	}
-	cout << header.numFrames << " frames total" << endl;
-}
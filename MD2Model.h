@@ -25,6 +25,7 @@ THE SOFTWARE.
 #define __MD2MODEL_H__
 
 #include "Quake.h"
+#include "Storage.h"
 
 struct MD2Header
 {
@@ -68,7 +69,7 @@ struct MD2FrameHeader
 struct MD2Frame
 {
 	MD2FrameHeader	header;
-	MD2Vertex		*vertices;
+	MD2Vertex		*vertices;	// NULL if the frame wasn't loaded, its header is zeroed then
 };
 
 struct MD2Triangle
@@ -89,15 +90,21 @@ public:
 	~MD2Model();
 
 	bool load( const string &filename );
+
+	// Only the vertices of the given frames are loaded, or those of every frame if frames is NULL.
+	// The GL commands are only loaded when asked for.
+	bool load( const char *data, size_t size, const set<int> *frames = NULL, bool loadGLCommands = false );
+
+	// Reads the header and the model data, and then only the frames that are loaded
+	bool load( const BlockReader &readBlock, const set<int> *frames = NULL, bool loadGLCommands = false );
 	void free();
 	
-	void printInfo() const;
-	
 	MD2Header	header;
 	MD2Skin		*skins;
 	MD2Frame	*frames;
 	MD2TexCoord	*texCoords;
 	MD2Triangle	*triangles;
+	int			*glCommands;	// NULL unless loaded
 };
 
 #endif	// __MD2MODEL_H__
@@ -23,6 +23,7 @@ THE SOFTWARE.
 */
 #include "Common.h"
 #include "MD3Model.h"
+#include "Storage.h"
 
 MD3Model::MD3Model():
 	frames(NULL), tags(NULL), meshes(NULL)
@@ -36,63 +37,145 @@ MD3Model::~MD3Model()
 
 bool MD3Model::load( const string &filename )
 {
-	FILE *f;
+	FileInputSource source;
+	return load( source.getBlockReader( filename ) );
+}
+
+bool MD3Model::load( const char *data, size_t size, const set<int> *frameSet )
+{
+	return load( MemoryInputSource::getBufferReader( data, size ), frameSet );
+}
+
+bool MD3Model::load( const BlockReader &readBlock, const set<int> *frameSet )
+{
+	free();
 
-	if ( !( f = fopen( filename.c_str(), "rb" ) ) )
+	if ( !readBlock( 0, sizeof( MD3Header ), &header ) )
 	{
 		return false;
 	}
 
-	fread( &header, sizeof( MD3Header ), 1, f );
 	if (	header.magic[0] != 'I' || header.magic[1] != 'D' ||
 			header.magic[2] != 'P' || header.magic[3] != '3' ||
 			header.version != 15 )
 	{
-		fclose( f );
 		return false;
 	}
 
+	if ( header.numFrames < 0 || header.numTags < 0 || header.numMeshes < 0 )
+	{
+		return false;
+	}
+
+	// Every mesh starts with a header, which bounds the number of meshes as well
+	size_t framesSize, tagsSize, meshesSize;
+	if (	!checkBlock( readBlock, header.offsetFrames, header.numFrames, sizeof( MD3Frame ), framesSize ) ||
+			!checkBlock( readBlock, header.offsetTags, header.numTags, sizeof( MD3Tag ), tagsSize ) ||
+			!checkBlock( readBlock, header.offsetTags, header.numFrames, tagsSize, tagsSize ) ||
+			!checkBlock( readBlock, header.offsetMeshes, header.numMeshes, sizeof( MD3MeshHeader ), meshesSize ) )
+	{
+		return false;
+	}
+
+	int numLoadedFrames = 0;
+	frameSlots.assign( header.numFrames, -1 );
+	for ( int i = 0; i < header.numFrames; i++ )
+	{
+		if ( !frameSet || frameSet->count( i ) )
+			frameSlots[i] = numLoadedFrames++;
+	}
+
 	frames = new MD3Frame[ header.numFrames ];
 	tags = new MD3Tag[ header.numTags * header.numFrames ];
 	meshes = new MD3Mesh[ header.numMeshes ];
+	memset( meshes, 0, sizeof( MD3Mesh ) * header.numMeshes );
 
-	fseek( f, header.offsetFrames, SEEK_SET );
-	fread( frames, sizeof( MD3Frame ), header.numFrames, f );
+	bool success =
+		readBlock( header.offsetFrames, framesSize, frames ) &&
+		readBlock( header.offsetTags, tagsSize, tags );
 
-	fseek( f, header.offsetTags, SEEK_SET );
-	fread( tags, sizeof( MD3Tag ), header.numTags * header.numFrames, f );
-
-	int offset = header.offsetMeshes;
-	for ( int i = 0; i < header.numMeshes; i++ )
+	long long offset = header.offsetMeshes;
+	for ( int i = 0; success && i < header.numMeshes; i++ )
 	{
 		MD3Mesh &mesh = meshes[i];
 
-		fseek( f, offset, SEEK_SET );
-		fread( &mesh.header, sizeof( MD3MeshHeader ), 1, f );
+		if ( !readBlock( offset, sizeof( MD3MeshHeader ), &mesh.header ) )
+		{
+			success = false;
+			break;
+		}
+
+		if (	mesh.header.numShaders < 0 || mesh.header.numTriangles < 0 ||
+				mesh.header.numVertices < 0 || mesh.header.numFrames < 0 )
+		{
+			success = false;
+			break;
+		}
+
+		size_t shadersSize, trianglesSize, texCoordsSize, frameSize, verticesSize;
+		int numFrames = MIN( header.numFrames, mesh.header.numFrames );
+		if (	!checkBlock( readBlock, offset + mesh.header.offsetShaders, mesh.header.numShaders, sizeof( MD3Shader ), shadersSize ) ||
+				!checkBlock( readBlock, offset + mesh.header.offsetTriangles, mesh.header.numTriangles, sizeof( MD3Triangle ), trianglesSize ) ||
+				!checkBlock( readBlock, offset + mesh.header.offsetTexCoords, mesh.header.numVertices, sizeof( MD3TexCoord ), texCoordsSize ) ||
+				!checkBlock( readBlock, offset + mesh.header.offsetVertices, mesh.header.numVertices, sizeof( MD3Vertex ), frameSize ) ||
+				!checkBlock( readBlock, offset + mesh.header.offsetVertices, numFrames, frameSize, verticesSize ) )
+		{
+			success = false;
+			break;
+		}
+
+		// The loaded frames the mesh doesn't have all share one empty frame, so only frames
+		// that are in the file take up memory
+		int numSlots = 0;
+		for ( int j = 0; j < numFrames; j++ )
+		{
+			if ( frameSlots[j] >= 0 )
+				numSlots++;
+		}
+		mesh.emptyFrameSlot = numSlots;
+		if ( numSlots < numLoadedFrames )
+			numSlots++;
 
 		mesh.shaders = new MD3Shader[ mesh.header.numShaders ];
 		mesh.triangles = new MD3Triangle[ mesh.header.numTriangles ];
 		mesh.texCoords = new MD3TexCoord[ mesh.header.numVertices ];
-		mesh.vertices = new MD3Vertex[ mesh.header.numFrames * mesh.header.numVertices ];
+		mesh.vertices = new MD3Vertex[ (size_t)numSlots * mesh.header.numVertices ];
 
-		fseek( f, offset + mesh.header.offsetShaders, SEEK_SET );
-		fread( mesh.shaders, sizeof( MD3Shader ), mesh.header.numShaders, f );
+		if ( mesh.emptyFrameSlot < numSlots )
+			memset( &mesh.vertices[(size_t)mesh.emptyFrameSlot * mesh.header.numVertices], 0, frameSize );
 
-		fseek( f, offset + mesh.header.offsetTriangles, SEEK_SET );
-		fread( mesh.triangles, sizeof( MD3Triangle ), mesh.header.numTriangles, f );
+		success =
+			readBlock( offset + mesh.header.offsetShaders, shadersSize, mesh.shaders ) &&
+			readBlock( offset + mesh.header.offsetTriangles, trianglesSize, mesh.triangles ) &&
+			readBlock( offset + mesh.header.offsetTexCoords, texCoordsSize, mesh.texCoords );
 
-		fseek( f, offset + mesh.header.offsetTexCoords, SEEK_SET );
-		fread( mesh.texCoords, sizeof( MD3TexCoord ), mesh.header.numVertices, f );
-
-		fseek( f, offset + mesh.header.offsetVertices, SEEK_SET );
-		fread( mesh.vertices, sizeof( MD3Vertex ), mesh.header.numFrames * mesh.header.numVertices, f );
+		// Read consecutive loaded frames in one go, and skip the others
+		for ( int first = 0; success && first < numFrames; )
+		{
+			if ( frameSlots[first] < 0 )
+			{
+				first++;
+				continue;
+			}
+
+			int end = first + 1;
+			while ( end < numFrames && frameSlots[end] >= 0 )
+				end++;
+
+			success = readBlock( offset + mesh.header.offsetVertices + first * frameSize, (end - first) * frameSize, 
+				&mesh.vertices[(size_t)frameSlots[first] * mesh.header.numVertices] );
+			first = end;
+		}
 
 		offset += mesh.header.length;
 	}
 
-	printf( "MD3Model::load() - Loaded %i frames, %i meshes\n", header.numFrames, header.numMeshes );
+	if ( !success )
+	{
+		free();
+		return false;
+	}
 
-	fclose( f );
 	return true;
 }
 
@@ -122,29 +205,15 @@ void MD3Model::free()
 		delete[] meshes;
 		meshes = NULL;
 	}
-}
 
-void MD3Model::printInfo() const
+	frameSlots.clear();
+}
+
+const MD3Vertex *MD3Model::getVertices( const MD3Mesh &mesh, int frame ) const
 {
-	cout << "MD3 file info" << endl;
-	for ( int i = 0; i < header.numFrames; i++ )
-	{
-		cout << "Frame " << i << " = " << frames[i].name << endl;
-	}
-	cout << header.numFrames << " frames total" << endl;
-	for ( int i = 0; i < header.numTags; i++ )
-	{
-		cout << "Tag " << i << " = " << tags[i].name << endl;
-	}
-	cout << header.numTags << " tags total" << endl;
-	for ( int i = 0; i < header.numMeshes; i++ )
-	{
-		cout << "Mesh " << i << " = " << meshes[i].header.name << endl;
-		for ( int j = 0; j < meshes[i].header.numShaders; j++ )
-		{
-			cout << "Mesh " << i << " shader " << j << " = " << meshes[i].shaders[j].name << endl;
-		}
-		cout << "Mesh " << i << " has " << meshes[i].header.numShaders << " shaders total" << endl;
-	}
-	cout << header.numMeshes << " meshes total" << endl;
+	if ( frame < 0 || frame >= (int)frameSlots.size() || frameSlots[frame] < 0 )
+		return NULL;
+
+	int slot = (frame < mesh.header.numFrames ? frameSlots[frame] : mesh.emptyFrameSlot);
+	return &mesh.vertices[(size_t)slot * mesh.header.numVertices];
 }
@@ -25,6 +25,7 @@ THE SOFTWARE.
 #define __MD3MODEL_H__
 
 #include "Quake.h"
+#include "Storage.h"
 
 struct MD3Header
 {
@@ -103,6 +104,7 @@ struct MD3Mesh
 	MD3Triangle		*triangles;
 	MD3TexCoord		*texCoords;
 	MD3Vertex		*vertices;
+	int				emptyFrameSlot;	// shared by the loaded frames the surface doesn't have, all zero
 };
 
 class MD3Model
@@ -112,14 +114,24 @@ public:
 	~MD3Model();
 
 	bool load( const string &filename );
+
+	// Only the vertices of the given frames are loaded, or those of every frame if frames is NULL
+	bool load( const char *data, size_t size, const set<int> *frames = NULL );
+
+	// Reads the headers, and then only the parts of the file that are loaded
+	bool load( const BlockReader &readBlock, const set<int> *frames = NULL );
 	void free();
 
-	void printInfo() const;
+	// The vertices of a mesh in a frame, NULL if the frame wasn't loaded
+	const MD3Vertex *getVertices( const MD3Mesh &mesh, int frame ) const;
 
 	MD3Header	header;
 	MD3Frame	*frames;
 	MD3Tag		*tags;
 	MD3Mesh		*meshes;
+
+	// For every frame, its position in the vertex array of each mesh, or -1 if it wasn't loaded
+	vector<int>	frameSlots;
 };
 
 #endif	// __MD3MODEL_H__
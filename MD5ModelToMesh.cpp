@@ -23,20 +23,23 @@ THE SOFTWARE.
 */
 #include "Common.h"
 #include "MD5ModelToMesh.h"
+#include "ConversionStats.h"
+#include "ThreadPool.h"
 
 #include "md5model.h"
+#include "ParsedInputCache.h"
 
-MD5ModelToMesh::MD5ModelToMesh( const GlobalOptions &globals ):
-	mGlobals( globals ), mMaxWeights( -1 )
+MD5ModelToMesh::MD5ModelToMesh( const GlobalOptions &globals, ConversionContext &context ):
+	mGlobals( globals ), mContext( context ), mLog( context.log ), mMaxWeights( -1 )
 {
 }
 
 bool MD5ModelToMesh::build()
 {
 	struct md5_model_t mdl;
-	if ( !ReadMD5Model( mInputFile.c_str(), &mdl ) )
+	if ( !loadModel( &mdl ) )
 	{
-		cout << "[Error] Could not load file '" << mInputFile << "'" << endl;
+		mLog << "[Error] Could not load file '" << mInputFile << "'" << endl;
 		return false;
 	}
 	
@@ -45,10 +48,10 @@ bool MD5ModelToMesh::build()
 
 	buildMesh( &mdl );
 
-	cout << "Saving mesh XML file '" << mOutputFile << "'" << endl;
-	if ( !mMeshWriter.saveFile( mOutputFile ) )
+	mLog << "Saving mesh XML file '" << mOutputFile << "'" << endl;
+	if ( !mContext.writeXml( mOutputFile, mMeshWriter ) )
 	{
-		cout << "[Error] Could not save mesh XML file" << endl;
+		mLog << "[Error] Could not save mesh XML file" << endl;
 		FreeModel( &mdl );
 		return false;
 	}
@@ -58,36 +61,142 @@ bool MD5ModelToMesh::build()
 		buildSkeleton( &mdl );
 
 		string skeletonFile = mSkeletonName + ".skeleton.xml";
-		cout << "Saving skeleton XML file '" << skeletonFile << "'" << endl;
-		if ( !mSkelWriter.saveFile( skeletonFile ) )
-			cout << "[Warning] Could not save skeleton XML file" << endl;
+		mLog << "Saving skeleton XML file '" << skeletonFile << "'" << endl;
+		if ( !mContext.writeXml( skeletonFile, mSkelWriter ) )
+			mLog << "[Warning] Could not save skeleton XML file" << endl;
 	}
 
 	FreeModel( &mdl );
 	return true;
 }
 
+bool MD5ModelToMesh::loadModel( struct md5_model_t *mdl )
+{
+	ProfileScope scope( mContext.profiler, "load" );
+
+	string data;
+	if ( !mContext.readInput( mInputFile, data ) )
+		return false;
+
+	return (ReadMD5ModelBuffer( data.data(), data.size(), mdl ) != 0);
+}
+
+bool MD5ModelToMesh::loadAnimation( const string &filename, struct md5_anim_t *anim )
+{
+	ProfileScope scope( mContext.profiler, "load" );
+
+	string data;
+	if ( !mContext.readInput( filename, data ) )
+		return false;
+
+	ParsedInputCache *cache = mContext.parseCache;
+	if ( cache && cache->findMD5Anim( data, anim ) )
+		return true;
+
+	if ( !ReadMD5AnimBuffer( data.data(), data.size(), anim ) )
+		return false;
+
+	if ( cache )
+		cache->storeMD5Anim( data, anim );
+
+	return true;
+}
+
 void MD5ModelToMesh::buildMesh( const struct md5_model_t *mdl )
 {
+	ProfileScope scope( mContext.profiler, "mesh build" );
+
     mMeshWriter.setDocType( "mesh", "ogremeshxml.dtd" );
 	mMeshWriter.openTag( "mesh" );
 
-	mMeshWriter.openTag( "submeshes" );
-	for ( SubMeshMap::iterator iter = mSubMeshes.begin(); iter != mSubMeshes.end(); ++iter )
+	// Pose every submesh before building any, so that their tangents can be generated side by side
+	vector<struct md5_mesh_t*> meshes;
+	vector<SubMeshMap::const_iterator> subMeshes;
+	for ( SubMeshMap::const_iterator iter = mSubMeshes.begin(); iter != mSubMeshes.end(); ++iter )
 	{
 		int index = iter->first;
 		if ( index < 0 || index >= mdl->num_meshes )
 		{
-			cout << "[Warning] Invalid submesh index: " << index << endl;
+			mLog << "[Warning] Invalid submesh index: " << index << endl;
 			continue;
 		}
 
-		cout << "Building submesh " << index << endl;
-
+		ProfileScope prepareScope( mContext.profiler, "prepare submesh " + StringUtil::toString( index ) );
 		struct md5_mesh_t *mesh = &mdl->meshes[index];
 		PrepareMesh( mesh, mdl->baseSkel );
 		transformMesh( mdl, mesh );
-		buildSubMesh( mesh, iter->second );
+		if ( mContext.stats )
+			mContext.stats->addSourceGeometry( mesh->num_verts, mesh->num_tris );
+		if ( mGlobals.cleanupGeometry )
+			cleanupGeometry( mesh );
+		meshes.push_back( mesh );
+		subMeshes.push_back( iter );
+	}
+
+	vector<TangentList> tangents( meshes.size() );
+	if ( mGlobals.generateTangents )
+	{
+		ProfileScope tangentScope( mContext.profiler, "tangents" );
+		generateTangents( meshes, tangents, mContext.workers );
+	}
+
+	// Meshes sharing a material go into one submesh when merging, in the order the first of them appears
+	vector<string> materials;
+	vector< vector<SubMeshPart> > parts;
+	vector<string> names;
+	for ( size_t i = 0; i < meshes.size(); i++ )
+	{
+		const SubMeshInfo &info = subMeshes[i]->second;
+		string material = (info.material.empty() ? meshes[i]->shader : info.material);
+
+		size_t subMesh = mGlobals.mergeSubMeshes ? 
+			std::find( materials.begin(), materials.end(), material ) - materials.begin() : materials.size();
+		if ( subMesh == materials.size() )
+		{
+			materials.push_back( material );
+			parts.push_back( vector<SubMeshPart>() );
+			names.push_back( info.name );
+		}
+		else
+		{
+			mLog << "Merging submesh " << subMeshes[i]->first << " into written submesh " << subMesh 
+				<< ", as both use material '" << material << "'" << endl;
+			if ( names[subMesh].empty() )
+				names[subMesh] = info.name;
+		}
+
+		SubMeshPart part;
+		part.mesh = meshes[i];
+		part.tangents = &tangents[i];
+		parts[subMesh].push_back( part );
+	}
+
+	// Shared geometry is written before the submeshes, so all faces are optimised first
+	mLodFaces.clear();
+	mEdgeLists = EdgeListBuilder( mGlobals.sharedGeometry );
+	vector<IndexList> faces( parts.size() );
+	vector<SubMeshPart> sharedParts;
+	for ( size_t i = 0; i < parts.size(); i++ )
+	{
+		mLog << "Building submesh " << i << endl;
+		ProfileScope subMeshScope( mContext.profiler, "submesh " + StringUtil::toString( (int)i ) );
+		optimizeSubMesh( parts[i], mGlobals.sharedGeometry ? getNumVertices( sharedParts ) : 0, faces[i] );
+		if ( mGlobals.sharedGeometry )
+			sharedParts.insert( sharedParts.end(), parts[i].begin(), parts[i].end() );
+	}
+
+	if ( mGlobals.sharedGeometry )
+	{
+		TiXmlElement *geomNode = mMeshWriter.openTag( "sharedgeometry" );
+		geomNode->SetAttribute( "vertexcount", getNumVertices( sharedParts ) );
+		buildVertexBuffers( sharedParts );
+		mMeshWriter.closeTag();	// sharedgeometry
+	}
+
+	mMeshWriter.openTag( "submeshes" );
+	for ( size_t i = 0; i < parts.size(); i++ )
+	{
+		buildSubMesh( materials[i], parts[i], faces[i] );
 	}
 	mMeshWriter.closeTag();	// submeshes
 
@@ -97,17 +206,23 @@ void MD5ModelToMesh::buildMesh( const struct md5_model_t *mdl )
 		mMeshWriter.closeTag();
 	}
 
+	if ( mGlobals.sharedGeometry )
+	{
+		ProfileScope scope( mContext.profiler, "bone assignments" );
+		mMeshWriter.openTag( "boneassignments" );
+		buildBoneAssignments( sharedParts );
+		mMeshWriter.closeTag();	// boneassignments
+	}
+
     TiXmlElement *submeshNamesNode = mMeshWriter.openTag( "submeshnames" );
-    for ( SubMeshMap::const_iterator iter = mSubMeshes.begin(); iter != mSubMeshes.end(); ++iter )
+    for ( size_t i = 0; i < names.size(); i++ )
     {
-	    int index = iter->first;
-	    const SubMeshInfo &info = iter->second;
-	    if ( info.name.empty() )
+	    if ( names[i].empty() )
 		    continue;
 
 	    TiXmlElement *nameNode = mMeshWriter.openTag( "submeshname" );
-	    nameNode->SetAttribute( "index", index );
-	    nameNode->SetAttribute( "name", info.name );
+	    nameNode->SetAttribute( "index", (int)i );
+	    nameNode->SetAttribute( "name", names[i] );
 	    mMeshWriter.closeTag();	// submeshname
     }
     
@@ -117,70 +232,298 @@ void MD5ModelToMesh::buildMesh( const struct md5_model_t *mdl )
         mMeshWriter.closeTag();	// submeshnames
     }
 
+	if ( !mLodFaces.empty() )
+		MeshSimplifier::writeLevelOfDetail( mMeshWriter, mGlobals.lodLevels, mLodFaces );
+
+	if ( mGlobals.buildEdgeLists )
+	{
+		mLog << "Built edge lists with " << mEdgeLists.getNumEdges() << " edges, " << mEdgeLists.getNumOpenEdges() 
+			<< " of them open, leaving out " << mEdgeLists.getNumDegenerateTriangles() << " degenerate triangles" << endl;
+		mEdgeLists.write( mMeshWriter );
+	}
+
 	mMeshWriter.closeTag();	// mesh
 }
 
-void MD5ModelToMesh::buildSubMesh( const struct md5_mesh_t *mesh, const SubMeshInfo &subMeshInfo )
+static bool jointCompare( const struct md5_weight_t *a, const struct md5_weight_t *b )
 {
-	TiXmlElement *submeshNode = mMeshWriter.openTag( "submesh" );
+	return (a->joint < b->joint);
+}
+
+void MD5ModelToMesh::cleanupGeometry( struct md5_mesh_t *mesh )
+{
+	ProfileScope scope( mContext.profiler, "cleanup" );
+
+	// Normals follow from the triangles, so vertices are compared on their bind position, 
+	// texture coordinates and weights. Weights are sorted on their joint, as their order doesn't matter.
+	int maxWeights = 0;
+	for ( int i = 0; i < mesh->num_verts; i++ )
+		maxWeights = max( maxWeights, mesh->vertices[i].count );
+
+	int stride = 5 + maxWeights * 5;
+	vector<float> attributes( mesh->num_verts * stride, 0.0f );
+	vector<const struct md5_weight_t *> weights;
+	for ( int i = 0; i < mesh->num_verts; i++ )
+	{
+		const struct md5_vertex_t *v = &mesh->vertices[i];
+		float *vertex = &attributes[i * stride];
+		vertex[0] = mesh->vertexArray[i].x; vertex[1] = mesh->vertexArray[i].y; vertex[2] = mesh->vertexArray[i].z;
+		vertex[3] = v->st[0]; vertex[4] = v->st[1];
+
+		weights.clear();
+		for ( int j = 0; j < v->count; j++ )
+			weights.push_back( &mesh->weights[v->start + j] );
+		std::stable_sort( weights.begin(), weights.end(), &jointCompare );
+
+		for ( int j = 0; j < maxWeights; j++ )
+		{
+			float *weight = &vertex[5 + j * 5];
+			if ( j >= (int)weights.size() )
+			{
+				weight[0] = -1.0f;
+				continue;
+			}
+
+			const struct md5_weight_t *w = weights[j];
+			weight[0] = (float)w->joint; weight[1] = w->bias;
+			weight[2] = w->pos.x; weight[3] = w->pos.y; weight[4] = w->pos.z;
+		}
+	}
+
+	IndexList remap;
+	int numWelded = GeometryCleaner::weldVertices( attributes, stride, mGlobals.weldTolerance, remap );
+
+	IndexList indices;
+	for ( int i = 0; i < mesh->num_tris; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			indices.push_back( remap[mesh->triangles[i].index[j]] );
+	}
+
+	// The bones may pull apart corners that only meet in the bind pose, so only triangles that 
+	// welding collapsed are known to stay without area
+	int numDegenerate = GeometryCleaner::removeDegenerateTriangles( indices, vector<PositionList>() );
+
+	// Fewer triangles remain, so they fit in the mesh's own array
+	int numTriangles = mesh->num_tris;
+	mesh->num_tris = (int)indices.size() / 3;
+	for ( int i = 0; i < mesh->num_tris; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			mesh->triangles[i].index[j] = indices[i * 3 + j];
+	}
+
+	mLog << "Welded " << numWelded << " duplicate vertices and removed " << numDegenerate << " degenerate triangles, leaving " 
+		<< mesh->num_tris << " of " << numTriangles << " triangles" << endl;
+}
+
+int MD5ModelToMesh::getNumVertices( const vector<SubMeshPart> &parts )
+{
+	int numVertices = 0;
+	for ( size_t p = 0; p < parts.size(); p++ )
+		numVertices += parts[p].vertexOrder.empty() ? parts[p].mesh->num_verts : (int)parts[p].vertexOrder.size();
+	return numVertices;
+}
+
+void MD5ModelToMesh::optimizeSubMesh( vector<SubMeshPart> &parts, int vertexOffset, IndexList &faces )
+{
+	// Merged meshes follow one another in the vertex buffer, each optimised on its own
+	IndexList indices;
+	vector<IndexList> lodFaces;
+	PositionList positions;
+	int numVertices = 0;
+	for ( size_t p = 0; p < parts.size(); p++ )
+	{
+		const struct md5_mesh_t *mesh = parts[p].mesh;
+		IndexList &vertexOrder = parts[p].vertexOrder;
+
+		// Doom 3 winds its faces the other way round, so flip the index order
+		IndexList meshIndices;
+		meshIndices.reserve( mesh->num_tris * 3 );
+		for ( int i = 0; i < mesh->num_tris; i++ )
+		{
+			const struct md5_triangle_t *triangle = &mesh->triangles[i];
+			meshIndices.push_back( triangle->index[0] );
+			meshIndices.push_back( triangle->index[2] );
+			meshIndices.push_back( triangle->index[1] );
+		}
+		vector<IndexList> meshLodFaces;
+		optimizeFaces( mesh, meshIndices, vertexOrder, meshLodFaces );
+
+		// Vertices are written as stored in the md5mesh file, apart from the ones cleanup left out
+		int numMeshVertices = vertexOrder.empty() ? mesh->num_verts : (int)vertexOrder.size();
+		if ( mContext.stats )
+			mContext.stats->addGeometry( numMeshVertices, (int)meshIndices.size() / 3 );
+
+		MeshOptimizer::appendIndices( indices, meshIndices, numVertices );
+		lodFaces.resize( meshLodFaces.size() );
+		for ( size_t i = 0; i < meshLodFaces.size(); i++ )
+			MeshOptimizer::appendIndices( lodFaces[i], meshLodFaces[i], numVertices );
+
+		if ( mGlobals.buildEdgeLists )
+		{
+			for ( int i = 0; i < numMeshVertices; i++ )
+				positions.push_back( mesh->vertexArray[vertexOrder.empty() ? i : vertexOrder[i]] );
+		}
+
+		numVertices += numMeshVertices;
+	}
+
+	if ( mGlobals.buildEdgeLists )
+	{
+		ProfileScope scope( mContext.profiler, "edge list" );
+		mEdgeLists.addSubMesh( positions, indices, lodFaces );
+	}
+
+	// Shared geometry holds the vertices of the previous submeshes first
+	MeshOptimizer::appendIndices( faces, indices, vertexOffset );
+	if ( !lodFaces.empty() )
+	{
+		mLodFaces.push_back( vector<IndexList>( lodFaces.size() ) );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+			MeshOptimizer::appendIndices( mLodFaces.back()[i], lodFaces[i], vertexOffset );
+	}
+}
 
-	string matName = (subMeshInfo.material.empty() ? mesh->shader : subMeshInfo.material);
-	submeshNode->SetAttribute( "material", matName );
-	submeshNode->SetAttribute( "usesharedvertices", "false" );
+void MD5ModelToMesh::buildSubMesh( const string &material, const vector<SubMeshPart> &parts, const IndexList &indices )
+{
+	TiXmlElement *submeshNode = mMeshWriter.openTag( "submesh" );
+	submeshNode->SetAttribute( "material", material );
+	submeshNode->SetAttribute( "usesharedvertices", mGlobals.sharedGeometry ? "true" : "false" );
 	submeshNode->SetAttribute( "operationtype", "triangle_list" );
 
 	// Faces
 	TiXmlElement *facesNode = mMeshWriter.openTag( "faces" );
-	facesNode->SetAttribute( "count", mesh->num_tris );
-	for ( int i = 0; i < mesh->num_tris; i++ )
+	facesNode->SetAttribute( "count", (int)indices.size() / 3 );
+	for ( size_t i = 0; i < indices.size(); i += 3 )
 	{
-		buildFace( &mesh->triangles[i] );
+		buildFace( &indices[i] );
 	}
 	mMeshWriter.closeTag();	// faces
 
-	// Geometry
-	TiXmlElement *geomNode = mMeshWriter.openTag( "geometry" );
-	geomNode->SetAttribute( "vertexcount", mesh->num_verts );
-	buildVertexBuffers( mesh );
-	mMeshWriter.closeTag();	// geometry
-
-	// Bone assignments
-	mMeshWriter.openTag( "boneassignments" );
-	buildBoneAssignments( mesh );
-	mMeshWriter.closeTag();	// boneassignments
+	// Geometry and bone assignments, unless they are shared by the whole mesh
+	if ( !mGlobals.sharedGeometry )
+	{
+		TiXmlElement *geomNode = mMeshWriter.openTag( "geometry" );
+		geomNode->SetAttribute( "vertexcount", getNumVertices( parts ) );
+		buildVertexBuffers( parts );
+		mMeshWriter.closeTag();	// geometry
+
+		ProfileScope scope( mContext.profiler, "bone assignments" );
+		mMeshWriter.openTag( "boneassignments" );
+		buildBoneAssignments( parts );
+		mMeshWriter.closeTag();	// boneassignments
+	}
 
 	mMeshWriter.closeTag();	// submesh
 }
 
-void MD5ModelToMesh::buildFace( const struct md5_triangle_t *triangle )
+void MD5ModelToMesh::optimizeFaces( const struct md5_mesh_t *mesh, IndexList &indices, IndexList &vertexOrder, vector<IndexList> &lodFaces )
+{
+	int numVertices = mesh->num_verts;
+
+	// Sorting clusters against overdraw only works on triangles that are in cache order already
+	if ( mGlobals.optimizeVertexCache || mGlobals.optimizeOverdraw )
+	{
+		ProfileScope scope( mContext.profiler, "vertex cache" );
+		float before = MeshOptimizer::computeACMR( indices, numVertices );
+		MeshOptimizer::optimizeVertexCache( indices, numVertices );
+		mLog << "Reordered triangles for the vertex cache, ACMR " << before << " -> " 
+			<< MeshOptimizer::computeACMR( indices, numVertices ) << endl;
+	}
+
+	if ( mGlobals.optimizeOverdraw )
+	{
+		ProfileScope scope( mContext.profiler, "overdraw" );
+		// Clusters are sorted on the shape of the bind pose
+		vector<Vector3> positions( mesh->vertexArray, mesh->vertexArray + numVertices );
+
+		float before = MeshOptimizer::computeACMR( indices, numVertices );
+		MeshOptimizer::optimizeOverdraw( indices, positions, mGlobals.overdrawThreshold );
+		mLog << "Sorted triangle clusters against overdraw, ACMR " << before << " -> " 
+			<< MeshOptimizer::computeACMR( indices, numVertices ) << endl;
+	}
+
+	if ( !mGlobals.lodLevels.empty() )
+	{
+		ProfileScope scope( mContext.profiler, "level of detail" );
+
+		// Skeletal animation is left to the bones, so collapses are judged on the bind pose alone
+		vector<PositionList> frames( 1, PositionList( mesh->vertexArray, mesh->vertexArray + numVertices ) );
+		MeshSimplifier::simplify( indices, frames, mGlobals.lodLevels, lodFaces );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+		{
+			if ( mGlobals.optimizeVertexCache )
+				MeshOptimizer::optimizeVertexCache( lodFaces[i], numVertices );
+
+			mLog << "Generated LOD level " << i + 1 << " with " << lodFaces[i].size() / 3 << " triangles" << endl;
+		}
+	}
+
+	if ( mGlobals.optimizeVertexFetch )
+	{
+		ProfileScope scope( mContext.profiler, "vertex fetch" );
+		MeshOptimizer::optimizeVertexFetch( indices, numVertices, vertexOrder );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+			MeshOptimizer::remapIndices( lodFaces[i], vertexOrder );
+		mLog << "Reordered vertices in the order the triangles use them" << endl;
+	}
+
+	if ( mGlobals.cleanupGeometry )
+	{
+		int numUnused = GeometryCleaner::removeUnusedVertices( indices, lodFaces, numVertices, vertexOrder );
+		mLog << "Removed " << numUnused << " vertices that no triangle uses, leaving " << vertexOrder.size() 
+			<< " of " << numVertices << " vertices" << endl;
+	}
+}
+
+void MD5ModelToMesh::buildFace( const int indices[3] )
 {
 	TiXmlElement *faceNode = mMeshWriter.openTag( "face" );
-	faceNode->SetAttribute( "v1", triangle->index[0] );
-	faceNode->SetAttribute( "v2", triangle->index[2] );
-	faceNode->SetAttribute( "v3", triangle->index[1] );
+	faceNode->SetAttribute( "v1", indices[0] );
+	faceNode->SetAttribute( "v2", indices[1] );
+	faceNode->SetAttribute( "v3", indices[2] );
 	mMeshWriter.closeTag();	
 }
 
-void MD5ModelToMesh::buildVertexBuffers( const struct md5_mesh_t *mesh )
+void MD5ModelToMesh::buildVertexBuffers( const vector<SubMeshPart> &parts )
 {
-	Vector3 *normals = new Vector3[mesh->num_verts];
-	generateNormals( mesh, normals );
-
 	TiXmlElement *vbNode = mMeshWriter.openTag( "vertexbuffer" );
 	vbNode->SetAttribute( "positions", "true" );
 	vbNode->SetAttribute( "normals", "true" );
+	if ( mGlobals.generateTangents )
+	{
+		vbNode->SetAttribute( "tangents", "true" );
+		vbNode->SetAttribute( "tangent_dimensions", 4 );
+	}
 	vbNode->SetAttribute( "texture_coords", 1 );
 	vbNode->SetAttribute( "texture_coord_dimensions_0", 2 );	
-	for ( int i = 0; i < mesh->num_verts; i++ )
+	for ( size_t p = 0; p < parts.size(); p++ )
 	{
-		buildVertex( mesh->vertexArray[i], normals[i], mesh->vertices[i].st );
+		const struct md5_mesh_t *mesh = parts[p].mesh;
+		const IndexList &vertexOrder = parts[p].vertexOrder;
+		const TangentList &tangents = *parts[p].tangents;
+
+		Vector3 *normals = new Vector3[mesh->num_verts];
+		{
+			ProfileScope scope( mContext.profiler, "normals" );
+			generateNormals( mesh, normals );
+		}
+
+		int numVertices = vertexOrder.empty() ? mesh->num_verts : (int)vertexOrder.size();
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			int vertIndex = vertexOrder.empty() ? i : vertexOrder[i];
+			buildVertex( mesh->vertexArray[vertIndex], normals[vertIndex], mesh->vertices[vertIndex].st, 
+				tangents.empty() ? NULL : &tangents[vertIndex] );
+		}
+
+		delete[] normals;
 	}
 	mMeshWriter.closeTag();	// vertexbuffer
-
-	delete[] normals;
 }
 
-void MD5ModelToMesh::buildVertex( const Vector3 &position, const Vector3 &normal, const float texCoord[2] )
+void MD5ModelToMesh::buildVertex( const Vector3 &position, const Vector3 &normal, const float texCoord[2], const Tangent *tangent )
 {
 	mMeshWriter.openTag( "vertex" );
 
@@ -196,6 +539,16 @@ void MD5ModelToMesh::buildVertex( const Vector3 &position, const Vector3 &normal
 	normNode->SetAttribute( "z", StringUtil::toString( normal.z ) );
 	mMeshWriter.closeTag();
 
+	if ( tangent )
+	{
+		TiXmlElement *tangentNode = mMeshWriter.openTag( "tangent" );
+		tangentNode->SetAttribute( "x", StringUtil::toString( tangent->direction.x ) );
+		tangentNode->SetAttribute( "y", StringUtil::toString( tangent->direction.y ) );
+		tangentNode->SetAttribute( "z", StringUtil::toString( tangent->direction.z ) );
+		tangentNode->SetAttribute( "w", StringUtil::toString( tangent->handedness ) );
+		mMeshWriter.closeTag();
+	}
+
 	TiXmlElement *tcNode = mMeshWriter.openTag( "texcoord" );
 	tcNode->SetAttribute( "u", StringUtil::toString( texCoord[0] ) );
 	tcNode->SetAttribute( "v", StringUtil::toString( texCoord[1] ) );
@@ -209,47 +562,60 @@ static bool weightCompare( const struct md5_weight_t *a, const struct md5_weight
 	return (a->bias < b->bias);
 }
 
-void MD5ModelToMesh::buildBoneAssignments( const struct md5_mesh_t *mesh )
+void MD5ModelToMesh::buildBoneAssignments( const vector<SubMeshPart> &parts )
 {
 	typedef vector<const struct md5_weight_t *> WeightVector;
 	WeightVector weights;
 
-	for ( int i = 0; i < mesh->num_verts; i++ )
+	int vertexIndex = 0;
+	for ( size_t p = 0; p < parts.size(); p++ )
 	{
-		const struct md5_vertex_t *v = &mesh->vertices[i];
-		weights.clear();
+		const struct md5_mesh_t *mesh = parts[p].mesh;
+		const IndexList &vertexOrder = parts[p].vertexOrder;
 
-		// First, sort all the vertex weights on their bias value in descending order
-		for ( int j = 0; j < v->count; j++ )
-			weights.push_back( &mesh->weights[v->start + j] );
-		std::stable_sort( weights.rbegin(), weights.rend(), &weightCompare );
+		int numVertices = vertexOrder.empty() ? mesh->num_verts : (int)vertexOrder.size();
+		for ( int i = 0; i < numVertices; i++, vertexIndex++ )
+		{
+			const struct md5_vertex_t *v = &mesh->vertices[vertexOrder.empty() ? i : vertexOrder[i]];
+			weights.clear();
 
-		// Remove the least significant weights, so only mMaxWeights weights remain
-		if ( mMaxWeights > 0 && weights.size() > (size_t)mMaxWeights )
-			weights.erase( weights.begin() + mMaxWeights, weights.end() );
+			// First, sort all the vertex weights on their bias value in descending order
+			for ( int j = 0; j < v->count; j++ )
+				weights.push_back( &mesh->weights[v->start + j] );
+			std::stable_sort( weights.rbegin(), weights.rend(), &weightCompare );
 
-		// Count the total bias of all the remaining weights
-		float totalWeight = 0;
-		for ( WeightVector::iterator iter = weights.begin(); iter != weights.end(); ++iter )
-			totalWeight += (*iter)->bias;
+			// Remove the least significant weights, so only mMaxWeights weights remain
+			if ( mMaxWeights > 0 && weights.size() > (size_t)mMaxWeights )
+				weights.erase( weights.begin() + mMaxWeights, weights.end() );
 
-		// Finally, write all the remaining weights, with adjusted biases
-		for ( WeightVector::iterator iter = weights.begin(); iter != weights.end(); ++iter )
-		{
-			const struct md5_weight_t *w = *iter;
+			// Count the total bias of all the remaining weights
+			float totalWeight = 0;
+			for ( WeightVector::iterator iter = weights.begin(); iter != weights.end(); ++iter )
+				totalWeight += (*iter)->bias;
 
-			TiXmlElement *vbNode = mMeshWriter.openTag( "vertexboneassignment" );
-			vbNode->SetAttribute( "vertexindex", i );
-			vbNode->SetAttribute( "boneindex", w->joint );
-			vbNode->SetAttribute( "weight", StringUtil::toString( w->bias / totalWeight ) );
+			if ( mContext.stats )
+				mContext.stats->addBoneAssignments( (int)weights.size() );
 
-			mMeshWriter.closeTag();
+			// Finally, write all the remaining weights, with adjusted biases
+			for ( WeightVector::iterator iter = weights.begin(); iter != weights.end(); ++iter )
+			{
+				const struct md5_weight_t *w = *iter;
+
+				TiXmlElement *vbNode = mMeshWriter.openTag( "vertexboneassignment" );
+				vbNode->SetAttribute( "vertexindex", vertexIndex );
+				vbNode->SetAttribute( "boneindex", w->joint );
+				vbNode->SetAttribute( "weight", StringUtil::toString( w->bias / totalWeight ) );
+
+				mMeshWriter.closeTag();
+			}
 		}
 	}
 }
 
 void MD5ModelToMesh::buildSkeleton( const struct md5_model_t *mdl )
 {
+	ProfileScope scope( mContext.profiler, "skeleton build" );
+
     mSkelWriter.setDocType( "skeleton", "ogreskeletonxml.dtd" );
 	mSkelWriter.openTag( "skeleton" );
 	
@@ -362,16 +728,18 @@ void MD5ModelToMesh::buildAnimations( const struct md5_model_t *mdl )
 
 void MD5ModelToMesh::buildAnimation( const struct md5_model_t *mdl, const string &name, const AnimationInfo &animInfo )
 {
+	ProfileScope scope( mContext.profiler, "animation '" + name + "'" );
+
 	struct md5_anim_t anim;
-	if ( !ReadMD5Anim( animInfo.inputFile.c_str(), &anim ) )
+	if ( !loadAnimation( animInfo.inputFile, &anim ) )
 	{
-		cout << "[Warning] Could not load MD5 animation file '" << animInfo.inputFile << "'" << endl;
+		mLog << "[Warning] Could not load MD5 animation file '" << animInfo.inputFile << "'" << endl;
 		return;
 	}
 
 	if ( !CheckAnimValidity( mdl, &anim ) )
 	{
-		cout << "[Warning] MD5 animation file '" << animInfo.inputFile << "' is not compatible with this model" << endl;
+		mLog << "[Warning] MD5 animation file '" << animInfo.inputFile << "' is not compatible with this model" << endl;
 		FreeAnim( &anim );
 		return;
 	}
@@ -379,7 +747,7 @@ void MD5ModelToMesh::buildAnimation( const struct md5_model_t *mdl, const string
 	if ( mGlobals.convertCoords )
 		convertCoordSystem( &anim );
 
-	cout << "Building animation '" << name << "'" << endl;
+	mLog << "Building animation '" << name << "'" << endl;
 
 	TiXmlElement *animTag = mSkelWriter.openTag( "animation" );
 	animTag->SetAttribute( "name", name );
@@ -389,30 +757,36 @@ void MD5ModelToMesh::buildAnimation( const struct md5_model_t *mdl, const string
 	struct md5_anim_t newAnim, *finalAnim = &anim;
 	if ( animInfo.fps > 0 && animInfo.fps != anim.frameRate )
 	{
-		cout << "Resampling animation to " << animInfo.fps << " fps" << endl;
+		mLog << "Resampling animation to " << animInfo.fps << " fps" << endl;
+		ProfileScope resampleScope( mContext.profiler, "resample" );
 		resampleAnimation( &anim, &newAnim, animInfo.fps );
 		finalAnim = &newAnim;
 		FreeAnim( &anim );
 	}
 
+	ProfileScope tracksScope( mContext.profiler, "tracks" );
+	ProgressReporter progress( mLog, anim.num_joints );
 	mSkelWriter.openTag( "tracks" );
 	for ( int i = 0; i < anim.num_joints; i++ )
 	{
 		buildTrack( mdl, finalAnim, i, animInfo );
-		cout << ((i+1) * 100 / anim.num_joints) << "%\r";
+		progress.update( i + 1 );
 	}
 	mSkelWriter.closeTag();	// tracks
 
 	mSkelWriter.closeTag();	// animation
 
+	if ( mContext.stats )
+		mContext.stats->addAnimation( name, finalAnim->num_joints, (long long)finalAnim->num_joints * finalAnim->num_frames );
+
 	FreeAnim( finalAnim );
 }
 
 void MD5ModelToMesh::buildTrack( const struct md5_model_t *mdl, const struct md5_anim_t *anim, int jointIndex, const AnimationInfo &animInfo )
 {
 	const struct md5_joint_t *baseJoint = &mdl->baseSkel[jointIndex];
-	static Vector3 translate;
-	static Quaternion rotate;
+	Vector3 translate;
+	Quaternion rotate;
 
 	TiXmlElement *trackTag = mSkelWriter.openTag( "track" );
 	trackTag->SetAttribute( "bone", StringUtil::stripQuotes( baseJoint->name ) );
@@ -525,6 +899,45 @@ void MD5ModelToMesh::generateNormals( const struct md5_mesh_t *mesh, Vector3 *no
 	}
 }
 
+void MD5ModelToMesh::generateTangents( const vector<struct md5_mesh_t*> &meshes, vector<TangentList> &tangents, ThreadPool *workers )
+{
+	// Every submesh fills in its own list, so they need no locking
+	if ( !workers )
+	{
+		for ( size_t i = 0; i < meshes.size(); i++ )
+			generateTangents( meshes[i], tangents[i] );
+		return;
+	}
+
+	workers->parallelFor( (int)meshes.size(), [&meshes, &tangents]( int i )
+	{
+		generateTangents( meshes[i], tangents[i] );
+	} );
+}
+
+void MD5ModelToMesh::generateTangents( const struct md5_mesh_t *mesh, TangentList &tangents )
+{
+	PositionList positions( mesh->vertexArray, mesh->vertexArray + mesh->num_verts );
+	PositionList normals( mesh->num_verts );
+	generateNormals( mesh, &normals[0] );
+
+	vector<float> texCoords( mesh->num_verts * 2 );
+	for ( int i = 0; i < mesh->num_verts; i++ )
+	{
+		texCoords[i * 2] = mesh->vertices[i].st[0];
+		texCoords[i * 2 + 1] = mesh->vertices[i].st[1];
+	}
+
+	IndexList indices( mesh->num_tris * 3 );
+	for ( int i = 0; i < mesh->num_tris; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			indices[i * 3 + j] = mesh->triangles[i].index[j];
+	}
+
+	TangentGenerator::generate( indices, positions, normals, texCoords, tangents );
+}
+
 void MD5ModelToMesh::resampleAnimation( const struct md5_anim_t *in, struct md5_anim_t *out, int fps )
 {
 	memset( out, 0, sizeof(struct md5_anim_t) );
@@ -623,55 +1036,3 @@ bool MD5ModelToMesh::isMD5Anim( const string &filename )
 {
 	return (StringUtil::getExtension( filename ) == "md5anim");
 }
-
-void MD5ModelToMesh::printInfo( const string &filename )
-{
-	if ( isMD5Mesh( filename ) )
-	{
-		struct md5_model_t mdl;
-		if ( !ReadMD5Model( filename.c_str(), &mdl ) )
-			return;
-
-		cout << "MD5 Mesh file info" << endl;
-		for ( int i = 0; i < mdl.num_joints; i++ )
-		{
-			struct md5_joint_t *joint = &mdl.baseSkel[i];
-			cout << "Joint " << i << " = " << joint->name << endl;
-		}
-		cout << mdl.num_joints << " joints total" << endl;
-
-		for ( int i = 0; i < mdl.num_meshes; i++ )
-		{
-			struct md5_mesh_t *mesh = &mdl.meshes[i];
-			cout << "Mesh " << i << " shader = " << mesh->shader << endl;
-			cout << "Mesh " << i << " has " << mesh->num_verts << " vertices, " 
-				<< mesh->num_tris << " triangles, " << mesh->num_weights << " weights" << endl;
-		}
-		cout << mdl.num_meshes << " meshes total" << endl;
-
-		FreeModel( &mdl );
-		return;
-	}
-
-	if ( isMD5Anim( filename ) )
-	{
-		struct md5_anim_t anim;
-		if ( !ReadMD5Anim( filename.c_str(), &anim ) )
-			return;
-
-		cout << "MD5 Animation file info" << endl;
-
-		struct md5_joint_t *frame = anim.skelFrames[0];
-		for ( int i = 0; i < anim.num_joints; i++ )
-		{
-			struct md5_joint_t *joint = &frame[i];
-			cout << "Joint " << i << " = " << joint->name << endl;
-		}
-		cout << anim.num_joints << " joints total" << endl;
-
-		cout << anim.num_frames << " frames at " << anim.frameRate << " fps";
-
-		FreeAnim( &anim );
-		return;
-	}
-}
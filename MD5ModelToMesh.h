@@ -25,7 +25,13 @@ THE SOFTWARE.
 #define __MD5MODELTOMESH_H__
 
 #include "XmlWriter.h"
+#include "ConversionContext.h"
 #include "Quake.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+#include "EdgeListBuilder.h"
+#include "GeometryCleaner.h"
 #include "vector.h"
 #include "quaternion.h"
 
@@ -38,7 +44,7 @@ struct md5_anim_t;
 class MD5ModelToMesh
 {
 public:
-	MD5ModelToMesh( const GlobalOptions &globals );
+	MD5ModelToMesh( const GlobalOptions &globals, ConversionContext &context );
 
 	bool build();
 
@@ -67,15 +73,34 @@ public:
 
 	static bool isMD5Mesh( const string &filename );
 	static bool isMD5Anim( const string &filename );
-	static void printInfo( const string &filename );
 
 private:
+	friend class Benchmark;
+
+	bool loadModel( struct md5_model_t *mdl );
+	bool loadAnimation( const string &filename, struct md5_anim_t *anim );
+
+	/** One md5 mesh written into a submesh, following the meshes merged before it */
+	struct SubMeshPart
+	{
+		const struct md5_mesh_t *mesh;
+		const TangentList *tangents;
+		IndexList vertexOrder;	// Old index of every written vertex; empty if the vertices weren't reordered
+	};
+
 	void buildMesh( const struct md5_model_t *mdl );
-	void buildSubMesh( const struct md5_mesh_t *mesh, const SubMeshInfo &subMeshInfo );
-	void buildFace( const struct md5_triangle_t *triangle );
-	void buildVertexBuffers( const struct md5_mesh_t *mesh );
-	void buildVertex( const Vector3 &position, const Vector3 &normal, const float texCoord[2] );
-	void buildBoneAssignments( const struct md5_mesh_t *mesh );
+	void cleanupGeometry( struct md5_mesh_t *mesh );
+	/**
+	Optimises the faces of every part of a submesh and joins them into faces, whose indices
+	start at vertexOffset in the vertex buffer. Levels of detail and edge lists are added as well.
+	*/
+	void optimizeSubMesh( vector<SubMeshPart> &parts, int vertexOffset, IndexList &faces );
+	void buildSubMesh( const string &material, const vector<SubMeshPart> &parts, const IndexList &indices );
+	void optimizeFaces( const struct md5_mesh_t *mesh, IndexList &indices, IndexList &vertexOrder, vector<IndexList> &lodFaces );
+	void buildFace( const int indices[3] );
+	void buildVertexBuffers( const vector<SubMeshPart> &parts );
+	void buildVertex( const Vector3 &position, const Vector3 &normal, const float texCoord[2], const Tangent *tangent );
+	void buildBoneAssignments( const vector<SubMeshPart> &parts );
 
 	void buildSkeleton( const struct md5_model_t *mdl );
 	void buildBones( const struct md5_model_t *mdl );
@@ -87,7 +112,10 @@ private:
 
 	void transformMesh( const struct md5_model_t *mdl, struct md5_mesh_t *mesh );
 
+	static int getNumVertices( const vector<SubMeshPart> &parts );
 	static void generateNormals( const struct md5_mesh_t *mesh, Vector3 *normals );
+	static void generateTangents( const vector<struct md5_mesh_t*> &meshes, vector<TangentList> &tangents, ThreadPool *workers = NULL );
+	static void generateTangents( const struct md5_mesh_t *mesh, TangentList &tangents );
 	static void resampleAnimation( const struct md5_anim_t *in, struct md5_anim_t *out, int fps );
 	static const struct md5_joint_t *findJoint( const struct md5_model_t *mdl, const string &name );
 	static void jointDifference( const struct md5_joint_t *from, const struct md5_joint_t *to, 
@@ -100,6 +128,8 @@ private:
 	static void convertCoordSystem( struct md5_anim_t *anim );
 
 	const GlobalOptions &mGlobals;
+	ConversionContext &mContext;
+	ostream &mLog;
 
 	XmlWriter mMeshWriter;
 	XmlWriter mSkelWriter;
@@ -112,6 +142,8 @@ private:
 	typedef map<int, SubMeshInfo> SubMeshMap;
 	SubMeshMap mSubMeshes;
 	int mMaxWeights;
+	vector< vector<IndexList> > mLodFaces;	// Per written submesh and level of detail
+	EdgeListBuilder mEdgeLists;
 
 	typedef map<string, AnimationInfo> AnimationMap;
 	AnimationMap mAnimations;
@@ -20,553 +20,364 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 -------------------------------------------------------------------------------
-*/
-#include "Common.h"
-#include "MD2Model.h"
-#include "MD3Model.h"
-#include "Q2ModelToMesh.h"
-#include "Q3ModelToMesh.h"
-#include "MD5ModelToMesh.h"
-#include "Animation.h"
-
-#ifdef _WIN32
-#include <direct.h>
-#else
-#include <unistd.h>
-#define _chdir chdir
-void _chdrive( int ) {}
-#endif
-
-GlobalOptions::GlobalOptions():
-	convertCoords( true ), writeMaterials( false )
-{
-}
-
-static GlobalOptions gGlobals;
-
-bool processAnimationFile( TiXmlElement *animFileNode, Q3ModelToMesh &builder )
-{
-	cout << "Processing animation file" << endl;
-
-	TiXmlElement *filenameNode = animFileNode->FirstChildElement( "inputfile" );
-	if ( !filenameNode )
-	{
-		cout << "[Warning] Animation file declaration misses input filename" << endl;
-		return false;
-	}
-
-	AnimationFile animFile;
-	string animFilename = filenameNode->GetText();
-	if ( !animFile.load( animFilename ) )
-	{
-		cout << "[Warning] Could not load animation file '" << animFilename << "'" << endl;
-		return false;
-	}
-
-	for ( TiXmlElement *node = animFileNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "convertlegs" )
-		{
-			cout << "Converting all legs animations from animation file" << endl;
-			const AnimationMap &animMap = animFile.getLowerAnimations();
-			for ( AnimationMap::const_iterator i = animMap.begin(); i != animMap.end(); ++i )
-			{
-				builder.getAnimation( i->first ) = i->second;
-			}
-			break;
-		}
-		else if ( nodeName == "converttorso" )
-		{
-			cout << "Converting all torso animations from animation file" << endl;
-			const AnimationMap &animMap = animFile.getUpperAnimations();
-			for ( AnimationMap::const_iterator i = animMap.begin(); i != animMap.end(); ++i )
-			{
-				builder.getAnimation( i->first ) = i->second;
-			}
-			break;
-		}
-		else if ( nodeName == "convertselection" )
-		{
-			cout << "Converting a selection of animations from animation file" << endl;
-			const AnimationMap &animMap = animFile.getAnimations();
-			for ( TiXmlElement *child = node->FirstChildElement(); child; child = child->NextSiblingElement() )
-			{
-				const string &childName = child->ValueStr();
-				if ( childName == "animationname" )
-				{
-					string animName = child->GetText();
-					AnimationMap::const_iterator i = animMap.find( animName );
-					if ( i != animMap.end() )
-					{
-						cout << "Adding animation '" << animName << "'" << endl;
-						builder.getAnimation( i->first ) = i->second;
-					}
-					else
-					{
-						cout << "[Warning] Cannot find animation '" << animName << "'" << endl;
-					}
-				}
-			}
-			break;
-		}
-	}
-
-	return true;
-}
-
-bool processAnimations( TiXmlElement *animsNode, AnimationMap &dest )
-{
-	cout << "Processing manual animation definitions" << endl;
-
-	for ( TiXmlElement *node = animsNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "animationsequence" )
-		{
-			TiXmlElement *animNameNode = node->FirstChildElement( "animationname" );
-			TiXmlElement *startFrameNode = node->FirstChildElement( "startframe" );
-			TiXmlElement *numFramesNode = node->FirstChildElement( "numframes" );
-			TiXmlElement *fpsNode = node->FirstChildElement( "fps" );
-			if ( !animNameNode || !startFrameNode || !numFramesNode || !fpsNode )
-			{
-				cout << "[Warning] Invalid animation sequence" << endl;
-				continue;
-			}
-			
-			AnimationInfo anim;
-			string animName = animNameNode->GetText();
-			anim.startFrame = atoi( startFrameNode->GetText() );
-			anim.numFrames = atoi( numFramesNode->GetText() );
-			anim.framesPerSecond = atoi( fpsNode->GetText() );
-			
-			cout << "Adding animation '" << animName << "'" << endl;
-			dest[animName] = anim;
-		}
-	}
-
-	return true;
-}
-
-bool processMaterials( TiXmlElement *matsNode, Q3ModelToMesh &builder )
-{
-	cout << "Processing materials" << endl;
-	
-	for ( TiXmlElement *node = matsNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "material" )
-		{
-			string key, value;
-		
-			for ( TiXmlElement *child = node->FirstChildElement(); 
-				child; child = child->NextSiblingElement() )
-			{
-				const string &childName = child->ValueStr();
-				if ( childName == "submeshname" )
-				{
-					key = child->GetText();
-				}
-				else if ( childName == "materialname" )
-				{
-					value = child->GetText();
-				}
-			}
-			
-			if ( key.empty() )
-			{
-				cout << "[Warning] Material found without submesh name" << endl;
-				continue;
-			}
-			
-			cout << "Using material '" << value << "' for submesh '" << key << "'" << endl;
-			builder.setSubMeshMaterial( key, value );
-		}
-	}
-	
-	return true;
-}
-
-bool convertMD2Mesh( TiXmlElement *configNode )
-{
-	cout << "Doing MD2 Mesh conversion" << endl;
-
-	Q2ModelToMesh builder( gGlobals );
-
-	// Process the configuration XML tree
-	for ( TiXmlElement *node = configNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "inputfile" )
-		{
-			builder.setInputFile( node->GetText() );
-		}
-		else if ( nodeName == "outputfile" )
-		{
-			builder.setOutputFile( node->GetText() );
-		}
-		else if ( nodeName == "referenceframe" )
-		{
-			builder.setReferenceFrame( atoi(node->GetText()) );
-		}
-		else if ( nodeName == "animations" )
-		{
-			if ( node->FirstChildElement( "includenormals" ) )
-				builder.setIncludeNormals( true );
-
-			AnimationMap anims;
-			processAnimations( node, anims );
-			for ( AnimationMap::const_iterator iter = anims.begin(); iter != anims.end(); ++iter )
-			{
-				builder.getAnimation( iter->first ) = iter->second;
-			}
-		}
-		else if ( nodeName == "materialname" )
-		{
-			builder.setMaterial( node->GetText() );
-		}
-	}
-	
-	if ( !builder.build() )
-	{
-		cout << "[Error] Failed to convert MD2 file" << endl;
-		return false;
-	}
-	
-	return true;
-}
-
-bool convertMD3Mesh( TiXmlElement *configNode )
-{
-	cout << "Doing MD3 Mesh conversion" << endl;
-	
-	Q3ModelToMesh builder( gGlobals );
-	
-	// Process the configuration XML tree
-	for ( TiXmlElement *node = configNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "inputfile" )
-		{
-			builder.setInputFile( node->GetText() );
-		}
-		else if ( nodeName == "outputfile" )
-		{
-			builder.setOutputFile( node->GetText() );
-		}
-		else if ( nodeName == "referenceframe" )
-		{
-			builder.setReferenceFrame( atoi( node->GetText() ) );
-		}
-		else if ( nodeName == "animationfile" )
-		{
-			if ( node->FirstChildElement( "includenormals" ) )
-				builder.setIncludeNormals( true );
-
-			if ( !processAnimationFile( node, builder ) )
-				cout << "[Warning] Failed to process animation file" << endl;
-		}
-		else if ( nodeName == "animations" )
-		{
-			if ( node->FirstChildElement( "includenormals" ) )
-				builder.setIncludeNormals( true );
-
-			AnimationMap anims;
-			processAnimations( node, anims );
-			for ( AnimationMap::const_iterator iter = anims.begin(); iter != anims.end(); ++iter )
-			{
-				builder.getAnimation( iter->first ) = iter->second;
-			}
-		}
-		else if ( nodeName == "materials" )
-		{
-			processMaterials( node, builder );
-		}
-	}
-	
-	if ( !builder.build() )
-	{
-		cout << "[Error] Failed to convert MD3 file" << endl;
-		return false;
-	}
-	
-	return true;
-}
-
-void processSubMesh( TiXmlElement *subMeshNode, MD5ModelToMesh &builder )
-{
-	int index = -1;
-	if ( !subMeshNode->Attribute( "index", &index ) )
-	{
-		cout << "[Warning] Submesh with no index" << endl;
-		return;
-	}
-
-	MD5ModelToMesh::SubMeshInfo &smInfo = builder.getSubMesh( index );
-
-	const char *name;
-	if ( (name = subMeshNode->Attribute( "name" )) )
-	{
-		smInfo.name = name;
-	}
-
-	for ( TiXmlElement *node = subMeshNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "materialname" )
-		{
-			smInfo.material = node->GetText();
-		}
-	}
-}
-
-void processSubMeshes( TiXmlElement *subMeshesNode, MD5ModelToMesh &builder )
-{
-	int maxWeights;
-	if ( subMeshesNode->Attribute( "maxweights", &maxWeights ) )
-		builder.setMaxWeights( maxWeights );
-
-	for ( TiXmlElement *node = subMeshesNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "submesh" )
-		{
-			processSubMesh( node, builder );
-		}
-	}
-}
-
-void processMD5Animation( TiXmlElement *animNode, MD5ModelToMesh &builder )
-{
-	const char *name;
-	if ( !(name = animNode->Attribute( "name" )) )
-	{
-		cout << "[Warning] MD5 Animation without a name" << endl;
-		return;
-	}
-
-	string inputfile;
-	bool lockRoot = false;
-	for ( TiXmlElement *node = animNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "inputfile" )
-		{
-			inputfile = node->GetText();
-		}
-		else if ( nodeName == "lockroot" )
-		{
-			lockRoot = true;
-		}
-	}
-
-	if ( inputfile.empty() )
-	{
-		cout << "[Warning] MD5 Animation '" << (*name) << "' missing input file" << endl;
-		return;
-	}
-
-	MD5ModelToMesh::AnimationInfo &anim = builder.getAnimation( name );
-	anim.inputFile = inputfile;
-	anim.lockRoot = lockRoot;
-	
-	int fps;
-	if ( animNode->Attribute( "changefps", &fps ) )
-		anim.fps = fps;
-}
-
-void processMD5Skeleton( TiXmlElement *skelNode, MD5ModelToMesh &builder )
-{
-	const char *name;
-	if ( !(name = skelNode->Attribute( "name" )) )
-	{
-		cout << "[Warning] MD5 Skeleton without a name" << endl;
-		return;
-	}
-	builder.setSkeletonName( name );
-
-	const char *originBone;
-	if ( (originBone = skelNode->Attribute( "moveorigin" )) )
-		builder.setOriginBone( originBone );
-
-	for ( TiXmlElement *node = skelNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "md5anim" )
-		{
-			processMD5Animation( node, builder );
-		}
-	}
-}
-
-bool convertMD5Mesh( TiXmlElement *configNode )
-{
-	cout << "Doing MD5 Mesh conversion" << endl;
-	
-	MD5ModelToMesh builder( gGlobals );
-
-	// Process the configuration XML tree
-	for ( TiXmlElement *node = configNode->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "inputfile" )
-		{
-			builder.setInputFile( node->GetText() );
-		}
-		else if ( nodeName == "outputfile" )
-		{
-			builder.setOutputFile( node->GetText() );
-		}
-		else if ( nodeName == "submeshes" )
-		{
-			processSubMeshes( node, builder );
-		}
-		else if ( nodeName == "md5skeleton" )
-		{
-			processMD5Skeleton( node, builder );
-		}
-	}
-	
-	if ( !builder.build() )
-	{
-		cout << "[Error] Failed to convert MD5 file" << endl;
-		return false;
-	}
-	
-	return true;
-}
-
-// Returns file name without path
-static string changeToWorkingDir( string filepath )
-{
-	// fnsplit() isn't available on Windows, so we'll have to dissect the file path ourselves...
-	size_t drivePos = filepath.find_first_of( ':' );
-	if ( drivePos != string::npos )
-	{
-		// Change drive
-		char driveLetter = filepath[0];
-		int driveNumber = toupper(driveLetter) - 'A' + 1;
-		_chdrive( driveNumber );
-
-		filepath = filepath.substr( drivePos + 1 );
-	}
-
-	size_t pathPos = filepath.find_last_of( "\\/" );
-	if ( pathPos != string::npos )
-	{
-		// Change working dir
-		string dir = filepath.substr( 0, pathPos );
-		_chdir( dir.c_str() );
-
-		filepath = filepath.substr( pathPos + 1 );
-	}
-
-	return filepath;
-}
-
-bool processConfigFile( const string &filepath )
-{
-	// Change working directory to script file's local directory
-	string filename = changeToWorkingDir( filepath );
-	cout << "Loading configuration from file '" << filename << "'" << endl;
-
-	TiXmlDocument config;
-	if ( !config.LoadFile( filename ) )
-	{
-		cout << "[Error] Could not load configuration from file '" << filename << "', reason:" 
-			<< endl << "Error " << config.ErrorId() << " on row " << config.ErrorRow() 
-			<< " column " << config.ErrorCol() << ":" << endl << config.ErrorDesc() << endl;
-		return false;
-	}
-	
-	TiXmlElement *root = config.RootElement();
-	if ( !root || root->ValueStr() != "quake2ogre" )
-	{
-		cout << "[Error] This is not a valid QuakeToOgre configuration file" << endl;
-		return false;
-	}
-	
-	gGlobals.convertCoords = root->FirstChildElement( "convertcoordinates" ) ? true : false;
-	bool success = false;
-	
-	for ( TiXmlElement *node = root->FirstChildElement(); node; node = node->NextSiblingElement() )
-	{			
-		const string &nodeName = node->ValueStr();
-		if ( nodeName == "md2mesh" )
-		{
-			success = convertMD2Mesh( node );
-		}
-		else if ( nodeName == "md3mesh" )
-		{
-			success = convertMD3Mesh( node );
-		}
-		else if ( nodeName == "md5mesh" )
-		{
-			success = convertMD5Mesh( node );
-		}
-	}
-	
-	if ( success )
-	{
-		cout << "Conversion succeeded!" << endl;
-		return true;
-	}
-	else
-	{
-		cout << "Conversion failed..." << endl;
-		return false;
-	}
-}
-
-void printUsage()
-{
-	cout << "Usage:" << endl;
-	cout << "QuakeToOgre [config file]" << endl;
-	cout << "QuakeToOgre -i [mesh file]" << endl;
-}
-
-int main( int argc, char **argv )
-{
-	if ( argc < 2 )
-	{
-		printUsage();
-		return 1;
-	}
-	
-	if ( !strcmp( argv[1], "-i" ) )
-	{
-		if ( argc < 3 )
-		{
-			printUsage();
-			return 1;
-		}
-		
-		MD2Model md2model;
-		MD3Model md3model;
-		if ( md2model.load( argv[2] ) )
-		{
-			md2model.printInfo();
-			return 0;
-		}
-		else if ( md3model.load( argv[2] ) )
-		{
-			md3model.printInfo();
-			return 0;
-		}
-		else if ( MD5ModelToMesh::isMD5Mesh( argv[2] ) || MD5ModelToMesh::isMD5Anim( argv[2] ) )
-		{
-			MD5ModelToMesh::printInfo( argv[2] );
-			return 0;
-		}
-		else
-		{
-			cout << "[Error] Unknown mesh file format" << endl;
-			return 1;
-		}
-	}
-	else
-	{
-		string filepath = argv[1];
-		return processConfigFile( filepath ) ? 0 : 1;
-	}
-}
+*/
+#include "Common.h"
+#include "ModelInfo.h"
+#include "Converter.h"
+#include "Storage.h"
+#include "UringStorage.h"
+#include "Server.h"
+#include "ThreadPool.h"
+#include "Scanner.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
+#include "TraceLog.h"
+#include "ConversionStats.h"
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#define _chdir chdir
+void _chdrive( int ) {}
+#endif
+
+// Returns file name without path
+static string changeToWorkingDir( string filepath )
+{
+	// fnsplit() isn't available on Windows, so we'll have to dissect the file path ourselves...
+	size_t drivePos = filepath.find_first_of( ':' );
+	if ( drivePos != string::npos )
+	{
+		// Change drive
+		char driveLetter = filepath[0];
+		int driveNumber = toupper(driveLetter) - 'A' + 1;
+		_chdrive( driveNumber );
+
+		filepath = filepath.substr( drivePos + 1 );
+	}
+
+	size_t pathPos = filepath.find_last_of( "\\/" );
+	if ( pathPos != string::npos )
+	{
+		// Change working dir
+		string dir = filepath.substr( 0, pathPos );
+		_chdir( dir.c_str() );
+
+		filepath = filepath.substr( pathPos + 1 );
+	}
+
+	return filepath;
+}
+
+static bool convertConfigFile( const string &filepath, InputSource &input, OutputSink &output,
+	ostream &logStream, LogLevel logLevel, Profiler *profiler, ConversionStats *stats )
+{
+	ThreadPool workers;
+
+	Converter converter( input, output, &logStream );
+	converter.setLogLevel( logLevel );
+	converter.setProfiler( profiler );
+	converter.setStats( stats );
+	converter.setWorkers( &workers );
+	ostream &log = converter.getLog();
+
+	// Change working directory to script file's local directory
+	string filename = changeToWorkingDir( filepath );
+	log << "Loading configuration from file '" << filename << "'" << endl;
+
+	string config;
+	if ( !input.read( filename, config ) )
+	{
+		log << "[Error] Could not load configuration from file '" << filename << "'" << endl;
+		return false;
+	}
+
+	return converter.convert( config );
+}
+
+bool processConfigFile( const string &filepath, ostream &logStream, LogLevel logLevel, Profiler *profiler, 
+	ConversionStats *stats, bool useUring )
+{
+	// Read the next mesh's files and write the previous mesh's outputs while converting,
+	// through io_uring where the kernel provides it and with helper threads otherwise
+	if ( useUring && UringInputSource::isSupported() )
+	{
+		UringInputSource input;
+		UringOutputSink output;
+		return convertConfigFile( filepath, input, output, logStream, logLevel, profiler, stats );
+	}
+
+	FileInputSource fileInput;
+	FileOutputSink fileOutput;
+	PrefetchInputSource input( fileInput );
+	BackgroundOutputSink output( fileOutput );
+	return convertConfigFile( filepath, input, output, logStream, logLevel, profiler, stats );
+}
+
+void printUsage()
+{
+	cout << "Usage:" << endl;
+	cout << "QuakeToOgre [options] [config file]" << endl;
+	cout << "QuakeToOgre -i [mesh file]" << endl;
+	cout << "QuakeToOgre --serve [socket path] [-j threads] [--trace file]" << endl;
+	cout << "QuakeToOgre --scan [directory] [-j threads]" << endl;
+	cout << "Options:" << endl;
+	cout << "  --quiet                only print warnings and errors" << endl;
+	cout << "  --debug                also print every frame that is converted" << endl;
+	cout << "  --profile              print the time spent in each conversion phase" << endl;
+	cout << "  --profile-json [file]  also write the timings to a JSON file" << endl;
+	cout << "  --memory               add allocation counts and peak memory use to the profile" << endl;
+	cout << "  --trace [file]         write a Chrome trace of every job and phase, per thread" << endl;
+	cout << "  --stats json           print the sizes, counts and throughput of each converted asset" << endl;
+	cout << "  --stats-file [file]    write these statistics to a file instead" << endl;
+	cout << "  --io threads           read and write files with helper threads instead of io_uring" << endl;
+}
+
+int main( int argc, char **argv )
+{
+	if ( argc < 2 )
+	{
+		printUsage();
+		return 1;
+	}
+	
+	if ( !strcmp( argv[1], "-i" ) )
+	{
+		if ( argc < 3 )
+		{
+			printUsage();
+			return 1;
+		}
+		
+		FileInputSource input;
+		string data;
+		if ( !input.read( argv[2], data ) )
+		{
+			cout << "[Error] Could not load mesh file '" << argv[2] << "'" << endl;
+			return 1;
+		}
+
+		ModelInfo info;
+		if ( !info.read( data.data(), data.size(), argv[2] ) )
+		{
+			if ( info.format == ModelInfo::FORMAT_UNKNOWN )
+				cout << "[Error] Unknown mesh file format" << endl;
+			else
+				cout << "[Error] Invalid " << ModelInfo::getFormatName( info.format ) << " file" << endl;
+			return 1;
+		}
+
+		info.print( cout );
+		return 0;
+	}
+	else if ( !strcmp( argv[1], "--serve" ) )
+	{
+		if ( argc < 3 )
+		{
+			printUsage();
+			return 1;
+		}
+
+		int numThreads = 0;
+		string traceFile;
+		for ( int arg = 3; arg < argc; arg++ )
+		{
+			if ( !strcmp( argv[arg], "-j" ) && arg + 1 < argc )
+				numThreads = atoi( argv[++arg] );
+			else if ( !strcmp( argv[arg], "--trace" ) && arg + 1 < argc )
+				traceFile = argv[++arg];
+			else
+			{
+				printUsage();
+				return 1;
+			}
+		}
+
+		ofstream traceStream;
+		if ( !traceFile.empty() )
+		{
+			traceStream.open( traceFile.c_str() );
+			if ( !traceStream )
+			{
+				cout << "[Error] Could not open trace file '" << traceFile << "'" << endl;
+				return 1;
+			}
+		}
+
+		TraceLog traceLog;
+		Server server( argv[2], numThreads );
+		if ( traceStream.is_open() )
+			server.setTraceLog( &traceLog );
+
+		bool success = server.run();
+		if ( traceStream.is_open() )
+			traceLog.write( traceStream );
+
+		return success ? 0 : 1;
+	}
+	else if ( !strcmp( argv[1], "--scan" ) )
+	{
+		if ( argc < 3 )
+		{
+			printUsage();
+			return 1;
+		}
+
+		int numThreads = 0;
+		if ( argc == 5 && !strcmp( argv[3], "-j" ) )
+			numThreads = atoi( argv[4] );
+		else if ( argc != 3 )
+		{
+			printUsage();
+			return 1;
+		}
+
+		Scanner scanner( argv[2], numThreads );
+		return scanner.run( cout ) ? 0 : 1;
+	}
+	else
+	{
+		LogLevel logLevel = LOG_INFO;
+		bool profile = false;
+		bool trackMemory = false;
+		string profileFile;
+		string traceFile;
+		bool stats = false;
+		string statsFile;
+		bool useUring = true;
+
+		// Options come before the configuration file
+		int arg = 1;
+		for ( ; arg < argc && argv[arg][0] == '-'; arg++ )
+		{
+			if ( !strcmp( argv[arg], "--quiet" ) )
+			{
+				logLevel = LOG_QUIET;
+			}
+			else if ( !strcmp( argv[arg], "--debug" ) )
+			{
+				logLevel = LOG_DEBUG;
+			}
+			else if ( !strcmp( argv[arg], "--profile" ) )
+			{
+				profile = true;
+			}
+			else if ( !strcmp( argv[arg], "--memory" ) )
+			{
+				profile = true;
+				trackMemory = true;
+			}
+			else if ( !strcmp( argv[arg], "--profile-json" ) && arg + 1 < argc )
+			{
+				profile = true;
+				profileFile = argv[++arg];
+			}
+			else if ( !strcmp( argv[arg], "--trace" ) && arg + 1 < argc )
+			{
+				traceFile = argv[++arg];
+			}
+			else if ( !strcmp( argv[arg], "--stats" ) && arg + 1 < argc && !strcmp( argv[arg + 1], "json" ) )
+			{
+				stats = true;
+				arg++;
+			}
+			else if ( !strcmp( argv[arg], "--stats-file" ) && arg + 1 < argc )
+			{
+				stats = true;
+				statsFile = argv[++arg];
+			}
+			else if ( !strcmp( argv[arg], "--io" ) && arg + 1 < argc && !strcmp( argv[arg + 1], "uring" ) )
+			{
+				useUring = true;
+				arg++;
+			}
+			else if ( !strcmp( argv[arg], "--io" ) && arg + 1 < argc && !strcmp( argv[arg + 1], "threads" ) )
+			{
+				useUring = false;
+				arg++;
+			}
+			else
+			{
+				printUsage();
+				return 1;
+			}
+		}
+
+		if ( arg != argc - 1 )
+		{
+			printUsage();
+			return 1;
+		}
+
+		// Open the report files before processConfigFile changes the working directory
+		ofstream profileStream;
+		if ( !profileFile.empty() )
+		{
+			profileStream.open( profileFile.c_str() );
+			if ( !profileStream )
+			{
+				cout << "[Error] Could not open profile file '" << profileFile << "'" << endl;
+				return 1;
+			}
+		}
+
+		ofstream traceStream;
+		if ( !traceFile.empty() )
+		{
+			traceStream.open( traceFile.c_str() );
+			if ( !traceStream )
+			{
+				cout << "[Error] Could not open trace file '" << traceFile << "'" << endl;
+				return 1;
+			}
+		}
+
+		ofstream statsStream;
+		if ( !statsFile.empty() )
+		{
+			statsStream.open( statsFile.c_str() );
+			if ( !statsStream )
+			{
+				cout << "[Error] Could not open statistics file '" << statsFile << "'" << endl;
+				return 1;
+			}
+		}
+
+		TraceLog traceLog;
+		// The allocation hooks only record anything from here on, and only with --memory
+		AllocationTracker::setEnabled( trackMemory );
+
+		Profiler profiler;
+		profiler.setTrackMemory( trackMemory );
+		if ( traceStream.is_open() )
+			profiler.setTraceLog( &traceLog );
+
+		// When the statistics go to stdout, everything else goes to stderr so the JSON can be parsed
+		ostream &logStream = (stats && !statsStream.is_open() ? cerr : cout);
+
+		string filepath = argv[arg];
+		ConversionStats conversionStats;
+		bool success = processConfigFile( filepath, logStream, logLevel, profile || traceStream.is_open() ? &profiler : NULL,
+			stats ? &conversionStats : NULL, useUring );
+
+		if ( profile )
+		{
+			logStream << endl;
+			profiler.printTable( logStream );
+			if ( profileStream.is_open() )
+				profiler.writeJSON( profileStream );
+		}
+
+		if ( traceStream.is_open() )
+			traceLog.write( traceStream );
+
+		if ( statsStream.is_open() )
+			conversionStats.writeJSON( statsStream );
+		else if ( stats )
+			conversionStats.writeJSON( cout );
+
+		return success ? 0 : 1;
+	}
+}
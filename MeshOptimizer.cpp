@@ -0,0 +1,451 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "MeshOptimizer.h"
+
+// Forsyth's tuning values, see "Linear-Speed Vertex Cache Optimisation"
+static const int CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+static const int MAX_VALENCE = 32;	// Valences above this all get the same (tiny) boost
+
+class VertexScoreTable
+{
+public:
+	VertexScoreTable()
+	{
+		for ( int position = -1; position < CACHE_SIZE; position++ )
+		{
+			for ( int valence = 0; valence <= MAX_VALENCE; valence++ )
+				mScores[position + 1][valence] = computeScore( position, valence );
+		}
+	}
+
+	float get( int cachePosition, int valence ) const
+	{
+		return mScores[cachePosition + 1][min( valence, MAX_VALENCE )];
+	}
+
+private:
+	static float computeScore( int cachePosition, int valence )
+	{
+		// Vertices without any triangles left should never draw a triangle to them
+		if ( valence == 0 )
+			return -1.0f;
+
+		float score = 0.0f;
+		if ( cachePosition >= 0 && cachePosition < 3 )
+		{
+			// Used by the last triangle, which doesn't help the next one as much as it seems
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else if ( cachePosition >= 3 )
+		{
+			float scaler = 1.0f / (CACHE_SIZE - 3);
+			score = powf( 1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER );
+		}
+
+		// Favour vertices with few triangles left, so that lone triangles don't get left behind
+		score += VALENCE_BOOST_SCALE * powf( (float)valence, -VALENCE_BOOST_POWER );
+		return score;
+	}
+
+	float mScores[CACHE_SIZE + 1][MAX_VALENCE + 1];
+};
+
+void MeshOptimizer::optimizeVertexCache( IndexList &indices, int numVertices )
+{
+	static const VertexScoreTable scoreTable;
+
+	int numTriangles = (int)indices.size() / 3;
+	if ( numTriangles < 2 || numVertices <= 0 )
+		return;
+
+	// Triangles using each vertex; the first valence[v] of them haven't been emitted yet
+	vector<int> valence( numVertices, 0 );
+	for ( size_t i = 0; i < (size_t)numTriangles * 3; i++ )
+		valence[indices[i]]++;
+
+	vector<int> firstTriangle( numVertices + 1, 0 );
+	for ( int v = 0; v < numVertices; v++ )
+		firstTriangle[v + 1] = firstTriangle[v] + valence[v];
+
+	vector<int> adjacency( firstTriangle[numVertices] );
+	vector<int> fill( firstTriangle.begin(), firstTriangle.end() - 1 );
+	for ( int t = 0; t < numTriangles; t++ )
+	{
+		for ( int k = 0; k < 3; k++ )
+			adjacency[fill[indices[t * 3 + k]]++] = t;
+	}
+
+	vector<int> cachePosition( numVertices, -1 );
+	vector<float> vertexScore( numVertices );
+	for ( int v = 0; v < numVertices; v++ )
+		vertexScore[v] = scoreTable.get( -1, valence[v] );
+
+	vector<bool> emitted( numTriangles, false );
+
+	IndexList result;
+	result.reserve( numTriangles * 3 );
+
+	vector<int> cache, newCache;
+	cache.reserve( CACHE_SIZE + 3 );
+	newCache.reserve( CACHE_SIZE + 3 );
+
+	int bestTriangle = -1;
+	int nextUnemitted = 0;
+
+	for ( int n = 0; n < numTriangles; n++ )
+	{
+		// Nothing in the cache is connected to anything left, carry on with the next triangle in the input
+		if ( bestTriangle < 0 )
+		{
+			while ( emitted[nextUnemitted] )
+				nextUnemitted++;
+			bestTriangle = nextUnemitted;
+		}
+
+		const int *tri = &indices[bestTriangle * 3];
+		result.insert( result.end(), tri, tri + 3 );
+		emitted[bestTriangle] = true;
+
+		// Move the triangle to the back of each vertex's list, out of the range that is still to be emitted
+		for ( int k = 0; k < 3; k++ )
+		{
+			int v = tri[k];
+			int *first = &adjacency[firstTriangle[v]];
+			int *last = first + valence[v] - 1;
+			*std::find( first, last + 1, bestTriangle ) = *last;
+			*last = bestTriangle;
+			valence[v]--;
+		}
+
+		// The triangle's vertices go to the front of the cache, followed by the rest of the old cache
+		newCache.assign( tri, tri + 3 );
+		for ( size_t i = 0; i < cache.size(); i++ )
+		{
+			int v = cache[i];
+			if ( v != tri[0] && v != tri[1] && v != tri[2] )
+				newCache.push_back( v );
+		}
+		cache.swap( newCache );
+
+		// Rescore the cached vertices, and those that just dropped out of the cache
+		for ( size_t i = 0; i < cache.size(); i++ )
+		{
+			int v = cache[i];
+			cachePosition[v] = (i < (size_t)CACHE_SIZE) ? (int)i : -1;
+			vertexScore[v] = scoreTable.get( cachePosition[v], valence[v] );
+		}
+
+		// The next triangle is the best one that uses a cached vertex
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for ( size_t i = 0; i < cache.size(); i++ )
+		{
+			int v = cache[i];
+			for ( int j = 0; j < valence[v]; j++ )
+			{
+				int t = adjacency[firstTriangle[v] + j];
+				const int *other = &indices[t * 3];
+				float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+				if ( score > bestScore )
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if ( cache.size() > (size_t)CACHE_SIZE )
+			cache.resize( CACHE_SIZE );
+	}
+
+	indices.swap( result );
+}
+
+// Loads the triangle's vertices into a FIFO cache of timestamps, returns the number of misses
+static int updateCache( const int *triangle, int cacheSize, vector<int> &timestamps, int &time )
+{
+	int numMisses = 0;
+	for ( int k = 0; k < 3; k++ )
+	{
+		int &timestamp = timestamps[triangle[k]];
+		if ( time - timestamp > cacheSize )
+		{
+			timestamp = time++;
+			numMisses++;
+		}
+	}
+	return numMisses;
+}
+
+void MeshOptimizer::optimizeOverdraw( IndexList &indices, const vector<Vector3> &positions, float threshold )
+{
+	static const int OVERDRAW_CACHE_SIZE = 16;
+
+	int numTriangles = (int)indices.size() / 3;
+	if ( numTriangles < 2 )
+		return;
+
+	// A triangle missing all of its vertices starts on a new patch of the mesh
+	vector<int> timestamps( positions.size(), 0 );
+	int time = OVERDRAW_CACHE_SIZE + 1;
+	vector<int> hardBoundaries;
+	for ( int t = 0; t < numTriangles; t++ )
+	{
+		int numMisses = updateCache( &indices[t * 3], OVERDRAW_CACHE_SIZE, timestamps, time );
+		if ( t == 0 || numMisses == 3 )
+			hardBoundaries.push_back( t );
+	}
+	hardBoundaries.push_back( numTriangles );
+
+	// Split each patch into clusters that are just long enough to reach the patch's ACMR again
+	vector<int> boundaries;
+	for ( size_t c = 0; c + 1 < hardBoundaries.size(); c++ )
+	{
+		int start = hardBoundaries[c];
+		int end = hardBoundaries[c + 1];
+
+		time += OVERDRAW_CACHE_SIZE + 1;
+		int numMisses = 0;
+		for ( int t = start; t < end; t++ )
+			numMisses += updateCache( &indices[t * 3], OVERDRAW_CACHE_SIZE, timestamps, time );
+		float targetACMR = threshold * (float)numMisses / (float)(end - start);
+
+		boundaries.push_back( start );
+		time += OVERDRAW_CACHE_SIZE + 1;
+		int runningMisses = 0;
+		int runningTriangles = 0;
+		for ( int t = start; t < end; t++ )
+		{
+			runningMisses += updateCache( &indices[t * 3], OVERDRAW_CACHE_SIZE, timestamps, time );
+			runningTriangles++;
+			if ( (float)runningMisses / (float)runningTriangles <= targetACMR )
+			{
+				boundaries.push_back( t + 1 );
+				time += OVERDRAW_CACHE_SIZE + 1;
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+
+		// Whatever is left at the end would make a poor cluster, so it joins the last complete one
+		if ( boundaries.back() != start )
+			boundaries.pop_back();
+	}
+	boundaries.push_back( numTriangles );
+
+	Vector3 meshCentroid;
+	for ( size_t i = 0; i < indices.size(); i++ )
+		meshCentroid += positions[indices[i]];
+	meshCentroid *= 1.0f / (float)indices.size();
+
+	// Area weighted centroid and normal of each cluster
+	int numClusters = (int)boundaries.size() - 1;
+	vector< pair<float, int> > sortKeys( numClusters );
+	for ( int c = 0; c < numClusters; c++ )
+	{
+		Vector3 centroid, normal;
+		float area = 0.0f;
+		for ( int t = boundaries[c]; t < boundaries[c + 1]; t++ )
+		{
+			const Vector3 &p0 = positions[indices[t * 3 + 0]];
+			const Vector3 &p1 = positions[indices[t * 3 + 1]];
+			const Vector3 &p2 = positions[indices[t * 3 + 2]];
+			Vector3 faceNormal = (p1 - p0).crossProduct( p2 - p0 );
+			float faceArea = sqrtf( faceNormal.dotProduct( faceNormal ) );
+
+			centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		if ( area > 0.0f )
+			centroid *= 1.0f / area;
+		normal.normalise();
+
+		// Sorted descending, while keeping the order of equal clusters
+		sortKeys[c] = make_pair( -(centroid - meshCentroid).dotProduct( normal ), c );
+	}
+	std::stable_sort( sortKeys.begin(), sortKeys.end() );
+
+	IndexList result;
+	result.reserve( indices.size() );
+	for ( int i = 0; i < numClusters; i++ )
+	{
+		int c = sortKeys[i].second;
+		result.insert( result.end(), indices.begin() + boundaries[c] * 3, indices.begin() + boundaries[c + 1] * 3 );
+	}
+
+	indices.swap( result );
+}
+
+void MeshOptimizer::optimizeVertexFetch( IndexList &indices, int numVertices, IndexList &vertexOrder )
+{
+	vector<int> newIndices( numVertices, -1 );
+	vertexOrder.clear();
+	vertexOrder.reserve( numVertices );
+
+	for ( size_t i = 0; i < indices.size(); i++ )
+	{
+		int &index = indices[i];
+		if ( newIndices[index] < 0 )
+		{
+			newIndices[index] = (int)vertexOrder.size();
+			vertexOrder.push_back( index );
+		}
+		index = newIndices[index];
+	}
+
+	for ( int v = 0; v < numVertices; v++ )
+	{
+		if ( newIndices[v] < 0 )
+			vertexOrder.push_back( v );
+	}
+}
+
+// Returns the corner of the triangle at which the edge from a to b starts, or -1 if it has no such edge
+static int findEdge( const int *triangle, int a, int b )
+{
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( triangle[i] == a && triangle[(i + 1) % 3] == b )
+			return i;
+	}
+	return -1;
+}
+
+// Counts the triangles from index i on that continue a strip of the given size ending in a, b
+static int countContinuing( const IndexList &indices, size_t i, int a, int b, size_t size )
+{
+	int count = 0;
+	for ( ; i + 2 < indices.size(); i += 3, size++, count++ )
+	{
+		const int *triangle = &indices[i];
+		int corner = (size % 2 == 0) ? findEdge( triangle, a, b ) : findEdge( triangle, b, a );
+		if ( corner < 0 )
+			break;
+
+		a = b;
+		b = triangle[(corner + 2) % 3];
+	}
+	return count;
+}
+
+void MeshOptimizer::convertToStrip( const IndexList &indices, IndexList &strip )
+{
+	strip.clear();
+
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		const int *triangle = &indices[i];
+
+		// A strip's triangles alternate in winding: appending x makes (a, b, x) after an even
+		// number of indices and (b, a, x) after an odd number, where a and b are the last two
+		size_t size = strip.size();
+		if ( size >= 2 )
+		{
+			int a = strip[size - 2], b = strip[size - 1];
+			int corner = (size % 2 == 0) ? findEdge( triangle, a, b ) : findEdge( triangle, b, a );
+			if ( corner >= 0 )
+			{
+				strip.push_back( triangle[(corner + 2) % 3] );
+				continue;
+			}
+		}
+
+		// Start a new run on the corner and parity that the most of the next triangles continue.
+		// Triangles wound against the strip's order need the run to start on an odd index.
+		int run[3] = { 0, 0, 0 };
+		size_t runParity = 0;
+		int bestCount = -1;
+		for ( size_t parity = 0; parity < 2; parity++ )
+		{
+			for ( int corner = 0; corner < 3; corner++ )
+			{
+				int first = triangle[(corner + parity) % 3], second = triangle[(corner + 1 - parity) % 3];
+				int third = triangle[(corner + 2) % 3];
+				int count = countContinuing( indices, i + 3, second, third, parity + 3 );
+				if ( count > bestCount )
+				{
+					run[0] = first; run[1] = second; run[2] = third;
+					runParity = parity;
+					bestCount = count;
+				}
+			}
+		}
+
+		// Runs are joined by degenerate triangles, repeating the last index and the run's first
+		if ( !strip.empty() )
+			strip.push_back( strip.back() );
+		if ( !strip.empty() || runParity != 0 )
+			strip.push_back( run[0] );
+		if ( strip.size() % 2 != runParity )
+			strip.push_back( run[0] );
+
+		strip.insert( strip.end(), run, run + 3 );
+	}
+}
+
+void MeshOptimizer::appendIndices( IndexList &dest, const IndexList &src, int offset )
+{
+	dest.reserve( dest.size() + src.size() );
+	for ( size_t i = 0; i < src.size(); i++ )
+		dest.push_back( src[i] + offset );
+}
+
+void MeshOptimizer::remapIndices( IndexList &indices, const IndexList &vertexOrder )
+{
+	IndexList newIndices( vertexOrder.size() );
+	for ( size_t i = 0; i < vertexOrder.size(); i++ )
+		newIndices[vertexOrder[i]] = (int)i;
+
+	for ( size_t i = 0; i < indices.size(); i++ )
+		indices[i] = newIndices[indices[i]];
+}
+
+float MeshOptimizer::computeACMR( const IndexList &indices, int numVertices, int cacheSize )
+{
+	int numTriangles = (int)indices.size() / 3;
+	if ( numTriangles == 0 || numVertices <= 0 )
+		return 0.0f;
+
+	// A vertex is still in the FIFO if fewer than cacheSize vertices were loaded after it
+	vector<int> loadedAt( numVertices, -cacheSize - 1 );
+	int numMisses = 0;
+	for ( size_t i = 0; i < (size_t)numTriangles * 3; i++ )
+	{
+		int v = indices[i];
+		if ( numMisses - loadedAt[v] > cacheSize )
+		{
+			loadedAt[v] = numMisses;
+			numMisses++;
+		}
+	}
+
+	return (float)numMisses / (float)numTriangles;
+}
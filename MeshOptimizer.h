@@ -0,0 +1,85 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __MESHOPTIMIZER_H__
+#define __MESHOPTIMIZER_H__
+
+#include "Common.h"
+#include "vector.h"
+
+typedef vector<int> IndexList;
+
+/**
+Reorders the index buffers of the converted submeshes for faster rendering. Index
+lists hold three vertex indices per triangle, in the order the builders emit them,
+so front faces are wound counter-clockwise.
+*/
+class MeshOptimizer
+{
+public:
+	/**
+	Reorders the triangles for the GPU's post-transform vertex cache, using Tom Forsyth's
+	linear-speed algorithm: each step emits the triangle whose vertices are most recently
+	used and have the fewest triangles left. The vertices of each triangle keep their order,
+	so the winding doesn't change.
+	*/
+	static void optimizeVertexCache( IndexList &indices, int numVertices );
+
+	/**
+	Reorders triangles so that those in front are more likely to be drawn first, whichever
+	way the mesh is viewed, letting the depth test reject more hidden pixels (Sander, Nehab
+	and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). The
+	cache-optimised index list is split into clusters wherever the cache starts afresh, and
+	further as long as every cluster's ACMR stays within threshold times that of the part it
+	was split from. The clusters are then sorted on how far they face away from the centre of
+	the mesh, which puts outward-facing clusters on the outside of the mesh first. Run
+	optimizeVertexCache first.
+	*/
+	static void optimizeOverdraw( IndexList &indices, const vector<Vector3> &positions, float threshold );
+
+	/**
+	Renumbers the vertices in the order the triangles first use them, so the GPU reads the
+	vertex buffer front to back. vertexOrder receives the old index of every new vertex;
+	vertices that no triangle uses are kept, after all the others.
+	*/
+	static void optimizeVertexFetch( IndexList &indices, int numVertices, IndexList &vertexOrder );
+
+	/**
+	Joins the triangles, in the order given, into a single triangle strip. Each triangle 
+	continues the strip when it shares the strip's last edge with the winding the strip 
+	expects next; otherwise a new run starts after degenerate triangles that repeat the last
+	index and the run's first one. Every triangle keeps its winding.
+	*/
+	static void convertToStrip( const IndexList &indices, IndexList &strip );
+
+	// Appends another index list, moving its indices up by offset for vertices stored after dest's
+	static void appendIndices( IndexList &dest, const IndexList &src, int offset );
+
+	// Renumbers another index list on the same vertices to a vertex order from optimizeVertexFetch
+	static void remapIndices( IndexList &indices, const IndexList &vertexOrder );
+
+	// Average number of cache misses per triangle for a FIFO cache of the given size
+	static float computeACMR( const IndexList &indices, int numVertices, int cacheSize = 16 );
+};
+
+#endif	// __MESHOPTIMIZER_H__
@@ -0,0 +1,537 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "MeshSimplifier.h"
+#include "XmlWriter.h"
+
+#include <cfloat>
+
+// How much more moving away from an open border costs than moving away from a surface
+static const float BORDER_WEIGHT = 10.0f;
+// Collapses may turn the remaining triangles by no more than about 75 degrees
+static const float MIN_NORMAL_COSINE = 0.25f;
+static const int MAX_PASSES = 100;
+
+enum VertexKind
+{
+	VERTEX_MANIFOLD,	// Inside the surface, may collapse onto any neighbour
+	VERTEX_BORDER,		// On an open border, may only collapse along it
+	VERTEX_LOCKED		// On a texture seam or a non-manifold edge, never collapses
+};
+
+/**
+Sum of the weighted squared distances to a set of planes, stored as the upper triangle of
+the symmetric 4x4 matrix that the planes' outer products add up to.
+*/
+struct Quadric
+{
+	float a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+
+	Quadric(): a00(0), a01(0), a02(0), a03(0), a11(0), a12(0), a13(0), a22(0), a23(0), a33(0) {}
+
+	void addPlane( const Vector3 &normal, float distance, float weight )
+	{
+		a00 += weight * normal.x * normal.x;
+		a01 += weight * normal.x * normal.y;
+		a02 += weight * normal.x * normal.z;
+		a03 += weight * normal.x * distance;
+		a11 += weight * normal.y * normal.y;
+		a12 += weight * normal.y * normal.z;
+		a13 += weight * normal.y * distance;
+		a22 += weight * normal.z * normal.z;
+		a23 += weight * normal.z * distance;
+		a33 += weight * distance * distance;
+	}
+
+	Quadric &operator+=( const Quadric &other )
+	{
+		a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+		a11 += other.a11; a12 += other.a12; a13 += other.a13;
+		a22 += other.a22; a23 += other.a23;
+		a33 += other.a33;
+		return *this;
+	}
+
+	float evaluate( const Vector3 &p ) const
+	{
+		float error = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z + a33 +
+			2.0f * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z + a03 * p.x + a13 * p.y + a23 * p.z);
+
+		// Rounding can take it just below zero
+		return fabsf( error );
+	}
+};
+
+// Orders vertices on their positions in every keyframe, so that coinciding vertices end up next to each other
+class PositionCompare
+{
+public:
+	PositionCompare( const vector<PositionList> &frames ): mFrames( frames ) {}
+
+	bool operator()( int a, int b ) const
+	{
+		for ( size_t frame = 0; frame < mFrames.size(); frame++ )
+		{
+			const Vector3 &pa = mFrames[frame][a], &pb = mFrames[frame][b];
+			for ( size_t i = 0; i < 3; i++ )
+			{
+				if ( pa[i] != pb[i] )
+					return pa[i] < pb[i];
+			}
+		}
+		return false;
+	}
+
+private:
+	const vector<PositionList> &mFrames;
+};
+
+/**
+Counts how many triangles share each edge between two positions, rather than between two
+vertices, so that edges along texture seams count as shared.
+*/
+class PositionEdges
+{
+public:
+	PositionEdges( const IndexList &indices, const IndexList &groups )
+	{
+		vector<unsigned long long> keys;
+		keys.reserve( indices.size() );
+		for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+		{
+			for ( int corner = 0; corner < 3; corner++ )
+			{
+				int a = groups[indices[i + corner]], b = groups[indices[i + (corner + 1) % 3]];
+				if ( a != b )
+					keys.push_back( makeKey( a, b ) );
+			}
+		}
+
+		sort( keys.begin(), keys.end() );
+		for ( size_t i = 0; i < keys.size(); i++ )
+		{
+			if ( mKeys.empty() || mKeys.back() != keys[i] )
+			{
+				mKeys.push_back( keys[i] );
+				mCounts.push_back( 0 );
+			}
+			mCounts.back()++;
+		}
+	}
+
+	int count( int groupA, int groupB ) const
+	{
+		unsigned long long key = makeKey( groupA, groupB );
+		vector<unsigned long long>::const_iterator iter = lower_bound( mKeys.begin(), mKeys.end(), key );
+		if ( iter == mKeys.end() || *iter != key )
+			return 0;
+
+		return mCounts[iter - mKeys.begin()];
+	}
+
+private:
+	static unsigned long long makeKey( int a, int b )
+	{
+		if ( a > b )
+			swap( a, b );
+
+		return ((unsigned long long)a << 32) | (unsigned int)b;
+	}
+
+	vector<unsigned long long> mKeys;
+	IndexList mCounts;
+};
+
+struct Collapse
+{
+	float error;
+	int from;
+	int to;
+
+	bool operator<( const Collapse &other ) const { return error < other.error; }
+};
+
+/**
+Holds the vertex classification and quadrics of one submesh while it's being simplified.
+Each pass collapses the cheapest edges it can without two collapses touching the same
+triangles, then rebuilds the adjacency, as in Arseny Kapoulkine's meshoptimizer.
+*/
+class EdgeCollapser
+{
+public:
+	EdgeCollapser( const IndexList &indices, const vector<PositionList> &frames );
+
+	// Collapses edges until about maxRemoved triangles are gone, returns how many were
+	int collapse( IndexList &indices, int maxRemoved );
+
+private:
+	void buildAdjacency( const IndexList &indices );
+	void considerCollapse( int from, int to, const PositionEdges &edges, vector<Collapse> &best ) const;
+	bool keepsOrientation( const IndexList &indices, int from, int to ) const;
+
+	const Quadric &getQuadric( int vertex, size_t frame ) const { return mQuadrics[vertex * mFrames.size() + frame]; }
+
+	const vector<PositionList> &mFrames;
+	int mNumVertices;
+
+	IndexList mGroups;		// Vertices with the same position in every frame share a group
+	vector<char> mKinds;
+	vector<Quadric> mQuadrics;	// One per vertex and frame
+
+	// Triangles around each vertex: mTriangles[mOffsets[v]] up to mTriangles[mOffsets[v + 1]]
+	IndexList mOffsets;
+	IndexList mTriangles;
+};
+
+EdgeCollapser::EdgeCollapser( const IndexList &indices, const vector<PositionList> &frames ):
+	mFrames( frames ), mNumVertices( (int)frames[0].size() )
+{
+	// Group the vertices on their positions
+	IndexList order( mNumVertices );
+	for ( int i = 0; i < mNumVertices; i++ )
+		order[i] = i;
+
+	PositionCompare compare( frames );
+	sort( order.begin(), order.end(), compare );
+
+	IndexList groupSizes;
+	mGroups.resize( mNumVertices );
+	for ( int i = 0; i < mNumVertices; i++ )
+	{
+		if ( i == 0 || compare( order[i - 1], order[i] ) )
+			groupSizes.push_back( 0 );
+
+		mGroups[order[i]] = (int)groupSizes.size() - 1;
+		groupSizes.back()++;
+	}
+
+	// Vertices sharing their position with another lie on a texture seam
+	mKinds.resize( mNumVertices );
+	for ( int i = 0; i < mNumVertices; i++ )
+		mKinds[i] = groupSizes[mGroups[i]] > 1 ? VERTEX_LOCKED : VERTEX_MANIFOLD;
+
+	PositionEdges edges( indices, mGroups );
+	vector<bool> borderEdges( indices.size(), false );
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		for ( int corner = 0; corner < 3; corner++ )
+		{
+			int a = indices[i + corner], b = indices[i + (corner + 1) % 3];
+			if ( mGroups[a] == mGroups[b] )
+				continue;
+
+			int count = edges.count( mGroups[a], mGroups[b] );
+			if ( count > 2 )
+			{
+				mKinds[a] = VERTEX_LOCKED;
+				mKinds[b] = VERTEX_LOCKED;
+			}
+			else if ( count == 1 )
+			{
+				borderEdges[i + corner] = true;
+				if ( mKinds[a] == VERTEX_MANIFOLD )
+					mKinds[a] = VERTEX_BORDER;
+				if ( mKinds[b] == VERTEX_MANIFOLD )
+					mKinds[b] = VERTEX_BORDER;
+			}
+		}
+	}
+
+	// Every triangle adds its plane, weighted by its area, in every frame
+	size_t numFrames = frames.size();
+	mQuadrics.resize( mNumVertices * numFrames );
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		for ( size_t frame = 0; frame < numFrames; frame++ )
+		{
+			const PositionList &positions = frames[frame];
+			const Vector3 &p0 = positions[indices[i]];
+
+			Vector3 normal = (positions[indices[i + 1]] - p0).crossProduct( positions[indices[i + 2]] - p0 );
+			float area = normal.normalise() * 0.5f;
+			if ( area <= 0.0f )
+				continue;
+
+			float distance = -normal.dotProduct( p0 );
+			for ( int corner = 0; corner < 3; corner++ )
+				mQuadrics[indices[i + corner] * numFrames + frame].addPlane( normal, distance, area );
+
+			// Planes through open borders, standing up from the triangle, keep the outline in place
+			for ( int corner = 0; corner < 3; corner++ )
+			{
+				if ( !borderEdges[i + corner] )
+					continue;
+
+				int a = indices[i + corner], b = indices[i + (corner + 1) % 3];
+				Vector3 edge = positions[b] - positions[a];
+				float length = edge.normalise();
+
+				Vector3 borderNormal = edge.crossProduct( normal );
+				borderNormal.normalise();
+				float borderDistance = -borderNormal.dotProduct( positions[a] );
+				float weight = length * length * BORDER_WEIGHT;
+				mQuadrics[a * numFrames + frame].addPlane( borderNormal, borderDistance, weight );
+				mQuadrics[b * numFrames + frame].addPlane( borderNormal, borderDistance, weight );
+			}
+		}
+	}
+}
+
+void EdgeCollapser::buildAdjacency( const IndexList &indices )
+{
+	mOffsets.assign( mNumVertices + 1, 0 );
+	for ( size_t i = 0; i < indices.size(); i++ )
+		mOffsets[indices[i] + 1]++;
+
+	for ( int i = 0; i < mNumVertices; i++ )
+		mOffsets[i + 1] += mOffsets[i];
+
+	IndexList fill( mOffsets.begin(), mOffsets.end() - 1 );
+	mTriangles.resize( indices.size() );
+	for ( size_t i = 0; i < indices.size(); i++ )
+		mTriangles[fill[indices[i]]++] = (int)(i / 3);
+}
+
+void EdgeCollapser::considerCollapse( int from, int to, const PositionEdges &edges, vector<Collapse> &best ) const
+{
+	if ( mKinds[from] == VERTEX_LOCKED )
+		return;
+
+	// Border vertices may only slide along the border
+	if ( mKinds[from] == VERTEX_BORDER && edges.count( mGroups[from], mGroups[to] ) != 1 )
+		return;
+
+	float error = 0.0f;
+	for ( size_t frame = 0; frame < mFrames.size(); frame++ )
+	{
+		const Vector3 &position = mFrames[frame][to];
+		error += getQuadric( from, frame ).evaluate( position ) + getQuadric( to, frame ).evaluate( position );
+	}
+
+	if ( error < best[from].error )
+	{
+		best[from].error = error;
+		best[from].to = to;
+	}
+}
+
+bool EdgeCollapser::keepsOrientation( const IndexList &indices, int from, int to ) const
+{
+	for ( int i = mOffsets[from]; i < mOffsets[from + 1]; i++ )
+	{
+		const int *triangle = &indices[mTriangles[i] * 3];
+		if ( triangle[0] == to || triangle[1] == to || triangle[2] == to )
+			continue;	// Collapses away
+
+		for ( size_t frame = 0; frame < mFrames.size(); frame++ )
+		{
+			const PositionList &positions = mFrames[frame];
+			Vector3 before[3], after[3];
+			for ( int corner = 0; corner < 3; corner++ )
+			{
+				before[corner] = positions[triangle[corner]];
+				after[corner] = positions[triangle[corner] == from ? to : triangle[corner]];
+			}
+
+			Vector3 normalBefore = (before[1] - before[0]).crossProduct( before[2] - before[0] );
+			Vector3 normalAfter = (after[1] - after[0]).crossProduct( after[2] - after[0] );
+			float lengthBefore = normalBefore.normalise();
+			float lengthAfter = normalAfter.normalise();
+			if ( lengthBefore > 0.0f && (lengthAfter <= 0.0f || normalBefore.dotProduct( normalAfter ) < MIN_NORMAL_COSINE) )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+int EdgeCollapser::collapse( IndexList &indices, int maxRemoved )
+{
+	buildAdjacency( indices );
+	PositionEdges edges( indices, mGroups );
+
+	// Find the cheapest edge every vertex can collapse along
+	Collapse none = { FLT_MAX, -1, -1 };
+	vector<Collapse> best( mNumVertices, none );
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		for ( int corner = 0; corner < 3; corner++ )
+		{
+			int a = indices[i + corner], b = indices[i + (corner + 1) % 3];
+			considerCollapse( a, b, edges, best );
+			considerCollapse( b, a, edges, best );
+		}
+	}
+
+	vector<Collapse> collapses;
+	for ( int i = 0; i < mNumVertices; i++ )
+	{
+		if ( best[i].to >= 0 )
+		{
+			best[i].from = i;
+			collapses.push_back( best[i] );
+		}
+	}
+	sort( collapses.begin(), collapses.end() );
+
+	// Collapse the cheapest edges first; once a vertex's triangles have changed it waits for the next pass
+	IndexList remap( mNumVertices );
+	for ( int i = 0; i < mNumVertices; i++ )
+		remap[i] = i;
+
+	vector<bool> locked( mNumVertices, false );
+	int removed = 0;
+	for ( size_t i = 0; i < collapses.size() && removed < maxRemoved; i++ )
+	{
+		int from = collapses[i].from, to = collapses[i].to;
+		if ( locked[from] || locked[to] || !keepsOrientation( indices, from, to ) )
+			continue;
+
+		remap[from] = to;
+		for ( int j = mOffsets[from]; j < mOffsets[from + 1]; j++ )
+		{
+			const int *triangle = &indices[mTriangles[j] * 3];
+			for ( int corner = 0; corner < 3; corner++ )
+				locked[triangle[corner]] = true;
+
+			if ( triangle[0] == to || triangle[1] == to || triangle[2] == to )
+				removed++;
+		}
+
+		for ( size_t frame = 0; frame < mFrames.size(); frame++ )
+			mQuadrics[to * mFrames.size() + frame] += getQuadric( from, frame );
+	}
+
+	// Drop the triangles that collapsed to a line
+	size_t numIndices = 0;
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+		if ( a == b || b == c || c == a )
+			continue;
+
+		indices[numIndices++] = a;
+		indices[numIndices++] = b;
+		indices[numIndices++] = c;
+	}
+
+	int numRemoved = (int)(indices.size() - numIndices) / 3;
+	indices.resize( numIndices );
+	return numRemoved;
+}
+
+void MeshSimplifier::simplify( const IndexList &indices, const vector<PositionList> &frames, 
+	const vector<LodLevel> &lodLevels, vector<IndexList> &levels )
+{
+	levels.assign( lodLevels.size(), indices );
+	if ( frames.empty() || frames[0].empty() || indices.empty() )
+		return;
+
+	// Triangle counts to reach, which never go up from one level to the next
+	int numTriangles = (int)indices.size() / 3;
+	IndexList targets( lodLevels.size() );
+	for ( size_t i = 0; i < lodLevels.size(); i++ )
+	{
+		targets[i] = (int)(numTriangles * (1.0f - lodLevels[i].reduction) + 0.5f);
+		if ( i > 0 )
+			targets[i] = min( targets[i], targets[i - 1] );
+	}
+
+	EdgeCollapser collapser( indices, frames );
+	IndexList current( indices );
+	size_t level = 0;
+	for ( int pass = 0; ; pass++ )
+	{
+		while ( level < targets.size() && (int)current.size() / 3 <= targets[level] )
+			levels[level++] = current;
+
+		if ( level == targets.size() || pass == MAX_PASSES )
+			break;
+
+		if ( collapser.collapse( current, (int)current.size() / 3 - targets[level] ) == 0 )
+			break;
+	}
+
+	// Levels beyond what the mesh could be simplified to get as far as it went
+	while ( level < targets.size() )
+		levels[level++] = current;
+}
+
+void MeshSimplifier::selectFrames( int referenceFrame, const set<int> &frames, vector<int> &selected )
+{
+	vector<int> others;
+	for ( set<int>::const_iterator iter = frames.begin(); iter != frames.end(); ++iter )
+	{
+		if ( *iter != referenceFrame )
+			others.push_back( *iter );
+	}
+
+	selected.clear();
+	selected.push_back( referenceFrame );
+
+	size_t count = min( others.size(), (size_t)MAX_FRAMES - 1 );
+	for ( size_t i = 0; i < count; i++ )
+		selected.push_back( others[i * others.size() / count] );
+}
+
+void MeshSimplifier::writeLevelOfDetail( XmlWriter &writer, const vector<LodLevel> &lodLevels, 
+	const vector< vector<IndexList> > &subMeshLevels )
+{
+	TiXmlElement *lodNode = writer.openTag( "levelofdetail" );
+	lodNode->SetAttribute( "strategy", "Distance" );
+	lodNode->SetAttribute( "numlevels", (int)lodLevels.size() + 1 );
+	lodNode->SetAttribute( "manual", "false" );
+
+	for ( size_t level = 0; level < lodLevels.size(); level++ )
+	{
+		// Ogre 1.8 and later read the distance itself, earlier versions its square
+		float distance = lodLevels[level].distance;
+		TiXmlElement *levelNode = writer.openTag( "lodgenerated" );
+		levelNode->SetAttribute( "value", StringUtil::toString( distance ) );
+		levelNode->SetAttribute( "fromdepthsquared", StringUtil::toString( distance * distance ) );
+
+		for ( size_t subMesh = 0; subMesh < subMeshLevels.size(); subMesh++ )
+		{
+			const IndexList &indices = subMeshLevels[subMesh][level];
+			TiXmlElement *faceListNode = writer.openTag( "lodfacelist" );
+			faceListNode->SetAttribute( "submeshindex", (int)subMesh );
+			faceListNode->SetAttribute( "numfaces", (int)indices.size() / 3 );
+
+			for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+			{
+				TiXmlElement *faceNode = writer.openTag( "face" );
+				faceNode->SetAttribute( "v1", indices[i] );
+				faceNode->SetAttribute( "v2", indices[i + 1] );
+				faceNode->SetAttribute( "v3", indices[i + 2] );
+				writer.closeTag();
+			}
+
+			writer.closeTag();
+		}
+
+		writer.closeTag();
+	}
+
+	writer.closeTag();
+}
@@ -0,0 +1,67 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __MESHSIMPLIFIER_H__
+#define __MESHSIMPLIFIER_H__
+
+#include "Common.h"
+#include "vector.h"
+#include "MeshOptimizer.h"
+
+class XmlWriter;
+
+typedef vector<Vector3> PositionList;
+
+/**
+Generates the reduced index buffers of automatic levels of detail. Triangles are removed
+by collapsing edges onto one of their vertices, cheapest first as measured by Garland and
+Heckbert's quadric error metric, so every level keeps using the submesh's vertex buffer.
+For morph-animated meshes the error is summed over several keyframes, so that collapses
+which only look harmless in the reference pose are avoided. Texture seams are kept intact
+and open borders only shrink along themselves.
+*/
+class MeshSimplifier
+{
+public:
+	// Most keyframes the collapse error is measured in, including the reference frame
+	static const int MAX_FRAMES = 16;
+
+	/**
+	Simplifies a submesh to every level of detail. frames holds the vertex positions of
+	each keyframe the error is measured in; the first frame is used to keep triangles from
+	flipping over. levels receives one index list per level of detail, each having at most
+	the fraction of the triangles the level's reduction leaves, unless the mesh can't be
+	simplified that far.
+	*/
+	static void simplify( const IndexList &indices, const vector<PositionList> &frames, 
+		const vector<LodLevel> &lodLevels, vector<IndexList> &levels );
+
+	// Picks the keyframes to simplify over: the reference frame and an even spread of the others
+	static void selectFrames( int referenceFrame, const set<int> &frames, vector<int> &selected );
+
+	// Writes the levelofdetail element for the index lists of every submesh and level
+	static void writeLevelOfDetail( XmlWriter &writer, const vector<LodLevel> &lodLevels, 
+		const vector< vector<IndexList> > &subMeshLevels );
+};
+
+#endif	// __MESHSIMPLIFIER_H__
@@ -0,0 +1,592 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "ModelGenerator.h"
+#include "MD2Model.h"
+#include "MD3Model.h"
+#include <cstdarg>
+
+GeneratorOptions::GeneratorOptions():
+	numVertices(1000), numTriangles(1800), numFrames(20), numSurfaces(1), numJoints(32), weightsPerVertex(2), seed(1)
+{
+}
+
+template<typename T>
+static void appendBinary( string &dest, const T *src, size_t count = 1 )
+{
+	dest.append( (const char*)src, sizeof( T ) * count );
+}
+
+static void appendText( string &dest, const char *format, ... )
+{
+	char buffer[512];
+	va_list args;
+	va_start( args, format );
+	int length = vsnprintf( buffer, sizeof( buffer ), format, args );
+	va_end( args );
+
+	if ( length > 0 )
+		dest.append( buffer, MIN( length, (int)sizeof( buffer ) - 1 ) );
+}
+
+// md5 files only store the x, y and z components of a unit quaternion, with w <= 0
+static Quaternion md5Quaternion( float x, float y, float z )
+{
+	float t = 1.0f - x * x - y * y - z * z;
+	return Quaternion( t > 0.0f ? -sqrtf( t ) : 0.0f, x, y, z );
+}
+
+static void canonicalQuaternion( Quaternion &q )
+{
+	if ( q.w > 0.0f )
+		q = Quaternion( -q.w, -q.x, -q.y, -q.z );
+}
+
+ModelGenerator::ModelGenerator( const GeneratorOptions &options ):
+	mOptions( options )
+{
+	mOptions.numVertices = MAX( mOptions.numVertices, 3 );
+	mOptions.numTriangles = MAX( mOptions.numTriangles, 1 );
+
+	// A grid has fewer than two triangles per vertex, so the search starts close to the answer
+	mOptions.numVertices = MAX( mOptions.numVertices, mOptions.numTriangles / 2 );
+	while ( gridCapacity( mOptions.numVertices ) < mOptions.numTriangles )
+		mOptions.numVertices++;
+	mOptions.numFrames = MAX( mOptions.numFrames, 1 );
+	mOptions.numSurfaces = MAX( mOptions.numSurfaces, 1 );
+	mOptions.numJoints = MAX( mOptions.numJoints, 1 );
+	mOptions.weightsPerVertex = MAX( MIN( mOptions.weightsPerVertex, mOptions.numJoints ), 1 );
+
+	reset();
+}
+
+void ModelGenerator::reset()
+{
+	// xorshift gets stuck on zero
+	mRandomState = mOptions.seed ^ 0x9E3779B9;
+	if ( !mRandomState )
+		mRandomState = 0x9E3779B9;
+
+	mPhase = random() * 6.2831853f;
+}
+
+float ModelGenerator::random()
+{
+	// xorshift32, the same sequence on every platform
+	mRandomState ^= mRandomState << 13;
+	mRandomState ^= mRandomState >> 17;
+	mRandomState ^= mRandomState << 5;
+	return (float)(mRandomState & 0xFFFFFF) / 16777216.0f;
+}
+
+int ModelGenerator::gridWidth( int numVertices )
+{
+	return MAX( (int)ceil( sqrt( (double)numVertices ) ), 2 );
+}
+
+int ModelGenerator::gridCapacity( int numVertices )
+{
+	// Every complete row of vertices but the first adds a row of quads, 
+	// the vertices of an incomplete last row add quads for all but the first of them
+	int width = gridWidth( numVertices );
+	int numRows = numVertices / width;
+	int numQuads = (width - 1) * MAX( numRows - 1, 0 ) + MAX( numVertices % width - 1, 0 );
+	return numQuads * 2;
+}
+
+Vector3 ModelGenerator::gridPosition( int vertex, int numVertices, int frame ) const
+{
+	int width = gridWidth( numVertices );
+	int height = MAX( (numVertices + width - 1) / width, 2 );
+
+	float x = (float)(vertex % width) / (float)(width - 1) * 2.0f - 1.0f;
+	float y = (float)(vertex / width) / (float)(height - 1) * 2.0f - 1.0f;
+	float z = sinf( x * 6.0f + frame * 0.25f + mPhase ) * cosf( y * 6.0f );
+
+	return Vector3( x * 32.0f, y * 32.0f, z * 4.0f );
+}
+
+void ModelGenerator::gridTexCoord( int vertex, int numVertices, float &u, float &v ) const
+{
+	int width = gridWidth( numVertices );
+	int height = MAX( (numVertices + width - 1) / width, 2 );
+
+	u = (float)(vertex % width) / (float)(width - 1);
+	v = (float)(vertex / width) / (float)(height - 1);
+}
+
+void ModelGenerator::gridTriangle( int triangle, int numVertices, int indices[3] ) const
+{
+	// The quads whose four corners exist come first in row order, and the triangle count
+	// never exceeds gridCapacity, so every corner is a vertex of the grid
+	int width = gridWidth( numVertices );
+	int quad = triangle / 2;
+	int corner = (quad / (width - 1)) * width + (quad % (width - 1));
+
+	indices[0] = corner;
+	if ( triangle % 2 == 0 )
+	{
+		indices[1] = corner + 1;
+		indices[2] = corner + width + 1;
+	}
+	else
+	{
+		indices[1] = corner + width + 1;
+		indices[2] = corner + width;
+	}
+}
+
+void ModelGenerator::buildSkeleton()
+{
+	mSkeleton.resize( mOptions.numJoints );
+	for ( int i = 0; i < mOptions.numJoints; i++ )
+	{
+		Joint &joint = mSkeleton[i];
+		if ( i == 0 )
+		{
+			joint.parent = -1;
+			joint.pos = Vector3( 0, 0, 0 );
+			joint.orient = md5Quaternion( 0, 0, 0 );
+			continue;
+		}
+
+		joint.parent = (i - 1) / 2;
+		joint.pos.x = (random() * 2.0f - 1.0f) * 4.0f;
+		joint.pos.y = (random() * 2.0f - 1.0f) * 4.0f;
+		joint.pos.z = 2.0f + random() * 2.0f;
+		joint.orient = md5Quaternion( (random() * 2.0f - 1.0f) * 0.2f, 
+			(random() * 2.0f - 1.0f) * 0.2f, (random() * 2.0f - 1.0f) * 0.2f );
+	}
+}
+
+void ModelGenerator::absoluteJoint( const vector<Joint> &joints, int index, Vector3 &pos, Quaternion &orient ) const
+{
+	const Joint &joint = joints[index];
+	if ( joint.parent < 0 )
+	{
+		pos = joint.pos;
+		orient = joint.orient;
+		return;
+	}
+
+	Vector3 parentPos;
+	Quaternion parentOrient;
+	absoluteJoint( joints, joint.parent, parentPos, parentOrient );
+
+	pos = parentOrient * joint.pos + parentPos;
+	orient = parentOrient * joint.orient;
+	orient.normalise();
+	canonicalQuaternion( orient );
+}
+
+void ModelGenerator::animatedJoint( int index, int frame, Joint &joint ) const
+{
+	const Joint &base = mSkeleton[index];
+	float phase = frame * 0.2f + index;
+
+	joint.parent = base.parent;
+	joint.pos = base.pos + Vector3( sinf( phase ), cosf( phase ), sinf( phase * 0.5f ) ) * 0.25f;
+	joint.orient = md5Quaternion( base.orient.x + sinf( phase ) * 0.1f, 
+		base.orient.y + cosf( phase ) * 0.1f, base.orient.z );
+}
+
+void ModelGenerator::gridGLCommands( int numVertices, int numTriangles, int skinWidth, int skinHeight, vector<int> &commands ) const
+{
+	commands.clear();
+
+	int triangle = 0;
+	while ( triangle < numTriangles )
+	{
+		int first[3], second[3];
+		gridTriangle( triangle, numVertices, first );
+
+		// Both triangles of consecutive quads along a grid row make up one strip;
+		// a triangle without the rest of its quad becomes a strip of its own
+		vector<int> strip;
+		if ( triangle % 2 != 0 || triangle + 1 == numTriangles )
+		{
+			strip.assign( first, first + 3 );
+			triangle++;
+		}
+		else
+		{
+			gridTriangle( triangle + 1, numVertices, second );
+			strip.push_back( second[2] );
+			strip.push_back( first[0] );
+			strip.push_back( first[2] );
+			strip.push_back( first[1] );
+			triangle += 2;
+
+			while ( triangle + 1 < numTriangles )
+			{
+				gridTriangle( triangle, numVertices, first );
+				gridTriangle( triangle + 1, numVertices, second );
+				if ( second[2] != strip[strip.size() - 2] || first[0] != strip.back() )
+					break;
+
+				strip.push_back( first[2] );
+				strip.push_back( first[1] );
+				triangle += 2;
+			}
+		}
+
+		// Every vertex of a command is a texture coordinate pair followed by the vertex index
+		commands.push_back( (int)strip.size() );
+		for ( size_t i = 0; i < strip.size(); i++ )
+		{
+			float texCoord[2];
+			gridTexCoord( strip[i], numVertices, texCoord[0], texCoord[1] );
+			texCoord[0] = (float)(int)(texCoord[0] * (skinWidth - 1)) / (float)skinWidth;
+			texCoord[1] = (float)(int)(texCoord[1] * (skinHeight - 1)) / (float)skinHeight;
+
+			int words[2];
+			memcpy( words, texCoord, sizeof( words ) );
+			commands.push_back( words[0] );
+			commands.push_back( words[1] );
+			commands.push_back( strip[i] );
+		}
+	}
+
+	commands.push_back( 0 );
+}
+
+void ModelGenerator::generateMD2( string &data )
+{
+	reset();
+
+	// MD2 stores vertex and texture coordinate indices as shorts, which may leave less room for triangles
+	int numVertices = MIN( mOptions.numVertices, 32767 );
+	int numTriangles = MIN( mOptions.numTriangles, gridCapacity( numVertices ) );
+	int numFrames = mOptions.numFrames;
+	int frameSize = sizeof( MD2FrameHeader ) + sizeof( MD2Vertex ) * numVertices;
+
+	MD2Header header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, "IDP2", 4 );
+	header.version = 8;
+	header.skinWidth = 256;
+	header.skinHeight = 256;
+	header.frameSize = frameSize;
+	header.numSkins = 1;
+	header.numVertices = numVertices;
+	header.numTexCoords = numVertices;
+	header.numTriangles = numTriangles;
+	vector<int> glCommands;
+	gridGLCommands( numVertices, numTriangles, header.skinWidth, header.skinHeight, glCommands );
+	header.numGLCommands = (int)glCommands.size();
+	header.numFrames = numFrames;
+	header.offsetSkins = sizeof( MD2Header );
+	header.offsetTexCoords = header.offsetSkins + sizeof( MD2Skin );
+	header.offsetTriangles = header.offsetTexCoords + sizeof( MD2TexCoord ) * numVertices;
+	header.offsetFrames = header.offsetTriangles + sizeof( MD2Triangle ) * numTriangles;
+	header.offsetGlCommands = header.offsetFrames + frameSize * numFrames;
+	header.offsetEnd = header.offsetGlCommands + sizeof( int ) * header.numGLCommands;
+
+	data.clear();
+	data.reserve( header.offsetEnd );
+	appendBinary( data, &header );
+
+	MD2Skin skin;
+	memset( &skin, 0, sizeof( skin ) );
+	strcpy( (char*)skin.name, "models/synthetic/skin.pcx" );
+	appendBinary( data, &skin );
+
+	for ( int i = 0; i < numVertices; i++ )
+	{
+		float u, v;
+		gridTexCoord( i, numVertices, u, v );
+
+		MD2TexCoord texCoord;
+		texCoord.u = (short)(u * (header.skinWidth - 1));
+		texCoord.v = (short)(v * (header.skinHeight - 1));
+		appendBinary( data, &texCoord );
+	}
+
+	for ( int i = 0; i < numTriangles; i++ )
+	{
+		int indices[3];
+		gridTriangle( i, numVertices, indices );
+
+		MD2Triangle triangle;
+		for ( int j = 0; j < 3; j++ )
+		{
+			triangle.vertexIndices[j] = (short)indices[j];
+			triangle.textureIndices[j] = (short)indices[j];
+		}
+		appendBinary( data, &triangle );
+	}
+
+	vector<Vector3> positions( numVertices );
+	for ( int f = 0; f < numFrames; f++ )
+	{
+		Vector3 mins( 1e9f, 1e9f, 1e9f ), maxs( -1e9f, -1e9f, -1e9f );
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			positions[i] = gridPosition( i, numVertices, f );
+			for ( int j = 0; j < 3; j++ )
+			{
+				mins[j] = MIN( mins[j], positions[i][j] );
+				maxs[j] = MAX( maxs[j], positions[i][j] );
+			}
+		}
+
+		MD2FrameHeader frameHeader = MD2FrameHeader();
+		for ( int j = 0; j < 3; j++ )
+		{
+			frameHeader.scale[j] = MAX( maxs[j] - mins[j], 0.001f ) / 255.0f;
+			frameHeader.translate[j] = mins[j];
+		}
+		snprintf( frameHeader.name, sizeof( frameHeader.name ), "frame%03d", f );
+		appendBinary( data, &frameHeader );
+
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			MD2Vertex vertex;
+			for ( int j = 0; j < 3; j++ )
+				vertex.vertex[j] = (unsigned char)((positions[i][j] - mins[j]) / frameHeader.scale[j] + 0.5f);
+			vertex.normalIndex = (unsigned char)((i + f) % MD2_NUMVERTEXNORMALS);
+			appendBinary( data, &vertex );
+		}
+	}
+
+	appendBinary( data, &glCommands[0], glCommands.size() );
+}
+
+void ModelGenerator::generateMD3( string &data )
+{
+	reset();
+
+	int numVertices = mOptions.numVertices;
+	int numTriangles = mOptions.numTriangles;
+	int numFrames = mOptions.numFrames;
+	int numSurfaces = mOptions.numSurfaces;
+
+	MD3MeshHeader meshHeader;
+	memset( &meshHeader, 0, sizeof( meshHeader ) );
+	memcpy( meshHeader.magic, "IDP3", 4 );
+	meshHeader.numFrames = numFrames;
+	meshHeader.numShaders = 1;
+	meshHeader.numVertices = numVertices;
+	meshHeader.numTriangles = numTriangles;
+	meshHeader.offsetTriangles = sizeof( MD3MeshHeader );
+	meshHeader.offsetShaders = meshHeader.offsetTriangles + sizeof( MD3Triangle ) * numTriangles;
+	meshHeader.offsetTexCoords = meshHeader.offsetShaders + sizeof( MD3Shader );
+	meshHeader.offsetVertices = meshHeader.offsetTexCoords + sizeof( MD3TexCoord ) * numVertices;
+	meshHeader.length = meshHeader.offsetVertices + sizeof( MD3Vertex ) * numVertices * numFrames;
+
+	MD3Header header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, "IDP3", 4 );
+	header.version = 15;
+	strcpy( header.name, "synthetic" );
+	header.numFrames = numFrames;
+	header.numTags = 0;
+	header.numMeshes = numSurfaces;
+	header.offsetFrames = sizeof( MD3Header );
+	header.offsetTags = header.offsetFrames + sizeof( MD3Frame ) * numFrames;
+	header.offsetMeshes = header.offsetTags;
+	header.filesize = header.offsetMeshes + meshHeader.length * numSurfaces;
+
+	data.clear();
+	data.reserve( header.filesize );
+	appendBinary( data, &header );
+
+	for ( int f = 0; f < numFrames; f++ )
+	{
+		MD3Frame frame;
+		memset( &frame, 0, sizeof( frame ) );
+		for ( int j = 0; j < 3; j++ )
+		{
+			frame.mins[j] = -32.0f;
+			frame.maxs[j] = 32.0f + 70.0f * (numSurfaces - 1);
+		}
+		frame.radius = frame.maxs[0];
+		snprintf( frame.name, sizeof( frame.name ), "frame%03d", f );
+		appendBinary( data, &frame );
+	}
+
+	for ( int s = 0; s < numSurfaces; s++ )
+	{
+		snprintf( meshHeader.name, sizeof( meshHeader.name ), "surface%d", s );
+		appendBinary( data, &meshHeader );
+
+		for ( int i = 0; i < numTriangles; i++ )
+		{
+			MD3Triangle triangle;
+			gridTriangle( i, numVertices, triangle.indices );
+			appendBinary( data, &triangle );
+		}
+
+		MD3Shader shader;
+		memset( &shader, 0, sizeof( shader ) );
+		snprintf( shader.name, sizeof( shader.name ), "models/synthetic/surface%d", s );
+		appendBinary( data, &shader );
+
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			MD3TexCoord texCoord;
+			gridTexCoord( i, numVertices, texCoord.uv[0], texCoord.uv[1] );
+			appendBinary( data, &texCoord );
+		}
+
+		for ( int f = 0; f < numFrames; f++ )
+		{
+			for ( int i = 0; i < numVertices; i++ )
+			{
+				Vector3 position = gridPosition( i, numVertices, f );
+				position.x += 70.0f * s;
+
+				MD3Vertex vertex;
+				for ( int j = 0; j < 3; j++ )
+					vertex.position[j] = (short)(position[j] / MD3_SCALE);
+				vertex.normal = (short)((i * 37 + f) & 0xFFFF);
+				appendBinary( data, &vertex );
+			}
+		}
+	}
+}
+
+void ModelGenerator::generateMD5Mesh( string &data )
+{
+	reset();
+	buildSkeleton();
+
+	int numJoints = mOptions.numJoints;
+	int numVertices = mOptions.numVertices;
+	int numTriangles = mOptions.numTriangles;
+	int numWeights = mOptions.weightsPerVertex;
+
+	vector<Vector3> jointPos( numJoints );
+	vector<Quaternion> jointOrient( numJoints );
+	for ( int i = 0; i < numJoints; i++ )
+		absoluteJoint( mSkeleton, i, jointPos[i], jointOrient[i] );
+
+	data.clear();
+	appendText( data, "MD5Version 10\ncommandline \"\"\n\n" );
+	appendText( data, "numJoints %d\nnumMeshes %d\n\n", numJoints, mOptions.numSurfaces );
+
+	appendText( data, "joints {\n" );
+	for ( int i = 0; i < numJoints; i++ )
+	{
+		const Vector3 &pos = jointPos[i];
+		const Quaternion &orient = jointOrient[i];
+		appendText( data, "\t\"joint%d\"\t%d ( %f %f %f ) ( %f %f %f )\n", 
+			i, mSkeleton[i].parent, pos.x, pos.y, pos.z, orient.x, orient.y, orient.z );
+	}
+	appendText( data, "}\n" );
+
+	vector<float> biases( numWeights );
+	for ( int s = 0; s < mOptions.numSurfaces; s++ )
+	{
+		appendText( data, "\nmesh {\n\tshader \"models/synthetic/surface%d\"\n\n", s );
+
+		appendText( data, "\tnumverts %d\n", numVertices );
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			float u, v;
+			gridTexCoord( i, numVertices, u, v );
+			appendText( data, "\tvert %d ( %f %f ) %d %d\n", i, u, v, i * numWeights, numWeights );
+		}
+
+		appendText( data, "\n\tnumtris %d\n", numTriangles );
+		for ( int i = 0; i < numTriangles; i++ )
+		{
+			int indices[3];
+			gridTriangle( i, numVertices, indices );
+			appendText( data, "\ttri %d %d %d %d\n", i, indices[0], indices[1], indices[2] );
+		}
+
+		appendText( data, "\n\tnumweights %d\n", numVertices * numWeights );
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			Vector3 position = gridPosition( i, numVertices, 0 );
+			position.x += 70.0f * s;
+
+			float total = 0.0f;
+			for ( int j = 0; j < numWeights; j++ )
+			{
+				biases[j] = 0.1f + random();
+				total += biases[j];
+			}
+
+			// Each weight puts the vertex in the same place, so any blend of them does too
+			int firstJoint = (int)(random() * numJoints);
+			for ( int j = 0; j < numWeights; j++ )
+			{
+				int joint = (firstJoint + j) % numJoints;
+				Vector3 offset = jointOrient[joint].Inverse() * (position - jointPos[joint]);
+				appendText( data, "\tweight %d %d %f ( %f %f %f )\n", 
+					i * numWeights + j, joint, biases[j] / total, offset.x, offset.y, offset.z );
+			}
+		}
+
+		appendText( data, "}\n" );
+	}
+}
+
+void ModelGenerator::generateMD5Anim( string &data )
+{
+	reset();
+	buildSkeleton();
+
+	int numJoints = mOptions.numJoints;
+	int numFrames = mOptions.numFrames;
+
+	data.clear();
+	appendText( data, "MD5Version 10\ncommandline \"\"\n\n" );
+	appendText( data, "numFrames %d\nnumJoints %d\nframeRate 24\nnumAnimatedComponents %d\n\n", 
+		numFrames, numJoints, numJoints * 6 );
+
+	appendText( data, "hierarchy {\n" );
+	for ( int i = 0; i < numJoints; i++ )
+		appendText( data, "\t\"joint%d\"\t%d 63 %d\n", i, mSkeleton[i].parent, i * 6 );
+	appendText( data, "}\n\n" );
+
+	float extent = 32.0f + 70.0f * (mOptions.numSurfaces - 1);
+	appendText( data, "bounds {\n" );
+	for ( int f = 0; f < numFrames; f++ )
+		appendText( data, "\t( %f %f %f ) ( %f %f %f )\n", -32.0f, -32.0f, -32.0f, extent, extent, extent );
+	appendText( data, "}\n\n" );
+
+	appendText( data, "baseframe {\n" );
+	for ( int i = 0; i < numJoints; i++ )
+	{
+		const Joint &joint = mSkeleton[i];
+		appendText( data, "\t( %f %f %f ) ( %f %f %f )\n", 
+			joint.pos.x, joint.pos.y, joint.pos.z, joint.orient.x, joint.orient.y, joint.orient.z );
+	}
+	appendText( data, "}\n" );
+
+	for ( int f = 0; f < numFrames; f++ )
+	{
+		appendText( data, "\nframe %d {\n", f );
+		for ( int i = 0; i < numJoints; i++ )
+		{
+			Joint joint;
+			animatedJoint( i, f, joint );
+			appendText( data, "\t%f %f %f %f %f %f\n", 
+				joint.pos.x, joint.pos.y, joint.pos.z, joint.orient.x, joint.orient.y, joint.orient.z );
+		}
+		appendText( data, "}\n" );
+	}
+}
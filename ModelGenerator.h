@@ -0,0 +1,94 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __MODELGENERATOR_H__
+#define __MODELGENERATOR_H__
+
+#include "Common.h"
+#include "vector.h"
+#include "quaternion.h"
+
+struct GeneratorOptions
+{
+	GeneratorOptions();
+
+	int numVertices;		// per surface
+	int numTriangles;		// per surface
+	int numFrames;
+	int numSurfaces;
+	int numJoints;
+	int weightsPerVertex;
+	unsigned int seed;
+};
+
+/**
+Generates valid MD2, MD3, md5mesh and md5anim files of any size, so the converters can
+be tested and measured on models much larger than the ones that ship with the games.
+Every surface is a rippling grid of vertices, every triangle is part of a grid quad
+whose four corners exist, and the skeleton is a binary tree of joints. A grid can't
+hold more triangles than it has quads for, so the number of vertices is raised until
+the requested triangles fit. The output only depends on the options (including the
+random seed), generating the same model twice gives identical files on every platform.
+*/
+class ModelGenerator
+{
+public:
+	ModelGenerator( const GeneratorOptions &options );
+
+	// The options the models are generated with, after any adjustments
+	const GeneratorOptions &getOptions() const { return mOptions; }
+
+	void generateMD2( string &data );
+	void generateMD3( string &data );
+	void generateMD5Mesh( string &data );
+	void generateMD5Anim( string &data );
+
+	// Number of triangles a grid of this many vertices has room for
+	static int gridCapacity( int numVertices );
+
+private:
+	struct Joint
+	{
+		int parent;
+		Vector3 pos;			// relative to the parent
+		Quaternion orient;
+	};
+
+	void reset();
+	float random();
+	static int gridWidth( int numVertices );
+	Vector3 gridPosition( int vertex, int numVertices, int frame ) const;
+	void gridTexCoord( int vertex, int numVertices, float &u, float &v ) const;
+	void gridTriangle( int triangle, int numVertices, int indices[3] ) const;
+	void gridGLCommands( int numVertices, int numTriangles, int skinWidth, int skinHeight, vector<int> &commands ) const;
+	void buildSkeleton();
+	void absoluteJoint( const vector<Joint> &joints, int index, Vector3 &pos, Quaternion &orient ) const;
+	void animatedJoint( int index, int frame, Joint &joint ) const;
+
+	GeneratorOptions mOptions;
+	unsigned int mRandomState;
+	float mPhase;
+	vector<Joint> mSkeleton;
+};
+
+#endif	// __MODELGENERATOR_H__
@@ -0,0 +1,490 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "ModelInfo.h"
+#include "MD2Model.h"
+#include "MD3Model.h"
+
+// Copies a block of the file into dest, making sure it doesn't reach past the end of the file
+static bool readBlock( const char *data, size_t size, size_t offset, void *dest, size_t length )
+{
+	if ( offset > size || length > size - offset )
+		return false;
+
+	memcpy( dest, data + offset, length );
+	return true;
+}
+
+// Finds the next line of a text file, with leading white space skipped, without copying it
+static const char *nextLine( const char *data, size_t size, size_t &pos, size_t &length )
+{
+	while ( pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n') )
+		pos++;
+
+	if ( pos >= size )
+		return NULL;
+
+	const char *line = data + pos;
+	const char *end = (const char *)memchr( line, '\n', size - pos );
+	length = end ? (size_t)(end - line) : size - pos;
+	pos += length;
+	return line;
+}
+
+static bool startsWith( const char *line, size_t length, const char *keyword )
+{
+	size_t keywordLength = strlen( keyword );
+	return length >= keywordLength && memcmp( line, keyword, keywordLength ) == 0;
+}
+
+// Copies a line into a zero terminated buffer for sscanf
+static const char *copyLine( const char *line, size_t length, char *buffer, size_t bufferSize )
+{
+	length = MIN( length, bufferSize - 1 );
+	memcpy( buffer, line, length );
+	buffer[length] = '\0';
+	return buffer;
+}
+
+// Reads a joint line from an md5mesh or md5anim file, which starts with "name" parent
+static ModelInfo::Joint readJoint( const char *line, size_t length )
+{
+	char buffer[512], name[256];
+	copyLine( line, length, buffer, sizeof( buffer ) );
+
+	ModelInfo::Joint joint;
+	joint.parent = -1;
+	if ( sscanf( buffer, "\"%255[^\"]\" %d", name, &joint.parent ) == 2 )
+		joint.name = name;
+	return joint;
+}
+
+ModelInfo::ModelInfo():
+	format( FORMAT_UNKNOWN ), numVertices( 0 ), numTriangles( 0 ), numFrames( 0 ), frameRate( 0 ), hasBounds( false )
+{
+}
+
+void ModelInfo::addBounds( const Vector3 &min, const Vector3 &max )
+{
+	if ( !hasBounds )
+	{
+		boundsMin = min;
+		boundsMax = max;
+		hasBounds = true;
+		return;
+	}
+
+	for ( size_t i = 0; i < 3; i++ )
+	{
+		boundsMin[i] = MIN( boundsMin[i], min[i] );
+		boundsMax[i] = MAX( boundsMax[i], max[i] );
+	}
+}
+
+ModelInfo::Format ModelInfo::detectFormat( const char *data, size_t size, const string &filename )
+{
+	if ( size >= 4 && memcmp( data, "IDP2", 4 ) == 0 )
+		return FORMAT_MD2;
+	if ( size >= 4 && memcmp( data, "IDP3", 4 ) == 0 )
+		return FORMAT_MD3;
+
+	// md5 files are text; the header tells meshes and animations apart
+	bool isMD5 = false;
+	size_t pos = 0, length;
+	const char *line;
+	for ( int i = 0; i < 16 && (line = nextLine( data, size, pos, length )); i++ )
+	{
+		if ( startsWith( line, length, "MD5Version" ) )
+			isMD5 = true;
+		else if ( isMD5 && startsWith( line, length, "numMeshes" ) )
+			return FORMAT_MD5MESH;
+		else if ( isMD5 && startsWith( line, length, "numFrames" ) )
+			return FORMAT_MD5ANIM;
+	}
+
+	if ( isMD5 )
+	{
+		string extension = StringUtil::getExtension( filename );
+		if ( extension == "md5mesh" )
+			return FORMAT_MD5MESH;
+		if ( extension == "md5anim" )
+			return FORMAT_MD5ANIM;
+	}
+
+	return FORMAT_UNKNOWN;
+}
+
+const char *ModelInfo::getFormatName( Format format )
+{
+	switch ( format )
+	{
+	case FORMAT_MD2:		return "md2";
+	case FORMAT_MD3:		return "md3";
+	case FORMAT_MD5MESH:	return "md5mesh";
+	case FORMAT_MD5ANIM:	return "md5anim";
+	default:				return "unknown";
+	}
+}
+
+bool ModelInfo::read( const char *data, size_t size, const string &filename )
+{
+	*this = ModelInfo();
+	format = detectFormat( data, size, filename );
+
+	switch ( format )
+	{
+	case FORMAT_MD2:		return readMD2( data, size );
+	case FORMAT_MD3:		return readMD3( data, size );
+	case FORMAT_MD5MESH:	return readMD5Mesh( data, size );
+	case FORMAT_MD5ANIM:	return readMD5Anim( data, size );
+	default:				return false;
+	}
+}
+
+bool ModelInfo::readMD2( const char *data, size_t size )
+{
+	MD2Header header;
+	if ( !readBlock( data, size, 0, &header, sizeof( MD2Header ) ) || header.version != 8 )
+		return false;
+
+	if (	header.numSkins < 0 || header.numTriangles < 0 || header.numFrames < 0 || 
+			header.numVertices < 0 || header.frameSize < (int)sizeof( MD2FrameHeader ) )
+		return false;
+
+	numVertices = header.numVertices;
+	numTriangles = header.numTriangles;
+	numFrames = header.numFrames;
+
+	for ( int i = 0; i < header.numSkins; i++ )
+	{
+		MD2Skin skin;
+		if ( !readBlock( data, size, header.offsetSkins + i * sizeof( MD2Skin ), &skin, sizeof( MD2Skin ) ) )
+			return false;
+		skins.push_back( StringUtil::toString( (const char *)skin.name, sizeof( skin.name ) ) );
+	}
+
+	// Only the frame headers are read, the vertices are skipped
+	for ( int i = 0; i < header.numFrames; i++ )
+	{
+		MD2FrameHeader frameHeader;
+		size_t offset = header.offsetFrames + (size_t)i * header.frameSize;
+		if ( !readBlock( data, size, offset, &frameHeader, sizeof( MD2FrameHeader ) ) )
+			return false;
+		frames.push_back( StringUtil::toString( frameHeader.name, sizeof( frameHeader.name ) ) );
+
+		// Vertex positions are bytes, scaled and translated per frame
+		Vector3 corner( frameHeader.translate.x + 255.0f * frameHeader.scale.x, 
+			frameHeader.translate.y + 255.0f * frameHeader.scale.y, frameHeader.translate.z + 255.0f * frameHeader.scale.z );
+		Vector3 min( MIN( frameHeader.translate.x, corner.x ), MIN( frameHeader.translate.y, corner.y ), MIN( frameHeader.translate.z, corner.z ) );
+		Vector3 max( MAX( frameHeader.translate.x, corner.x ), MAX( frameHeader.translate.y, corner.y ), MAX( frameHeader.translate.z, corner.z ) );
+		addBounds( min, max );
+	}
+
+	return true;
+}
+
+bool ModelInfo::readMD3( const char *data, size_t size )
+{
+	MD3Header header;
+	if ( !readBlock( data, size, 0, &header, sizeof( MD3Header ) ) || header.version != 15 )
+		return false;
+
+	if ( header.numFrames < 0 || header.numTags < 0 || header.numMeshes < 0 )
+		return false;
+
+	numFrames = header.numFrames;
+
+	for ( int i = 0; i < header.numFrames; i++ )
+	{
+		MD3Frame frame;
+		if ( !readBlock( data, size, header.offsetFrames + i * sizeof( MD3Frame ), &frame, sizeof( MD3Frame ) ) )
+			return false;
+		frames.push_back( StringUtil::toString( frame.name, sizeof( frame.name ) ) );
+		addBounds( Vector3( frame.mins[0], frame.mins[1], frame.mins[2] ), Vector3( frame.maxs[0], frame.maxs[1], frame.maxs[2] ) );
+	}
+
+	// Every frame has the same tags, so the first frame is enough for their names
+	for ( int i = 0; i < header.numTags; i++ )
+	{
+		MD3Tag tag;
+		if ( !readBlock( data, size, header.offsetTags + i * sizeof( MD3Tag ), &tag, sizeof( MD3Tag ) ) )
+			return false;
+		tags.push_back( StringUtil::toString( tag.name, sizeof( tag.name ) ) );
+	}
+
+	size_t offset = header.offsetMeshes;
+	for ( int i = 0; i < header.numMeshes; i++ )
+	{
+		MD3MeshHeader meshHeader;
+		if ( !readBlock( data, size, offset, &meshHeader, sizeof( MD3MeshHeader ) ) || meshHeader.numShaders < 0 )
+			return false;
+
+		Mesh mesh;
+		mesh.name = StringUtil::toString( meshHeader.name, sizeof( meshHeader.name ) );
+		mesh.numVertices = meshHeader.numVertices;
+		mesh.numTriangles = meshHeader.numTriangles;
+		mesh.numWeights = 0;
+
+		for ( int j = 0; j < meshHeader.numShaders; j++ )
+		{
+			MD3Shader shader;
+			if ( !readBlock( data, size, offset + meshHeader.offsetShaders + j * sizeof( MD3Shader ), &shader, sizeof( MD3Shader ) ) )
+				return false;
+			mesh.shaders.push_back( StringUtil::toString( shader.name, sizeof( shader.name ) ) );
+		}
+
+		numVertices += mesh.numVertices;
+		numTriangles += mesh.numTriangles;
+		meshes.push_back( mesh );
+
+		if ( meshHeader.length <= 0 )
+			return false;
+		offset += meshHeader.length;
+	}
+
+	return true;
+}
+
+bool ModelInfo::readMD5Mesh( const char *data, size_t size )
+{
+	char buffer[512];
+	size_t pos = 0, length;
+	const char *line;
+	while ( (line = nextLine( data, size, pos, length )) )
+	{
+		int value;
+		if ( startsWith( line, length, "MD5Version" ) )
+		{
+			if ( sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "MD5Version %d", &value ) != 1 || value != 10 )
+				return false;
+		}
+		else if ( startsWith( line, length, "joints {" ) )
+		{
+			while ( (line = nextLine( data, size, pos, length )) && line[0] != '}' )
+				joints.push_back( readJoint( line, length ) );
+		}
+		else if ( startsWith( line, length, "mesh {" ) )
+		{
+			Mesh mesh;
+			mesh.numVertices = mesh.numTriangles = mesh.numWeights = 0;
+
+			// Only the counts are read, the vert, tri and weight lines are skipped
+			while ( (line = nextLine( data, size, pos, length )) && line[0] != '}' )
+			{
+				if ( startsWith( line, length, "shader " ) )
+				{
+					char shader[256];
+					if ( sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "shader \"%255[^\"]\"", shader ) == 1 )
+						mesh.shaders.push_back( shader );
+				}
+				else if ( startsWith( line, length, "numverts " ) )
+					sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "numverts %d", &mesh.numVertices );
+				else if ( startsWith( line, length, "numtris " ) )
+					sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "numtris %d", &mesh.numTriangles );
+				else if ( startsWith( line, length, "numweights " ) )
+					sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "numweights %d", &mesh.numWeights );
+			}
+
+			numVertices += mesh.numVertices;
+			numTriangles += mesh.numTriangles;
+			meshes.push_back( mesh );
+		}
+	}
+
+	return true;
+}
+
+bool ModelInfo::readMD5Anim( const char *data, size_t size )
+{
+	char buffer[512];
+	size_t pos = 0, length;
+	const char *line;
+	while ( (line = nextLine( data, size, pos, length )) )
+	{
+		int value;
+		if ( startsWith( line, length, "MD5Version" ) )
+		{
+			if ( sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "MD5Version %d", &value ) != 1 || value != 10 )
+				return false;
+		}
+		else if ( startsWith( line, length, "numFrames " ) )
+			sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "numFrames %d", &numFrames );
+		else if ( startsWith( line, length, "frameRate " ) )
+			sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "frameRate %d", &frameRate );
+		else if ( startsWith( line, length, "hierarchy {" ) )
+		{
+			while ( (line = nextLine( data, size, pos, length )) && line[0] != '}' )
+				joints.push_back( readJoint( line, length ) );
+		}
+		else if ( startsWith( line, length, "bounds {" ) )
+		{
+			while ( (line = nextLine( data, size, pos, length )) && line[0] != '}' )
+			{
+				Vector3 min, max;
+				if ( sscanf( copyLine( line, length, buffer, sizeof( buffer ) ), "( %f %f %f ) ( %f %f %f )",
+						&min.x, &min.y, &min.z, &max.x, &max.y, &max.z ) == 6 )
+					addBounds( min, max );
+			}
+		}
+		else if ( startsWith( line, length, "baseframe {" ) )
+		{
+			// Everything from here on is joint and frame data
+			break;
+		}
+	}
+
+	return true;
+}
+
+void ModelInfo::print( ostream &os ) const
+{
+	switch ( format )
+	{
+	case FORMAT_MD2:
+		os << "MD2 file info" << endl;
+		for ( size_t i = 0; i < skins.size(); i++ )
+			os << "Skin " << i << " = " << skins[i] << endl;
+		os << skins.size() << " skins total" << endl;
+		for ( size_t i = 0; i < frames.size(); i++ )
+			os << "Frame " << i << " = " << frames[i] << endl;
+		os << frames.size() << " frames total" << endl;
+		os << numVertices << " vertices, " << numTriangles << " triangles" << endl;
+		break;
+
+	case FORMAT_MD3:
+		os << "MD3 file info" << endl;
+		for ( size_t i = 0; i < frames.size(); i++ )
+			os << "Frame " << i << " = " << frames[i] << endl;
+		os << frames.size() << " frames total" << endl;
+		for ( size_t i = 0; i < tags.size(); i++ )
+			os << "Tag " << i << " = " << tags[i] << endl;
+		os << tags.size() << " tags total" << endl;
+		for ( size_t i = 0; i < meshes.size(); i++ )
+		{
+			const Mesh &mesh = meshes[i];
+			os << "Mesh " << i << " = " << mesh.name << endl;
+			for ( size_t j = 0; j < mesh.shaders.size(); j++ )
+				os << "Mesh " << i << " shader " << j << " = " << mesh.shaders[j] << endl;
+			os << "Mesh " << i << " has " << mesh.shaders.size() << " shaders total" << endl;
+			os << "Mesh " << i << " has " << mesh.numVertices << " vertices, " << mesh.numTriangles << " triangles" << endl;
+		}
+		os << meshes.size() << " meshes total" << endl;
+		break;
+
+	case FORMAT_MD5MESH:
+		os << "MD5 Mesh file info" << endl;
+		for ( size_t i = 0; i < joints.size(); i++ )
+			os << "Joint " << i << " = " << joints[i].name << endl;
+		os << joints.size() << " joints total" << endl;
+		for ( size_t i = 0; i < meshes.size(); i++ )
+		{
+			const Mesh &mesh = meshes[i];
+			os << "Mesh " << i << " shader = " << (mesh.shaders.empty() ? "" : mesh.shaders[0]) << endl;
+			os << "Mesh " << i << " has " << mesh.numVertices << " vertices, " 
+				<< mesh.numTriangles << " triangles, " << mesh.numWeights << " weights" << endl;
+		}
+		os << meshes.size() << " meshes total" << endl;
+		break;
+
+	case FORMAT_MD5ANIM:
+		os << "MD5 Animation file info" << endl;
+		for ( size_t i = 0; i < joints.size(); i++ )
+			os << "Joint " << i << " = " << joints[i].name << endl;
+		os << joints.size() << " joints total" << endl;
+		os << numFrames << " frames at " << frameRate << " fps" << endl;
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void writeStringsJSON( ostream &os, const char *name, const vector<string> &strings )
+{
+	os << ", \"" << name << "\": [";
+	for ( size_t i = 0; i < strings.size(); i++ )
+		os << (i > 0 ? ", " : "") << StringUtil::toJSON( strings[i] );
+	os << "]";
+}
+
+static void writeVectorJSON( ostream &os, const Vector3 &v )
+{
+	char buffer[128];
+	snprintf( buffer, sizeof( buffer ), "[%g, %g, %g]", v.x, v.y, v.z );
+	os << buffer;
+}
+
+void ModelInfo::writeJSON( ostream &os ) const
+{
+	os << "\"format\": \"" << getFormatName( format ) << "\", \"vertices\": " << numVertices 
+		<< ", \"triangles\": " << numTriangles << ", \"frames\": " << numFrames;
+	if ( format == FORMAT_MD5ANIM )
+		os << ", \"frame_rate\": " << frameRate;
+
+	if ( format == FORMAT_MD2 )
+		writeStringsJSON( os, "skins", skins );
+	if ( format == FORMAT_MD2 || format == FORMAT_MD3 )
+		writeStringsJSON( os, "frame_names", frames );
+	if ( format == FORMAT_MD3 )
+		writeStringsJSON( os, "tags", tags );
+
+	if ( format == FORMAT_MD3 || format == FORMAT_MD5MESH )
+	{
+		os << ", \"meshes\": [";
+		for ( size_t i = 0; i < meshes.size(); i++ )
+		{
+			const Mesh &mesh = meshes[i];
+			os << (i > 0 ? ", " : "") << "{\"name\": " << StringUtil::toJSON( mesh.name );
+			writeStringsJSON( os, "shaders", mesh.shaders );
+			os << ", \"vertices\": " << mesh.numVertices << ", \"triangles\": " << mesh.numTriangles;
+			if ( format == FORMAT_MD5MESH )
+				os << ", \"weights\": " << mesh.numWeights;
+			os << "}";
+		}
+		os << "]";
+	}
+
+	if ( format == FORMAT_MD5MESH || format == FORMAT_MD5ANIM )
+	{
+		os << ", \"joints\": [";
+		for ( size_t i = 0; i < joints.size(); i++ )
+		{
+			os << (i > 0 ? ", " : "") << "{\"name\": " << StringUtil::toJSON( joints[i].name ) 
+				<< ", \"parent\": " << joints[i].parent << "}";
+		}
+		os << "]";
+	}
+
+	if ( hasBounds )
+	{
+		os << ", \"bounds\": {\"min\": ";
+		writeVectorJSON( os, boundsMin );
+		os << ", \"max\": ";
+		writeVectorJSON( os, boundsMax );
+		os << "}";
+	}
+	else
+	{
+		os << ", \"bounds\": null";
+	}
+}
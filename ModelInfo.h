@@ -0,0 +1,103 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __MODELINFO_H__
+#define __MODELINFO_H__
+
+#include "Common.h"
+#include "vector.h"
+
+/**
+Describes a model file without decoding its geometry. The format is recognised from
+the contents of the file, and only the headers and name tables are read: frame, skin,
+tag and shader names, the joint hierarchy and the vertex, triangle and weight counts.
+This is what -i prints, and is much cheaper than loading the full model.
+
+The bounds come from the frame headers of md2 and md3 files and from the bounds
+block of md5anim files, in the coordinate system of the file. For md2 files they
+are the range the compressed vertex positions can cover, which may be slightly
+larger than the model. md5mesh files store no bounds.
+*/
+struct ModelInfo
+{
+	enum Format
+	{
+		FORMAT_UNKNOWN,
+		FORMAT_MD2,
+		FORMAT_MD3,
+		FORMAT_MD5MESH,
+		FORMAT_MD5ANIM
+	};
+
+	struct Mesh
+	{
+		string name;
+		vector<string> shaders;
+		int numVertices;
+		int numTriangles;
+		int numWeights;
+	};
+
+	struct Joint
+	{
+		string name;
+		int parent;
+	};
+
+	ModelInfo();
+
+	// The file name is only used to tell md5 files apart if their header doesn't
+	bool read( const char *data, size_t size, const string &filename = "" );
+
+	void print( ostream &os ) const;
+
+	// Writes the members of a JSON object, without the braces, so callers can add their own
+	void writeJSON( ostream &os ) const;
+
+	static Format detectFormat( const char *data, size_t size, const string &filename = "" );
+	static const char *getFormatName( Format format );
+
+	Format format;
+	int numVertices;		// totals over all meshes
+	int numTriangles;
+	int numFrames;
+	int frameRate;			// md5anim only
+	vector<string> skins;	// md2 only
+	vector<string> frames;	// md2 and md3 only, md5 frames have no names
+	vector<string> tags;	// md3 only
+	vector<Mesh> meshes;	// md3 and md5mesh only
+	vector<Joint> joints;	// md5 only
+	bool hasBounds;
+	Vector3 boundsMin;
+	Vector3 boundsMax;
+
+private:
+	void addBounds( const Vector3 &min, const Vector3 &max );
+
+	bool readMD2( const char *data, size_t size );
+	bool readMD3( const char *data, size_t size );
+	bool readMD5Mesh( const char *data, size_t size );
+	bool readMD5Anim( const char *data, size_t size );
+};
+
+#endif	// __MODELINFO_H__
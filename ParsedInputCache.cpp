@@ -0,0 +1,87 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "ParsedInputCache.h"
+
+#include "md5model.h"
+
+ParsedInputCache::~ParsedInputCache()
+{
+	for ( AnimMap::iterator iter = mAnims.begin(); iter != mAnims.end(); ++iter )
+	{
+		FreeAnim( iter->second );
+		delete iter->second;
+	}
+}
+
+ParsedInputCache::Key ParsedInputCache::makeKey( const string &data )
+{
+	return make_pair( StringUtil::hash( data.data(), data.size() ), data.size() );
+}
+
+bool ParsedInputCache::findMD5Anim( const string &data, struct md5_anim_t *anim )
+{
+	Key key = makeKey( data );
+
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	AnimMap::const_iterator iter = mAnims.find( key );
+	if ( iter == mAnims.end() )
+		return false;
+
+	CopyAnim( iter->second, anim );
+	return true;
+}
+
+void ParsedInputCache::storeMD5Anim( const string &data, const struct md5_anim_t *anim )
+{
+	Key key = makeKey( data );
+
+	struct md5_anim_t *copy = new md5_anim_t;
+	CopyAnim( anim, copy );
+
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	AnimMap::iterator iter = mAnims.find( key );
+	if ( iter != mAnims.end() )
+	{
+		// Another conversion beat us to it
+		FreeAnim( copy );
+		delete copy;
+		return;
+	}
+
+	mAnims[key] = copy;
+	mOrder.push_back( key );
+
+	while ( mAnims.size() > mMaxEntries )
+	{
+		AnimMap::iterator oldest = mAnims.find( mOrder.front() );
+		mOrder.pop_front();
+
+		FreeAnim( oldest->second );
+		delete oldest->second;
+		mAnims.erase( oldest );
+	}
+}
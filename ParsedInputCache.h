@@ -0,0 +1,60 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __PARSEDINPUTCACHE_H__
+#define __PARSEDINPUTCACHE_H__
+
+#include <mutex>
+#include <deque>
+
+struct md5_anim_t;
+
+/**
+Keeps parsed copies of input files that are expensive to parse and tend to be shared
+between many conversions, which currently means md5anim files. Entries are keyed on
+the file's contents rather than its name, so a modified file is never served stale.
+Safe to share between threads.
+*/
+class ParsedInputCache
+{
+public:
+	ParsedInputCache( size_t maxEntries = 64 ): mMaxEntries( maxEntries ) {}
+	~ParsedInputCache();
+
+	// Fills in a private copy of the animation, which the caller has to free with FreeAnim()
+	bool findMD5Anim( const string &data, struct md5_anim_t *anim );
+	void storeMD5Anim( const string &data, const struct md5_anim_t *anim );
+
+private:
+	typedef pair<unsigned long long, size_t> Key;
+	typedef map<Key, struct md5_anim_t *> AnimMap;
+
+	static Key makeKey( const string &data );
+
+	AnimMap mAnims;
+	std::deque<Key> mOrder;	// Oldest entry first
+	size_t mMaxEntries;
+	std::mutex mMutex;
+};
+
+#endif	// __PARSEDINPUTCACHE_H__
@@ -0,0 +1,273 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Profiler.h"
+#include "AllocationTracker.h"
+#include "TraceLog.h"
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+Profiler::Profiler():
+	mTrackMemory( false ), mTraceLog( NULL ), mJobOpen( false )
+{
+	memset( &mJobStart, 0, sizeof( mJobStart ) );
+}
+
+double Profiler::getWallTime()
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+double Profiler::getCPUTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if ( !GetThreadTimes( GetCurrentThread(), &creation, &exit, &kernel, &user ) )
+		return 0.0;
+
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (double)(k.QuadPart + u.QuadPart) * 1e-7;
+#else
+	struct timespec ts;
+	if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) != 0 )
+		return 0.0;
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+void Profiler::start( Snapshot &snapshot ) const
+{
+	if ( mTrackMemory )
+	{
+		// Measure the peak of this phase alone, the outer peak gets restored afterwards
+		AllocationTracker::Stats stats = AllocationTracker::getStats();
+		snapshot.allocations = stats.allocations;
+		snapshot.allocatedBytes = stats.bytesAllocated;
+		snapshot.currentBytes = stats.currentBytes;
+		snapshot.outerPeakBytes = AllocationTracker::resetPeak();
+	}
+
+	snapshot.wallStart = getWallTime();
+	snapshot.cpuStart = getCPUTime();
+}
+
+void Profiler::stop( const Snapshot &snapshot, Measurement &measurement ) const
+{
+	measurement.startTime = snapshot.wallStart;
+	measurement.wallTime = getWallTime() - snapshot.wallStart;
+	measurement.cpuTime = getCPUTime() - snapshot.cpuStart;
+
+	if ( mTrackMemory )
+	{
+		AllocationTracker::Stats stats = AllocationTracker::getStats();
+		measurement.allocations = stats.allocations - snapshot.allocations;
+		measurement.allocatedBytes = stats.bytesAllocated - snapshot.allocatedBytes;
+		measurement.peakBytes = stats.peakBytes - snapshot.currentBytes;
+		AllocationTracker::restorePeak( snapshot.outerPeakBytes );
+	}
+}
+
+void Profiler::beginJob( const string &name )
+{
+	if ( mJobOpen )
+		endJob();
+
+	Job job;
+	memset( (Measurement*)&job, 0, sizeof( Measurement ) );
+	job.name = name;
+	job.peakRSS = 0;
+	mJobs.push_back( job );
+
+	if ( mTrackMemory )
+		AllocationTracker::resetPeakRSS();
+
+	mJobOpen = true;
+	start( mJobStart );
+}
+
+void Profiler::endJob()
+{
+	if ( !mJobOpen )
+		return;
+
+	while ( !mOpenPhases.empty() )
+		endPhase();
+
+	Job &job = mJobs.back();
+	stop( mJobStart, job );
+	mJobOpen = false;
+
+	if ( mTraceLog )
+		mTraceLog->addEvent( job.name.empty() ? "(no job)" : job.name, "job", job.startTime, job.wallTime );
+
+	if ( mTrackMemory )
+		job.peakRSS = AllocationTracker::getPeakRSS();
+}
+
+void Profiler::beginPhase( const string &name )
+{
+	// Phases outside of a job still get reported
+	if ( !mJobOpen )
+		beginJob( "" );
+
+	Job &job = mJobs.back();
+
+	Phase phase;
+	memset( (Measurement*)&phase, 0, sizeof( Measurement ) );
+	phase.name = name;
+	phase.depth = (int)mOpenPhases.size();
+	job.phases.push_back( phase );
+
+	OpenPhase open;
+	open.index = job.phases.size() - 1;
+	mOpenPhases.push_back( open );
+	start( mOpenPhases.back() );
+}
+
+void Profiler::endPhase()
+{
+	if ( mOpenPhases.empty() )
+		return;
+
+	const OpenPhase &open = mOpenPhases.back();
+	Phase &phase = mJobs.back().phases[open.index];
+	stop( open, phase );
+	mOpenPhases.pop_back();
+
+	if ( mTraceLog )
+		mTraceLog->addEvent( phase.name, "phase", phase.startTime, phase.wallTime );
+}
+
+static string formatMegabytes( long long bytes )
+{
+	char buffer[32];
+	snprintf( buffer, sizeof( buffer ), "%.2f", bytes / (1024.0 * 1024.0) );
+	return buffer;
+}
+
+void Profiler::printTable( ostream &os ) const
+{
+	char line[256];
+	snprintf( line, sizeof( line ), "%-44s %12s %12s %8s", "Job / phase", "Wall (ms)", "CPU (ms)", "% job" );
+	os << line;
+	if ( mTrackMemory )
+	{
+		snprintf( line, sizeof( line ), " %10s %10s %10s %10s", "Allocs", "Alloc MB", "Peak MB", "RSS MB" );
+		os << line;
+	}
+	os << endl;
+
+	double totalWall = 0.0, totalCPU = 0.0;
+	for ( size_t i = 0; i < mJobs.size(); i++ )
+	{
+		const Job &job = mJobs[i];
+		totalWall += job.wallTime;
+		totalCPU += job.cpuTime;
+
+		string jobName = job.name.empty() ? "(no job)" : job.name;
+		snprintf( line, sizeof( line ), "%-44s %12.3f %12.3f %8.1f", jobName.c_str(), 
+			job.wallTime * 1000.0, job.cpuTime * 1000.0, 100.0 );
+		os << line;
+		if ( mTrackMemory )
+		{
+			snprintf( line, sizeof( line ), " %10lld %10s %10s %10s", job.allocations, 
+				formatMegabytes( job.allocatedBytes ).c_str(), formatMegabytes( job.peakBytes ).c_str(),
+				job.peakRSS > 0 ? formatMegabytes( job.peakRSS ).c_str() : "-" );
+			os << line;
+		}
+		os << endl;
+
+		for ( size_t j = 0; j < job.phases.size(); j++ )
+		{
+			const Phase &phase = job.phases[j];
+			string name = string( 2 * (phase.depth + 1), ' ' ) + phase.name;
+			double percentage = job.wallTime > 0.0 ? phase.wallTime / job.wallTime * 100.0 : 0.0;
+			snprintf( line, sizeof( line ), "%-44s %12.3f %12.3f %8.1f", name.c_str(), 
+				phase.wallTime * 1000.0, phase.cpuTime * 1000.0, percentage );
+			os << line;
+			if ( mTrackMemory )
+			{
+				snprintf( line, sizeof( line ), " %10lld %10s %10s %10s", phase.allocations, 
+					formatMegabytes( phase.allocatedBytes ).c_str(), formatMegabytes( phase.peakBytes ).c_str(), "" );
+				os << line;
+			}
+			os << endl;
+		}
+	}
+
+	snprintf( line, sizeof( line ), "%-44s %12.3f %12.3f", "Total", totalWall * 1000.0, totalCPU * 1000.0 );
+	os << line << endl;
+
+	if ( mTrackMemory && !AllocationTracker::isHooked() )
+		os << "[Warning] No allocation hooks are installed, allocation counts are not available" << endl;
+}
+
+static void writeMeasurementJSON( ostream &os, const Profiler::Measurement &measurement, bool trackMemory )
+{
+	char number[256];
+	snprintf( number, sizeof( number ), "\"wall_ms\": %.3f, \"cpu_ms\": %.3f", 
+		measurement.wallTime * 1000.0, measurement.cpuTime * 1000.0 );
+	os << number;
+
+	if ( trackMemory )
+	{
+		snprintf( number, sizeof( number ), ", \"allocations\": %lld, \"allocated_bytes\": %lld, \"peak_bytes\": %lld", 
+			measurement.allocations, measurement.allocatedBytes, measurement.peakBytes );
+		os << number;
+	}
+}
+
+void Profiler::writeJSON( ostream &os ) const
+{
+	os << "{\n  \"jobs\": [";
+	for ( size_t i = 0; i < mJobs.size(); i++ )
+	{
+		const Job &job = mJobs[i];
+		os << (i > 0 ? "," : "") << "\n    {\"name\": " << StringUtil::toJSON( job.name ) << ", ";
+		writeMeasurementJSON( os, job, mTrackMemory );
+		if ( mTrackMemory )
+			os << ", \"peak_rss_bytes\": " << job.peakRSS;
+		os << ", \"phases\": [";
+
+		for ( size_t j = 0; j < job.phases.size(); j++ )
+		{
+			const Phase &phase = job.phases[j];
+			os << (j > 0 ? "," : "") << "\n      {\"name\": " << StringUtil::toJSON( phase.name ) 
+				<< ", \"depth\": " << phase.depth << ", ";
+			writeMeasurementJSON( os, phase, mTrackMemory );
+			os << "}";
+		}
+		os << (job.phases.empty() ? "" : "\n    ") << "]}";
+	}
+	os << (mJobs.empty() ? "" : "\n  ") << "]\n}\n";
+}
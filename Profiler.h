@@ -0,0 +1,162 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include "Common.h"
+
+class TraceLog;
+
+/**
+Records the wall clock and CPU time spent in each phase of each conversion job.
+Phases can be nested, and are listed in the order in which they started. A profiler
+belongs to a single conversion, and should only be used from one thread at a time.
+
+When memory tracking is enabled, it also records the number of heap allocations, the
+bytes allocated and the peak heap usage of every phase, and the peak resident set
+size of every job. The heap counts come from AllocationTracker, which needs its
+recording enabled as well, and cover the whole process. Every finished job and phase
+can also be sent to a TraceLog, to see how conversions on different threads overlap.
+*/
+class Profiler
+{
+public:
+	struct Measurement
+	{
+		double startTime;	// in seconds, as returned by getWallTime()
+		double wallTime;
+		double cpuTime;
+		long long allocations;
+		long long allocatedBytes;
+		long long peakBytes;	// highest heap usage above the usage at the start
+	};
+
+	struct Phase : public Measurement
+	{
+		string name;
+		int depth;
+	};
+
+	struct Job : public Measurement
+	{
+		string name;
+		long long peakRSS;
+		vector<Phase> phases;
+	};
+
+	Profiler();
+
+	void setTrackMemory( bool enable ) { mTrackMemory = enable; }
+	bool getTrackMemory() const { return mTrackMemory; }
+
+	// The trace log may be shared with other profilers, NULL disables tracing
+	void setTraceLog( TraceLog *traceLog ) { mTraceLog = traceLog; }
+
+	void beginJob( const string &name );
+	void endJob();
+
+	void beginPhase( const string &name );
+	void endPhase();
+
+	const vector<Job> &getJobs() const { return mJobs; }
+
+	void printTable( ostream &os ) const;
+	void writeJSON( ostream &os ) const;
+
+	static double getWallTime();
+	static double getCPUTime();		// of the calling thread
+
+private:
+	struct Snapshot
+	{
+		double wallStart;
+		double cpuStart;
+		long long allocations;
+		long long allocatedBytes;
+		long long currentBytes;
+		long long outerPeakBytes;
+	};
+
+	struct OpenPhase : public Snapshot
+	{
+		size_t index;
+	};
+
+	void start( Snapshot &snapshot ) const;
+	void stop( const Snapshot &snapshot, Measurement &measurement ) const;
+
+	bool mTrackMemory;
+	TraceLog *mTraceLog;
+	vector<Job> mJobs;
+	vector<OpenPhase> mOpenPhases;
+	bool mJobOpen;
+	Snapshot mJobStart;
+};
+
+/**
+Times a job for as long as it is in scope. Does nothing if the profiler is NULL.
+*/
+class ProfileJob
+{
+public:
+	ProfileJob( Profiler *profiler, const string &name ): mProfiler( profiler )
+	{
+		if ( mProfiler )
+			mProfiler->beginJob( name );
+	}
+
+	~ProfileJob()
+	{
+		if ( mProfiler )
+			mProfiler->endJob();
+	}
+
+private:
+	Profiler *mProfiler;
+};
+
+/**
+Times a phase of the current job for as long as it is in scope. Does nothing if the
+profiler is NULL.
+*/
+class ProfileScope
+{
+public:
+	ProfileScope( Profiler *profiler, const string &name ): mProfiler( profiler )
+	{
+		if ( mProfiler )
+			mProfiler->beginPhase( name );
+	}
+
+	~ProfileScope()
+	{
+		if ( mProfiler )
+			mProfiler->endPhase();
+	}
+
+private:
+	Profiler *mProfiler;
+};
+
+#endif	// __PROFILER_H__
@@ -23,38 +23,73 @@ THE SOFTWARE.
 */
 #include "Common.h"
 #include "Q2ModelToMesh.h"
+#include "ConversionStats.h"
 
-Q2ModelToMesh::Q2ModelToMesh( const GlobalOptions &globals ):
-	mGlobals( globals ), mReferenceFrame( 0 ), mIncludeNormals( false )
+Q2ModelToMesh::Q2ModelToMesh( const GlobalOptions &globals, ConversionContext &context ):
+	mGlobals( globals ), mContext( context ), mLog( context.log ), mReferenceFrame( 0 ), mIncludeNormals( false ), mTriangleStrips( false )
 {
 }
 
 bool Q2ModelToMesh::build()
 {
-	if ( !mModel.load( mInputFile ) )
+	if ( !loadModel() )
 	{
-		cout << "[Error] Could not load input file '" << mInputFile << "'" << endl;
+		mLog << "[Error] Could not load input file '" << mInputFile << "'" << endl;
 		return false;
 	}
 
+	mLog << "Loaded " << mModel.header.numSkins << " skins, " << mModel.header.numVertices << " vertices, " 
+		<< mModel.header.numTexCoords << " texture coordinates, " << mModel.header.numTriangles << " triangles, " 
+		<< mModel.header.numFrames << " frames" << endl;
+
 	if ( mReferenceFrame >= mModel.header.numFrames )
 		mReferenceFrame = 0;
 
 	restructureVertices();
+
+	if ( mTriangleStrips )
+		sortByGLCommands();
+
+	if ( mGlobals.cleanupGeometry )
+		cleanupGeometry();
+
+	if ( mContext.stats )
+	{
+		mContext.stats->addSourceGeometry( mModel.header.numVertices, mModel.header.numTriangles );
+		mContext.stats->addGeometry( (int)mNewVertices.size(), (int)mNewTriangles.size() );
+	}
+
 	convert();
 
-	cout << "Saving mesh XML file '" << mOutputFile << "'" << endl;
-	if ( !mMeshWriter.saveFile( mOutputFile ) )
+	mLog << "Saving mesh XML file '" << mOutputFile << "'" << endl;
+	if ( !mContext.writeXml( mOutputFile, mMeshWriter ) )
 	{
-		cout << "[Error] Could not save mesh XML file" << endl;
+		mLog << "[Error] Could not save mesh XML file" << endl;
 		return false;
 	}
 
 	return true;
 }
 
+bool Q2ModelToMesh::loadModel()
+{
+	ProfileScope scope( mContext.profiler, "load" );
+
+	// Only the reference frame and the animated frames are converted, so the others aren't loaded.
+	// The first frame stands in for a reference frame that is out of range.
+	set<int> frames;
+	frames.insert( mReferenceFrame );
+	frames.insert( 0 );
+	getAnimationFrames( mAnimations, frames );
+
+	// The model is read a block at a time, so the other frames are never read either
+	return mModel.load( mContext.getInputReader( mInputFile ), &frames, mTriangleStrips );
+}
+
 void Q2ModelToMesh::restructureVertices()
 {
+	ProfileScope scope( mContext.profiler, "restructure" );
+
 	typedef map<NewVertex, int> NewIndexMap;
 	NewIndexMap newIndices;
 
@@ -89,16 +124,187 @@ void Q2ModelToMesh::restructureVertices()
 	}	
 }
 
+// Identifies a triangle by its vertex indices, whichever corner it starts at and whichever way it's wound
+static long long triangleKey( const int corners[3] )
+{
+	int sorted[3] = { corners[0], corners[1], corners[2] };
+	std::sort( sorted, sorted + 3 );
+	return ((long long)sorted[0] << 42) | ((long long)sorted[1] << 21) | (long long)sorted[2];
+}
+
+void Q2ModelToMesh::sortByGLCommands()
+{
+	ProfileScope scope( mContext.profiler, "strips" );
+
+	typedef multimap<long long, int> TriangleMap;
+	TriangleMap triangles;
+	for ( size_t i = 0; i < mNewTriangles.size(); i++ )
+	{
+		int corners[3];
+		for ( int j = 0; j < 3; j++ )
+			corners[j] = mNewVertices[mNewTriangles[i].indices[j]].first;
+		triangles.insert( make_pair( triangleKey( corners ), (int)i ) );
+	}
+
+	// Every command starts with its number of vertices, negative for a fan, and ends the list at 0.
+	// Each vertex is a pair of texture coordinates followed by the vertex index.
+	IndexList order;
+	vector<bool> ordered( mNewTriangles.size(), false );
+	int numStrips = 0, numFans = 0, numUnknown = 0;
+	const int *command = mModel.glCommands;
+	const int *end = command + mModel.header.numGLCommands;
+	while ( command < end && *command != 0 )
+	{
+		int numVertices = abs( *command );
+		bool fan = *command++ < 0;
+		if ( numVertices * 3 > end - command )
+		{
+			mLog << "[Warning] The GL commands are cut short" << endl;
+			break;
+		}
+
+		if ( fan )
+			numFans++;
+		else
+			numStrips++;
+
+		for ( int i = 0; i + 2 < numVertices; i++ )
+		{
+			int corners[3] = { command[(fan ? 0 : i) * 3 + 2], command[(i + 1) * 3 + 2], command[(i + 2) * 3 + 2] };
+			TriangleMap::iterator iter = triangles.find( triangleKey( corners ) );
+			if ( iter == triangles.end() )
+			{
+				numUnknown++;
+				continue;
+			}
+
+			order.push_back( iter->second );
+			ordered[iter->second] = true;
+			triangles.erase( iter );
+		}
+		command += numVertices * 3;
+	}
+
+	int numMissing = (int)triangles.size();
+	for ( size_t i = 0; i < mNewTriangles.size(); i++ )
+	{
+		if ( !ordered[i] )
+			order.push_back( (int)i );
+	}
+
+	NewTriangleList sorted( order.size() );
+	for ( size_t i = 0; i < order.size(); i++ )
+		sorted[i] = mNewTriangles[order[i]];
+	mNewTriangles.swap( sorted );
+
+	mLog << "Sorted the triangles by " << numStrips << " strips and " << numFans << " fans from the GL commands" << endl;
+	if ( numMissing > 0 || numUnknown > 0 )
+	{
+		mLog << "[Warning] " << numMissing << " triangles are not drawn by the GL commands and " << numUnknown 
+			<< " triangles drawn by them are not in the model" << endl;
+	}
+}
+
+void Q2ModelToMesh::cleanupGeometry()
+{
+	ProfileScope scope( mContext.profiler, "cleanup" );
+
+	// Compare the reference frame first, as the weld grid is laid out on the first position
+	set<int> frameIndices;
+	getAnimationFrames( mAnimations, frameIndices );
+	frameIndices.erase( mReferenceFrame );
+
+	vector<const MD2Frame*> md2Frames( 1, &mModel.frames[mReferenceFrame] );
+	for ( set<int>::const_iterator iter = frameIndices.begin(); iter != frameIndices.end(); ++iter )
+	{
+		if ( *iter >= 0 && *iter < mModel.header.numFrames && mModel.frames[*iter].vertices )
+			md2Frames.push_back( &mModel.frames[*iter] );
+	}
+
+	int numVertices = (int)mNewVertices.size();
+	int numTriangles = (int)mNewTriangles.size();
+	vector<PositionList> frames( md2Frames.size() );
+	int stride = (int)md2Frames.size() * 6 + 2;
+	vector<float> attributes( numVertices * stride );
+	for ( size_t frame = 0; frame < md2Frames.size(); frame++ )
+	{
+		getPositions( *md2Frames[frame], frames[frame] );
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			Vector3 normal;
+			convertNormal( md2Frames[frame]->vertices[mNewVertices[i].first].normalIndex, normal );
+
+			float *vertex = &attributes[i * stride + frame * 6];
+			const Vector3 &position = frames[frame][i];
+			vertex[0] = position.x; vertex[1] = position.y; vertex[2] = position.z;
+			vertex[3] = normal.x; vertex[4] = normal.y; vertex[5] = normal.z;
+		}
+	}
+
+	for ( int i = 0; i < numVertices; i++ )
+	{
+		const MD2TexCoord &texCoord = mModel.texCoords[mNewVertices[i].second];
+		attributes[i * stride + stride - 2] = (float)texCoord.u / (float)mModel.header.skinWidth;
+		attributes[i * stride + stride - 1] = (float)texCoord.v / (float)mModel.header.skinHeight;
+	}
+
+	IndexList remap;
+	int numWelded = GeometryCleaner::weldVertices( attributes, stride, mGlobals.weldTolerance, remap );
+
+	IndexList indices;
+	for ( int i = 0; i < numTriangles; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			indices.push_back( remap[mNewTriangles[i].indices[j]] );
+	}
+	int numDegenerate = GeometryCleaner::removeDegenerateTriangles( indices, frames );
+
+	IndexList vertexOrder;
+	vector<IndexList> noOtherIndices;
+	GeometryCleaner::removeUnusedVertices( indices, noOtherIndices, numVertices, vertexOrder );
+
+	NewVertexList vertices( vertexOrder.size() );
+	for ( size_t i = 0; i < vertexOrder.size(); i++ )
+		vertices[i] = mNewVertices[vertexOrder[i]];
+	mNewVertices.swap( vertices );
+
+	mNewTriangles.resize( indices.size() / 3 );
+	for ( size_t i = 0; i < mNewTriangles.size(); i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			mNewTriangles[i].indices[j] = indices[i * 3 + j];
+	}
+
+	mLog << "Welded " << numWelded << " duplicate vertices and removed " << numDegenerate << " degenerate triangles, leaving " 
+		<< mNewVertices.size() << " of " << numVertices << " vertices and " << mNewTriangles.size() << " of " << numTriangles 
+		<< " triangles" << endl;
+}
+
 void Q2ModelToMesh::convert()
 {
     mMeshWriter.setDocType( "mesh", "ogremeshxml.dtd" );    
 	mMeshWriter.openTag( "mesh" );
 
 	// Build SubMeshes
+	mLodFaces.clear();
+	mEdgeLists = EdgeListBuilder();
 	mMeshWriter.openTag( "submeshes" );
-	buildSubMesh();
+	{
+		ProfileScope scope( mContext.profiler, "mesh build" );
+		buildSubMesh();
+	}
 	mMeshWriter.closeTag();
 
+	if ( !mLodFaces.empty() )
+		MeshSimplifier::writeLevelOfDetail( mMeshWriter, mGlobals.lodLevels, mLodFaces );
+
+	if ( mGlobals.buildEdgeLists )
+	{
+		mLog << "Built edge lists with " << mEdgeLists.getNumEdges() << " edges, " << mEdgeLists.getNumOpenEdges() 
+			<< " of them open, leaving out " << mEdgeLists.getNumDegenerateTriangles() << " degenerate triangles" << endl;
+		mEdgeLists.write( mMeshWriter );
+	}
+
 	// Build Animations
 	mMeshWriter.openTag( "animations" );
 	for ( AnimationMap::const_iterator i = mAnimations.begin(); i != mAnimations.end(); ++i )
@@ -123,50 +329,226 @@ void Q2ModelToMesh::buildSubMesh()
 	submeshNode->SetAttribute( "usesharedvertices", "false" );
 	submeshNode->SetAttribute( "operationtype", "triangle_list" );
 	
-	// Faces
-	TiXmlElement *facesNode = mMeshWriter.openTag( "faces" );
-	facesNode->SetAttribute( "count", (int)mNewTriangles.size() );
+	// Flip the index order
+	IndexList indices;
+	indices.reserve( mNewTriangles.size() * 3 );
 	for ( NewTriangleList::const_iterator i = mNewTriangles.begin(); i != mNewTriangles.end(); ++i )
 	{
-		buildFace( *i );
+		indices.push_back( i->indices[0] );
+		indices.push_back( i->indices[2] );
+		indices.push_back( i->indices[1] );
+	}
+	vector<IndexList> lodFaces;
+	optimizeFaces( indices, lodFaces );
+	if ( !lodFaces.empty() )
+		mLodFaces.push_back( lodFaces );
+
+	// Tangents are generated on the final vertex order
+	TangentList tangents;
+	if ( mGlobals.generateTangents )
+		generateTangents( indices, tangents );
+
+	if ( mGlobals.buildEdgeLists )
+	{
+		ProfileScope scope( mContext.profiler, "edge list" );
+		PositionList positions;
+		getPositions( mModel.frames[mReferenceFrame], positions );
+		mEdgeLists.addSubMesh( positions, indices, lodFaces );
+	}
+
+	IndexList strip;
+	if ( mTriangleStrips && !indices.empty() )
+	{
+		{
+			ProfileScope scope( mContext.profiler, "strips" );
+			MeshOptimizer::convertToStrip( indices, strip );
+		}
+
+		if ( strip.size() < indices.size() )
+		{
+			mLog << "Joined " << indices.size() / 3 << " triangles into a strip of " << strip.size() << " indices" << endl;
+			submeshNode->SetAttribute( "operationtype", "triangle_strip" );
+		}
+		else
+		{
+			mLog << "[Warning] A strip of " << strip.size() << " indices is no smaller than the triangle list, "
+				<< "so the triangle list is kept" << endl;
+			strip.clear();
+		}
+	}
+
+	// Faces
+	if ( !strip.empty() )
+	{
+		buildStrip( strip );
+	}
+	else
+	{
+		TiXmlElement *facesNode = mMeshWriter.openTag( "faces" );
+		facesNode->SetAttribute( "count", (int)indices.size() / 3 );
+		for ( size_t i = 0; i < indices.size(); i += 3 )
+		{
+			buildFace( &indices[i] );
+		}
+		mMeshWriter.closeTag();
 	}
-	mMeshWriter.closeTag();
 
 	// Geometry
 	TiXmlElement *geomNode = mMeshWriter.openTag( "geometry" );
 	geomNode->SetAttribute( "vertexcount", (int)mNewVertices.size() );
-	buildVertexBuffers( mModel.frames[mReferenceFrame] );
+	buildVertexBuffers( mModel.frames[mReferenceFrame], tangents );
 	mMeshWriter.closeTag();	
 	
 	mMeshWriter.closeTag();		
 }
 
-void Q2ModelToMesh::buildFace( const Q2ModelToMesh::NewTriangle &triangle )
+void Q2ModelToMesh::optimizeFaces( IndexList &indices, vector<IndexList> &lodFaces )
+{
+	int numVertices = (int)mNewVertices.size();
+
+	// Levels of detail share the submesh's operation type, so they would have to be strips as well
+	if ( mTriangleStrips && (mGlobals.optimizeVertexCache || mGlobals.optimizeOverdraw || !mGlobals.lodLevels.empty()) )
+	{
+		mLog << "[Warning] Triangle strips keep the order of the GL commands, so the triangles are not reordered "
+			<< "and no levels of detail are generated" << endl;
+	}
+
+	// Sorting clusters against overdraw only works on triangles that are in cache order already
+	if ( !mTriangleStrips && (mGlobals.optimizeVertexCache || mGlobals.optimizeOverdraw) )
+	{
+		ProfileScope scope( mContext.profiler, "vertex cache" );
+		float before = MeshOptimizer::computeACMR( indices, numVertices );
+		MeshOptimizer::optimizeVertexCache( indices, numVertices );
+		mLog << "Reordered triangles for the vertex cache, ACMR " << before << " -> " 
+			<< MeshOptimizer::computeACMR( indices, numVertices ) << endl;
+	}
+
+	if ( !mTriangleStrips && mGlobals.optimizeOverdraw )
+	{
+		ProfileScope scope( mContext.profiler, "overdraw" );
+		// Clusters are sorted on the shape of the reference frame
+		PositionList positions;
+		getPositions( mModel.frames[mReferenceFrame], positions );
+
+		float before = MeshOptimizer::computeACMR( indices, numVertices );
+		MeshOptimizer::optimizeOverdraw( indices, positions, mGlobals.overdrawThreshold );
+		mLog << "Sorted triangle clusters against overdraw, ACMR " << before << " -> " 
+			<< MeshOptimizer::computeACMR( indices, numVertices ) << endl;
+	}
+
+	if ( !mTriangleStrips && !mGlobals.lodLevels.empty() )
+	{
+		ProfileScope scope( mContext.profiler, "level of detail" );
+
+		// Collapses are judged in the reference frame and a spread of the animated frames
+		set<int> animatedFrames;
+		getAnimationFrames( mAnimations, animatedFrames );
+		vector<int> selected;
+		MeshSimplifier::selectFrames( mReferenceFrame, animatedFrames, selected );
+
+		vector<PositionList> frames;
+		for ( size_t i = 0; i < selected.size(); i++ )
+		{
+			int frameIndex = selected[i];
+			if ( frameIndex < 0 || frameIndex >= mModel.header.numFrames || !mModel.frames[frameIndex].vertices )
+				continue;
+
+			frames.push_back( PositionList() );
+			getPositions( mModel.frames[frameIndex], frames.back() );
+		}
+
+		MeshSimplifier::simplify( indices, frames, mGlobals.lodLevels, lodFaces );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+		{
+			if ( mGlobals.optimizeVertexCache )
+				MeshOptimizer::optimizeVertexCache( lodFaces[i], numVertices );
+
+			mLog << "Generated LOD level " << i + 1 << " with " << lodFaces[i].size() / 3 << " triangles" << endl;
+		}
+	}
+
+	if ( mGlobals.optimizeVertexFetch )
+	{
+		ProfileScope scope( mContext.profiler, "vertex fetch" );
+		IndexList vertexOrder;
+		MeshOptimizer::optimizeVertexFetch( indices, numVertices, vertexOrder );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+			MeshOptimizer::remapIndices( lodFaces[i], vertexOrder );
+
+		// The vertex buffer and every keyframe are written in the order of mNewVertices
+		NewVertexList vertices( mNewVertices.size() );
+		for ( size_t i = 0; i < vertexOrder.size(); i++ )
+			vertices[i] = mNewVertices[vertexOrder[i]];
+		mNewVertices.swap( vertices );
+		mLog << "Reordered vertices in the order the triangles use them" << endl;
+	}
+}
+
+void Q2ModelToMesh::buildFace( const int indices[3] )
 {
 	TiXmlElement *faceNode = mMeshWriter.openTag( "face" );
-	// Flip the index order
-	faceNode->SetAttribute( "v1", triangle.indices[0] );
-	faceNode->SetAttribute( "v2", triangle.indices[2] );
-	faceNode->SetAttribute( "v3", triangle.indices[1] );
+	faceNode->SetAttribute( "v1", indices[0] );
+	faceNode->SetAttribute( "v2", indices[1] );
+	faceNode->SetAttribute( "v3", indices[2] );
 	mMeshWriter.closeTag();
 }
 
-void Q2ModelToMesh::buildVertexBuffers( const MD2Frame &frame )
+void Q2ModelToMesh::buildStrip( const IndexList &strip )
+{
+	// The first face of a strip has all three of its vertices, every next face only adds one
+	TiXmlElement *facesNode = mMeshWriter.openTag( "faces" );
+	facesNode->SetAttribute( "count", (int)strip.size() - 2 );
+	buildFace( &strip[0] );
+	for ( size_t i = 3; i < strip.size(); i++ )
+	{
+		TiXmlElement *faceNode = mMeshWriter.openTag( "face" );
+		faceNode->SetAttribute( "v1", strip[i] );
+		mMeshWriter.closeTag();
+	}
+	mMeshWriter.closeTag();
+}
+
+void Q2ModelToMesh::generateTangents( const IndexList &indices, TangentList &tangents )
+{
+	ProfileScope scope( mContext.profiler, "tangents" );
+
+	const MD2Frame &frame = mModel.frames[mReferenceFrame];
+	PositionList positions, normals( mNewVertices.size() );
+	vector<float> texCoords( mNewVertices.size() * 2 );
+	getPositions( frame, positions );
+	for ( size_t i = 0; i < mNewVertices.size(); i++ )
+	{
+		convertNormal( frame.vertices[mNewVertices[i].first].normalIndex, normals[i] );
+
+		const MD2TexCoord &texCoord = mModel.texCoords[mNewVertices[i].second];
+		texCoords[i * 2] = (float)texCoord.u / (float)mModel.header.skinWidth;
+		texCoords[i * 2 + 1] = (float)texCoord.v / (float)mModel.header.skinHeight;
+	}
+
+	TangentGenerator::generate( indices, positions, normals, texCoords, tangents );
+}
+
+void Q2ModelToMesh::buildVertexBuffers( const MD2Frame &frame, const TangentList &tangents )
 {
 	// Vertices and normals
 	TiXmlElement *vbNode = mMeshWriter.openTag( "vertexbuffer" );
 	vbNode->SetAttribute( "positions", "true" );
 	vbNode->SetAttribute( "normals", "true" );
+	if ( !tangents.empty() )
+	{
+		vbNode->SetAttribute( "tangents", "true" );
+		vbNode->SetAttribute( "tangent_dimensions", 4 );
+	}
 	vbNode->SetAttribute( "texture_coords", 1 );
 	vbNode->SetAttribute( "texture_coord_dimensions_0", 2 );	
 	for ( int i = 0; i < (int)mNewVertices.size(); i++ )
 	{
-		buildVertex( frame, i );
+		buildVertex( frame, i, tangents.empty() ? NULL : &tangents[i] );
 	}
 	mMeshWriter.closeTag();
 }
 
-void Q2ModelToMesh::buildVertex( const MD2Frame &frame, int vertIndex )
+void Q2ModelToMesh::buildVertex( const MD2Frame &frame, int vertIndex, const Tangent *tangent )
 {
 	const NewVertex &newVert = mNewVertices[vertIndex];
 	const MD2Vertex &vert = frame.vertices[newVert.first];	
@@ -190,6 +572,17 @@ void Q2ModelToMesh::buildVertex( const MD2Frame &frame, int vertIndex )
 	normNode->SetAttribute( "y", StringUtil::toString( normal.y ) );
 	normNode->SetAttribute( "z", StringUtil::toString( normal.z ) );
 	mMeshWriter.closeTag();
+
+	// Tangent
+	if ( tangent )
+	{
+		TiXmlElement *tangentNode = mMeshWriter.openTag( "tangent" );
+		tangentNode->SetAttribute( "x", StringUtil::toString( tangent->direction.x ) );
+		tangentNode->SetAttribute( "y", StringUtil::toString( tangent->direction.y ) );
+		tangentNode->SetAttribute( "z", StringUtil::toString( tangent->direction.z ) );
+		tangentNode->SetAttribute( "w", StringUtil::toString( tangent->handedness ) );
+		mMeshWriter.closeTag();
+	}
 	
 	// Texture coordinates
 	const MD2TexCoord &texCoord = mModel.texCoords[newVert.second];
@@ -203,7 +596,8 @@ void Q2ModelToMesh::buildVertex( const MD2Frame &frame, int vertIndex )
 
 void Q2ModelToMesh::buildAnimation( const string &name, const AnimationInfo &animInfo )
 {
-	cout << "Building animation '" << name << "'" << endl;
+	ProfileScope scope( mContext.profiler, "animation '" + name + "'" );
+	mLog << "Building animation '" << name << "'" << endl;
 
 	TiXmlElement *animNode = mMeshWriter.openTag( "animation" );
 	animNode->SetAttribute( "name", name );
@@ -213,6 +607,9 @@ void Q2ModelToMesh::buildAnimation( const string &name, const AnimationInfo &ani
 	buildTrack( animInfo );
 	mMeshWriter.closeTag();
 
+	if ( mContext.stats )
+		mContext.stats->addAnimation( name, 1, animInfo.numFrames );
+
 	mMeshWriter.closeTag();
 }
 
@@ -229,8 +626,11 @@ void Q2ModelToMesh::buildTrack( const AnimationInfo &animInfo )
 	mMeshWriter.openTag( "keyframes" );
 	for ( int i = 0; i < animInfo.numFrames; i++ )
 	{
-		const MD2Frame &frame = mModel.frames[animInfo.startFrame + i];
-		buildKeyframe( frame, time );
+		int frameIndex = animInfo.startFrame + i;
+		if ( frameIndex >= 0 && frameIndex < mModel.header.numFrames )
+			buildKeyframe( mModel.frames[frameIndex], time );
+		else
+			mLog << "[Warning] Frame " << frameIndex << " does not exist, skipping it" << endl;
 		time += timePerFrame;
 	}
 	mMeshWriter.closeTag();
@@ -271,6 +671,13 @@ void Q2ModelToMesh::buildKeyframe( const MD2Frame &frame, float time )
 	mMeshWriter.closeTag();
 }
 
+void Q2ModelToMesh::getPositions( const MD2Frame &frame, PositionList &positions )
+{
+	positions.resize( mNewVertices.size() );
+	for ( size_t i = 0; i < mNewVertices.size(); i++ )
+		convertPosition( frame.vertices[mNewVertices[i].first].vertex, frame.header, positions[i] );
+}
+
 void Q2ModelToMesh::convertPosition( const unsigned char position[3], const MD2FrameHeader &frameHeader, Vector3 &dest )
 {
 	dest.x = (position[0] * frameHeader.scale.x) + frameHeader.translate.x;
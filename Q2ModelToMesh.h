@@ -25,14 +25,20 @@ THE SOFTWARE.
 #define __Q2MODELTOMESH_H__
 
 #include "XmlWriter.h"
+#include "ConversionContext.h"
 #include "MD2Model.h"
 #include "Animation.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+#include "EdgeListBuilder.h"
+#include "GeometryCleaner.h"
 #include "vector.h"
 
 class Q2ModelToMesh
 {
 public:
-	Q2ModelToMesh( const GlobalOptions &globals );
+	Q2ModelToMesh( const GlobalOptions &globals, ConversionContext &context );
 
 	bool build();
 
@@ -42,8 +48,13 @@ public:
 	void setReferenceFrame( int frame ) { mReferenceFrame = frame; }
 	AnimationInfo &getAnimation( const string &name ) { return mAnimations[name]; }
 	void setIncludeNormals( bool enable ) { mIncludeNormals = enable; }
+	void setTriangleStrips( bool enable ) { mTriangleStrips = enable; }
 
 private:
+	friend class Benchmark;
+
+	bool loadModel();
+
 	struct NewTriangle
 	{
 		int indices[3];
@@ -64,21 +75,41 @@ private:
 	*/
 	void restructureVertices();
 
+	/**
+	MD2 files come with a list of GL commands that draw the model as triangle strips and fans.
+	The triangles are put in the order of these commands, so that they join into long strips.
+	Triangles are matched on their vertex indices only, so the vertices stay the way
+	restructureVertices made them; triangles that no command draws go last.
+	*/
+	void sortByGLCommands();
+
+	/**
+	Welds vertices that match in position and normal in every converted frame and in their
+	texture coordinates, then drops the triangles without area and the unused vertices.
+	*/
+	void cleanupGeometry();
+
 	void convert();
 
 	void buildSubMesh();
-	void buildFace( const NewTriangle &triangle );
-	void buildVertexBuffers( const MD2Frame &frame );
-	void buildVertex( const MD2Frame &frame, int vertIndex );
+	void optimizeFaces( IndexList &indices, vector<IndexList> &lodFaces );
+	void buildFace( const int indices[3] );
+	void buildStrip( const IndexList &strip );
+	void generateTangents( const IndexList &indices, TangentList &tangents );
+	void buildVertexBuffers( const MD2Frame &frame, const TangentList &tangents );
+	void buildVertex( const MD2Frame &frame, int vertIndex, const Tangent *tangent );
 
 	void buildAnimation( const string &name, const AnimationInfo &animInfo );
 	void buildTrack( const AnimationInfo &animInfo );
 	void buildKeyframe( const MD2Frame &frame, float time );
 	
+	void getPositions( const MD2Frame &frame, PositionList &positions );
 	void convertPosition( const unsigned char position[3], const MD2FrameHeader &frameHeader, Vector3 &dest );
 	void convertNormal( const unsigned char normalIndex, Vector3 &dest );
 
 	const GlobalOptions &mGlobals;
+	ConversionContext &mContext;
+	ostream &mLog;
 
 	XmlWriter mMeshWriter;
 
@@ -87,7 +118,10 @@ private:
 	string mMaterial;
 	int mReferenceFrame;
 	AnimationMap mAnimations;
+	vector< vector<IndexList> > mLodFaces;	// Per submesh and level of detail
+	EdgeListBuilder mEdgeLists;
 	bool mIncludeNormals;
+	bool mTriangleStrips;
 
 	MD2Model mModel;
 };
@@ -23,58 +23,129 @@ THE SOFTWARE.
 */
 #include "Common.h"
 #include "Q3ModelToMesh.h"
+#include "ThreadPool.h"
+#include "ConversionStats.h"
 
-Q3ModelToMesh::Q3ModelToMesh( const GlobalOptions &globals ):
-	mGlobals( globals ), mReferenceFrame( 0 ), mIncludeNormals( false )
+Q3ModelToMesh::Q3ModelToMesh( const GlobalOptions &globals, ConversionContext &context ):
+	mGlobals( globals ), mContext( context ), mLog( context.log ), mReferenceFrame( 0 ), mIncludeNormals( false )
 {
 }
 
 bool Q3ModelToMesh::build()
 {
-	if ( !mModel.load( mInputFile ) )
+	if ( !loadModel() )
 	{
-		cout << "[Error] Could not load input file '" << mInputFile << "'" << endl;
+		mLog << "[Error] Could not load input file '" << mInputFile << "'" << endl;
 		return false;
 	}
 
+	mLog << "Loaded " << mModel.header.numFrames << " frames, " << mModel.header.numMeshes << " meshes" << endl;
+
 	if ( mReferenceFrame >= mModel.header.numFrames )
 		mReferenceFrame = 0;
 
 	convert();
 
-	cout << "Saving mesh XML file '" << mOutputFile << "'" << endl;
-	if ( !mMeshWriter.saveFile( mOutputFile ) )
+	mLog << "Saving mesh XML file '" << mOutputFile << "'" << endl;
+	if ( !mContext.writeXml( mOutputFile, mMeshWriter ) )
 	{
-		cout << "[Error] Could not save mesh XML file" << endl;
+		mLog << "[Error] Could not save mesh XML file" << endl;
 		return false;
 	}
 
 	return true;
 }
 
+bool Q3ModelToMesh::loadModel()
+{
+	ProfileScope scope( mContext.profiler, "load" );
+
+	// Only the reference frame and the animated frames are converted, so the others aren't loaded.
+	// The first frame stands in for a reference frame that is out of range.
+	set<int> frames;
+	frames.insert( mReferenceFrame );
+	frames.insert( 0 );
+	getAnimationFrames( mAnimations, frames );
+
+	// The model is read a block at a time, so the vertices of the other frames are never read either
+	return mModel.load( mContext.getInputReader( mInputFile ), &frames );
+}
+
 void Q3ModelToMesh::convert()
 {
     mMeshWriter.setDocType( "mesh", "ogremeshxml.dtd" );
 	mMeshWriter.openTag( "mesh" );
 
-	// Build SubMeshes
-	mMeshWriter.openTag( "submeshes" );
-	for ( int i = 0; i < mModel.header.numMeshes; i++ )
 	{
-		buildSubMesh( mModel.meshes[i] );
-	}
-	mMeshWriter.closeTag();
+		ProfileScope scope( mContext.profiler, "mesh build" );
 
-	// Collect SubMesh names
-	mMeshWriter.openTag( "submeshnames" );
-	for ( int i = 0; i < mModel.header.numMeshes; i++ )
-	{
-		TiXmlElement *smnameNode = mMeshWriter.openTag( "submeshname" );
-		smnameNode->SetAttribute( "name", StringUtil::toString( mModel.meshes[i].header.name, 64 ) );
-		smnameNode->SetAttribute( "index", i );
+		// Build SubMeshes
+		mVertexOrders.resize( mModel.header.numMeshes );
+		mLodFaces.clear();
+		mEdgeLists = EdgeListBuilder( mGlobals.sharedGeometry );
+		mTangents.assign( mModel.header.numMeshes, TangentList() );
+
+		for ( int i = 0; i < mModel.header.numMeshes; i++ )
+		{
+			MD3Mesh &mesh = mModel.meshes[i];
+			if ( mContext.stats )
+				mContext.stats->addSourceGeometry( mesh.header.numVertices, mesh.header.numTriangles );
+
+			if ( mGlobals.cleanupGeometry )
+				cleanupGeometry( mesh );
+		}
+
+		if ( mGlobals.generateTangents )
+			generateTangents();
+
+		groupSurfaces();
+
+		// Shared geometry is written before the submeshes, so all faces are optimised first
+		mSubMeshFaces.resize( mSubMeshSurfaces.size() );
+		mSharedSurfaces.clear();
+		for ( size_t i = 0; i < mSubMeshSurfaces.size(); i++ )
+		{
+			optimizeSubMesh( (int)i );
+			if ( mGlobals.sharedGeometry )
+				mSharedSurfaces.insert( mSharedSurfaces.end(), mSubMeshSurfaces[i].begin(), mSubMeshSurfaces[i].end() );
+		}
+
+		if ( mGlobals.sharedGeometry )
+		{
+			TiXmlElement *geomNode = mMeshWriter.openTag( "sharedgeometry" );
+			geomNode->SetAttribute( "vertexcount", getNumVertices( mSharedSurfaces ) );
+			buildVertexBuffers( mSharedSurfaces );
+			mMeshWriter.closeTag();
+		}
+
+		mMeshWriter.openTag( "submeshes" );
+		for ( size_t i = 0; i < mSubMeshSurfaces.size(); i++ )
+		{
+			buildSubMesh( (int)i );
+		}
+		mMeshWriter.closeTag();
+
+		// Collect SubMesh names, merged submeshes being named after their first surface
+		mMeshWriter.openTag( "submeshnames" );
+		for ( size_t i = 0; i < mSubMeshSurfaces.size(); i++ )
+		{
+			TiXmlElement *smnameNode = mMeshWriter.openTag( "submeshname" );
+			smnameNode->SetAttribute( "name", StringUtil::toString( mModel.meshes[mSubMeshSurfaces[i][0]].header.name, 64 ) );
+			smnameNode->SetAttribute( "index", (int)i );
+			mMeshWriter.closeTag();
+		}
 		mMeshWriter.closeTag();
+
+		if ( !mLodFaces.empty() )
+			MeshSimplifier::writeLevelOfDetail( mMeshWriter, mGlobals.lodLevels, mLodFaces );
+
+		if ( mGlobals.buildEdgeLists )
+		{
+			mLog << "Built edge lists with " << mEdgeLists.getNumEdges() << " edges, " << mEdgeLists.getNumOpenEdges() 
+				<< " of them open, leaving out " << mEdgeLists.getNumDegenerateTriangles() << " degenerate triangles" << endl;
+			mEdgeLists.write( mMeshWriter );
+		}
 	}
-	mMeshWriter.closeTag();
 
 	// Build Animations
 	mMeshWriter.openTag( "animations" );
@@ -87,70 +158,381 @@ void Q3ModelToMesh::convert()
 	mMeshWriter.closeTag();
 }
 
-void Q3ModelToMesh::buildSubMesh( const MD3Mesh &mesh )
+string Q3ModelToMesh::getMaterialName( const MD3Mesh &mesh ) const
 {
-	cout << "Building SubMesh '" << mesh.header.name << "'" << endl;
-
-	// Determine what submesh's material name should be
 	// Either straight from the MD3 structure, or from the supplied material names
-	string materialName;
 	StringMap::const_iterator iter = mMaterials.find( mesh.header.name );
 	if ( iter != mMaterials.end() )
-		materialName = iter->second;	
-	else
-		materialName = StringUtil::toString( mesh.shaders[0].name, 64 );
+		return iter->second;
+
+	return StringUtil::toString( mesh.shaders[0].name, 64 );
+}
+
+void Q3ModelToMesh::groupSurfaces()
+{
+	mSubMeshSurfaces.clear();
+	vector<string> materials;
+	for ( int i = 0; i < mModel.header.numMeshes; i++ )
+	{
+		const MD3Mesh &mesh = mModel.meshes[i];
+		string materialName = getMaterialName( mesh );
+
+		size_t subMesh = mGlobals.mergeSubMeshes ? 
+			std::find( materials.begin(), materials.end(), materialName ) - materials.begin() : materials.size();
+		if ( subMesh == materials.size() )
+		{
+			materials.push_back( materialName );
+			mSubMeshSurfaces.push_back( IndexList() );
+		}
+		else
+		{
+			mLog << "Merging surface '" << mesh.header.name << "' into SubMesh '" 
+				<< mModel.meshes[mSubMeshSurfaces[subMesh][0]].header.name << "', as both use material '" << materialName << "'" << endl;
+		}
+		mSubMeshSurfaces[subMesh].push_back( i );
+	}
+}
+
+int Q3ModelToMesh::getNumVertices( const IndexList &surfaces ) const
+{
+	int numVertices = 0;
+	for ( size_t s = 0; s < surfaces.size(); s++ )
+	{
+		const IndexList &vertexOrder = mVertexOrders[surfaces[s]];
+		numVertices += vertexOrder.empty() ? mModel.meshes[surfaces[s]].header.numVertices : (int)vertexOrder.size();
+	}
+	return numVertices;
+}
+
+void Q3ModelToMesh::optimizeSubMesh( int subMeshIndex )
+{
+	const IndexList &surfaces = mSubMeshSurfaces[subMeshIndex];
+	const MD3Mesh &firstMesh = mModel.meshes[surfaces[0]];
+
+	ProfileScope scope( mContext.profiler, "submesh '" + StringUtil::toString( firstMesh.header.name, 64 ) + "'" );
+	mLog << "Building SubMesh '" << firstMesh.header.name << "'" << endl;
+
+	// Merged surfaces follow one another in the vertex buffer, each optimised on its own
+	IndexList indices;
+	vector<IndexList> lodFaces;
+	PositionList written;
+	int numVertices = 0;
+	for ( size_t s = 0; s < surfaces.size(); s++ )
+	{
+		const MD3Mesh &mesh = mModel.meshes[surfaces[s]];
+
+		// Quake 3 has its face direction the other way round, so flip the index order
+		IndexList surfaceIndices;
+		surfaceIndices.reserve( mesh.header.numTriangles * 3 );
+		for ( int i = 0; i < mesh.header.numTriangles; i++ )
+		{
+			const MD3Triangle &triangle = mesh.triangles[i];
+			surfaceIndices.push_back( triangle.indices[0] );
+			surfaceIndices.push_back( triangle.indices[2] );
+			surfaceIndices.push_back( triangle.indices[1] );
+		}
+		IndexList &vertexOrder = mVertexOrders[surfaces[s]];
+		vector<IndexList> surfaceLodFaces;
+		optimizeFaces( mesh, surfaceIndices, vertexOrder, surfaceLodFaces );
+
+		// MD3 surfaces are already stored the way Ogre wants them, apart from the vertices cleanup left out
+		int numSurfaceVertices = vertexOrder.empty() ? mesh.header.numVertices : (int)vertexOrder.size();
+		if ( mContext.stats )
+			mContext.stats->addGeometry( numSurfaceVertices, (int)surfaceIndices.size() / 3 );
+
+		MeshOptimizer::appendIndices( indices, surfaceIndices, numVertices );
+		lodFaces.resize( surfaceLodFaces.size() );
+		for ( size_t i = 0; i < surfaceLodFaces.size(); i++ )
+			MeshOptimizer::appendIndices( lodFaces[i], surfaceLodFaces[i], numVertices );
+
+		if ( mGlobals.buildEdgeLists )
+		{
+			PositionList positions;
+			getPositions( mesh, mModel.getVertices( mesh, mReferenceFrame ), positions );
+			for ( int i = 0; i < numSurfaceVertices; i++ )
+				written.push_back( positions[vertexOrder.empty() ? i : vertexOrder[i]] );
+		}
+
+		numVertices += numSurfaceVertices;
+	}
+
+	if ( mGlobals.buildEdgeLists )
+	{
+		ProfileScope scope( mContext.profiler, "edge list" );
+		mEdgeLists.addSubMesh( written, indices, lodFaces );
+	}
+
+	// Shared geometry holds the vertices of the previous submeshes first
+	int vertexOffset = 0;
+	if ( mGlobals.sharedGeometry )
+	{
+		for ( int i = 0; i < subMeshIndex; i++ )
+			vertexOffset += getNumVertices( mSubMeshSurfaces[i] );
+	}
+
+	mSubMeshFaces[subMeshIndex].clear();
+	MeshOptimizer::appendIndices( mSubMeshFaces[subMeshIndex], indices, vertexOffset );
+	if ( !lodFaces.empty() )
+	{
+		mLodFaces.push_back( vector<IndexList>( lodFaces.size() ) );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+			MeshOptimizer::appendIndices( mLodFaces.back()[i], lodFaces[i], vertexOffset );
+	}
+}
+
+void Q3ModelToMesh::buildSubMesh( int subMeshIndex )
+{
+	const IndexList &surfaces = mSubMeshSurfaces[subMeshIndex];
+	const IndexList &indices = mSubMeshFaces[subMeshIndex];
 
 	TiXmlElement *submeshNode = mMeshWriter.openTag( "submesh" );
-	submeshNode->SetAttribute( "material", materialName );
-	submeshNode->SetAttribute( "usesharedvertices", "false" );
+	submeshNode->SetAttribute( "material", getMaterialName( mModel.meshes[surfaces[0]] ) );
+	submeshNode->SetAttribute( "usesharedvertices", mGlobals.sharedGeometry ? "true" : "false" );
 	submeshNode->SetAttribute( "operationtype", "triangle_list" );
 
 	// Faces
 	TiXmlElement *facesNode = mMeshWriter.openTag( "faces" );
-	facesNode->SetAttribute( "count", mesh.header.numTriangles );
-	for ( int i = 0; i < mesh.header.numTriangles; i++ )
+	facesNode->SetAttribute( "count", (int)indices.size() / 3 );
+	for ( size_t i = 0; i < indices.size(); i += 3 )
 	{
-		buildFace( mesh.triangles[i] );
+		buildFace( &indices[i] );
 	}
 	mMeshWriter.closeTag();
 
 	// Geometry
-	TiXmlElement *geomNode = mMeshWriter.openTag( "geometry" );
-	geomNode->SetAttribute( "vertexcount", mesh.header.numVertices );
-	buildVertexBuffers( mesh );
-	mMeshWriter.closeTag();
+	if ( !mGlobals.sharedGeometry )
+	{
+		TiXmlElement *geomNode = mMeshWriter.openTag( "geometry" );
+		geomNode->SetAttribute( "vertexcount", getNumVertices( surfaces ) );
+		buildVertexBuffers( surfaces );
+		mMeshWriter.closeTag();
+	}
 
 	mMeshWriter.closeTag();
 }
 
-void Q3ModelToMesh::buildFace( const MD3Triangle &triangle )
+void Q3ModelToMesh::optimizeFaces( const MD3Mesh &mesh, IndexList &indices, IndexList &vertexOrder, vector<IndexList> &lodFaces )
+{
+	int numVertices = mesh.header.numVertices;
+
+	// Sorting clusters against overdraw only works on triangles that are in cache order already
+	if ( mGlobals.optimizeVertexCache || mGlobals.optimizeOverdraw )
+	{
+		ProfileScope scope( mContext.profiler, "vertex cache" );
+		float before = MeshOptimizer::computeACMR( indices, numVertices );
+		MeshOptimizer::optimizeVertexCache( indices, numVertices );
+		mLog << "Reordered triangles for the vertex cache, ACMR " << before << " -> " 
+			<< MeshOptimizer::computeACMR( indices, numVertices ) << endl;
+	}
+
+	if ( mGlobals.optimizeOverdraw )
+	{
+		ProfileScope scope( mContext.profiler, "overdraw" );
+		// Clusters are sorted on the shape of the reference frame
+		PositionList positions;
+		getPositions( mesh, mModel.getVertices( mesh, mReferenceFrame ), positions );
+
+		float before = MeshOptimizer::computeACMR( indices, numVertices );
+		MeshOptimizer::optimizeOverdraw( indices, positions, mGlobals.overdrawThreshold );
+		mLog << "Sorted triangle clusters against overdraw, ACMR " << before << " -> " 
+			<< MeshOptimizer::computeACMR( indices, numVertices ) << endl;
+	}
+
+	if ( !mGlobals.lodLevels.empty() )
+	{
+		ProfileScope scope( mContext.profiler, "level of detail" );
+
+		// Collapses are judged in the reference frame and a spread of the animated frames
+		set<int> animatedFrames;
+		getAnimationFrames( mAnimations, animatedFrames );
+		vector<int> selected;
+		MeshSimplifier::selectFrames( mReferenceFrame, animatedFrames, selected );
+
+		vector<PositionList> frames;
+		for ( size_t i = 0; i < selected.size(); i++ )
+		{
+			const MD3Vertex *verts = mModel.getVertices( mesh, selected[i] );
+			if ( !verts )
+				continue;
+
+			frames.push_back( PositionList() );
+			getPositions( mesh, verts, frames.back() );
+		}
+
+		MeshSimplifier::simplify( indices, frames, mGlobals.lodLevels, lodFaces );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+		{
+			if ( mGlobals.optimizeVertexCache )
+				MeshOptimizer::optimizeVertexCache( lodFaces[i], numVertices );
+
+			mLog << "Generated LOD level " << i + 1 << " with " << lodFaces[i].size() / 3 << " triangles" << endl;
+		}
+	}
+
+	if ( mGlobals.optimizeVertexFetch )
+	{
+		ProfileScope scope( mContext.profiler, "vertex fetch" );
+		MeshOptimizer::optimizeVertexFetch( indices, numVertices, vertexOrder );
+		for ( size_t i = 0; i < lodFaces.size(); i++ )
+			MeshOptimizer::remapIndices( lodFaces[i], vertexOrder );
+		mLog << "Reordered vertices in the order the triangles use them" << endl;
+	}
+
+	if ( mGlobals.cleanupGeometry )
+	{
+		int numUnused = GeometryCleaner::removeUnusedVertices( indices, lodFaces, numVertices, vertexOrder );
+		mLog << "Removed " << numUnused << " vertices that no triangle uses, leaving " << vertexOrder.size() 
+			<< " of " << numVertices << " vertices" << endl;
+	}
+}
+
+void Q3ModelToMesh::cleanupGeometry( MD3Mesh &mesh )
+{
+	ProfileScope scope( mContext.profiler, "cleanup" );
+
+	// Compare the reference frame first, as the weld grid is laid out on the first position
+	vector<const MD3Vertex*> md3Frames( 1, mModel.getVertices( mesh, mReferenceFrame ) );
+	for ( int i = 0; i < mModel.header.numFrames; i++ )
+	{
+		const MD3Vertex *verts = mModel.getVertices( mesh, i );
+		if ( verts && i != mReferenceFrame )
+			md3Frames.push_back( verts );
+	}
+
+	int numVertices = mesh.header.numVertices;
+	int numTriangles = mesh.header.numTriangles;
+	vector<PositionList> frames( md3Frames.size() );
+	int stride = (int)md3Frames.size() * 6 + 2;
+	vector<float> attributes( numVertices * stride );
+	for ( size_t frame = 0; frame < md3Frames.size(); frame++ )
+	{
+		getPositions( mesh, md3Frames[frame], frames[frame] );
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			Vector3 normal;
+			convertNormal( md3Frames[frame][i].normal, normal );
+
+			float *vertex = &attributes[i * stride + frame * 6];
+			const Vector3 &position = frames[frame][i];
+			vertex[0] = position.x; vertex[1] = position.y; vertex[2] = position.z;
+			vertex[3] = normal.x; vertex[4] = normal.y; vertex[5] = normal.z;
+		}
+	}
+
+	for ( int i = 0; i < numVertices; i++ )
+	{
+		attributes[i * stride + stride - 2] = mesh.texCoords[i].uv[0];
+		attributes[i * stride + stride - 1] = mesh.texCoords[i].uv[1];
+	}
+
+	IndexList remap;
+	int numWelded = GeometryCleaner::weldVertices( attributes, stride, mGlobals.weldTolerance, remap );
+
+	IndexList indices;
+	for ( int i = 0; i < numTriangles; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			indices.push_back( remap[mesh.triangles[i].indices[j]] );
+	}
+	int numDegenerate = GeometryCleaner::removeDegenerateTriangles( indices, frames );
+
+	// Fewer triangles remain, so they fit in the surface's own array
+	mesh.header.numTriangles = (int)indices.size() / 3;
+	for ( int i = 0; i < mesh.header.numTriangles; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			mesh.triangles[i].indices[j] = indices[i * 3 + j];
+	}
+
+	mLog << "Welded " << numWelded << " duplicate vertices in surface '" << StringUtil::toString( mesh.header.name, 64 ) 
+		<< "' and removed " << numDegenerate << " degenerate triangles, leaving " << mesh.header.numTriangles << " of " 
+		<< numTriangles << " triangles" << endl;
+}
+
+void Q3ModelToMesh::buildFace( const int indices[3] )
 {
 	TiXmlElement *faceNode = mMeshWriter.openTag( "face" );
-	// Quake 3 has its face direction the other way round, so flip the index order
-	faceNode->SetAttribute( "v1", triangle.indices[0] );
-	faceNode->SetAttribute( "v2", triangle.indices[2] );
-	faceNode->SetAttribute( "v3", triangle.indices[1] );
+	faceNode->SetAttribute( "v1", indices[0] );
+	faceNode->SetAttribute( "v2", indices[1] );
+	faceNode->SetAttribute( "v3", indices[2] );
 	mMeshWriter.closeTag();
 }
 
-void Q3ModelToMesh::buildVertexBuffers( const MD3Mesh &mesh )
+void Q3ModelToMesh::generateTangents()
+{
+	ProfileScope scope( mContext.profiler, "tangents" );
+
+	// Every surface fills in its own list, so they need no locking
+	int numMeshes = mModel.header.numMeshes;
+	if ( !mContext.workers )
+	{
+		for ( int i = 0; i < numMeshes; i++ )
+			generateTangents( mModel.meshes[i], mTangents[i] );
+		return;
+	}
+
+	mContext.workers->parallelFor( numMeshes, [this]( int i )
+	{
+		generateTangents( mModel.meshes[i], mTangents[i] );
+	} );
+}
+
+void Q3ModelToMesh::generateTangents( const MD3Mesh &mesh, TangentList &tangents )
 {
-	const MD3Vertex *verts = &mesh.vertices[mReferenceFrame * mesh.header.numVertices];
+	const MD3Vertex *verts = mModel.getVertices( mesh, mReferenceFrame );
+	int numVertices = mesh.header.numVertices;
+
+	PositionList positions, normals( numVertices );
+	vector<float> texCoords( numVertices * 2 );
+	getPositions( mesh, verts, positions );
+	for ( int i = 0; i < numVertices; i++ )
+	{
+		convertNormal( verts[i].normal, normals[i] );
+		texCoords[i * 2] = mesh.texCoords[i].uv[0];
+		texCoords[i * 2 + 1] = mesh.texCoords[i].uv[1];
+	}
+
+	IndexList indices( mesh.header.numTriangles * 3 );
+	for ( int i = 0; i < mesh.header.numTriangles; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			indices[i * 3 + j] = mesh.triangles[i].indices[j];
+	}
 
+	TangentGenerator::generate( indices, positions, normals, texCoords, tangents );
+}
+
+void Q3ModelToMesh::buildVertexBuffers( const IndexList &surfaces )
+{
 	// Vertices and normals
 	TiXmlElement *vbNode = mMeshWriter.openTag( "vertexbuffer" );
 	vbNode->SetAttribute( "positions", "true" );
 	vbNode->SetAttribute( "normals", "true" );
+	if ( mGlobals.generateTangents )
+	{
+		vbNode->SetAttribute( "tangents", "true" );
+		vbNode->SetAttribute( "tangent_dimensions", 4 );
+	}
 	vbNode->SetAttribute( "texture_coords", 1 );
 	vbNode->SetAttribute( "texture_coord_dimensions_0", 2 );	
-	for ( int i = 0; i < mesh.header.numVertices; i++ )
+	for ( size_t s = 0; s < surfaces.size(); s++ )
 	{
-		buildVertex( verts[i], mesh.texCoords[i] );
+		const MD3Mesh &mesh = mModel.meshes[surfaces[s]];
+		const MD3Vertex *verts = mModel.getVertices( mesh, mReferenceFrame );
+		const IndexList &vertexOrder = mVertexOrders[surfaces[s]];
+		const TangentList &tangents = mTangents[surfaces[s]];
+
+		int numVertices = vertexOrder.empty() ? mesh.header.numVertices : (int)vertexOrder.size();
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			int vertIndex = vertexOrder.empty() ? i : vertexOrder[i];
+			buildVertex( verts[vertIndex], mesh.texCoords[vertIndex], tangents.empty() ? NULL : &tangents[vertIndex] );
+		}
 	}
 	mMeshWriter.closeTag();
 }
 
-void Q3ModelToMesh::buildVertex( const MD3Vertex &vert, const MD3TexCoord &texCoord )
+void Q3ModelToMesh::buildVertex( const MD3Vertex &vert, const MD3TexCoord &texCoord, const Tangent *tangent )
 {
 	Vector3 position, normal;
 	convertPosition( vert.position, position );
@@ -172,6 +554,17 @@ void Q3ModelToMesh::buildVertex( const MD3Vertex &vert, const MD3TexCoord &texCo
 	normNode->SetAttribute( "z", StringUtil::toString( normal.z ) );
 	mMeshWriter.closeTag();
 
+	// Tangent
+	if ( tangent )
+	{
+		TiXmlElement *tangentNode = mMeshWriter.openTag( "tangent" );
+		tangentNode->SetAttribute( "x", StringUtil::toString( tangent->direction.x ) );
+		tangentNode->SetAttribute( "y", StringUtil::toString( tangent->direction.y ) );
+		tangentNode->SetAttribute( "z", StringUtil::toString( tangent->direction.z ) );
+		tangentNode->SetAttribute( "w", StringUtil::toString( tangent->handedness ) );
+		mMeshWriter.closeTag();
+	}
+
     // Texture coordinates
 	TiXmlElement *tcNode = mMeshWriter.openTag( "texcoord" );
 	tcNode->SetAttribute( "u", StringUtil::toString( texCoord.uv[0] ) );
@@ -183,30 +576,50 @@ void Q3ModelToMesh::buildVertex( const MD3Vertex &vert, const MD3TexCoord &texCo
 
 void Q3ModelToMesh::buildAnimation( const string &name, const AnimationInfo &animInfo )
 {
-	cout << "Building animation '" << name << "'" << endl;
+	ProfileScope scope( mContext.profiler, "animation '" + name + "'" );
+	mLog << "Building animation '" << name << "'" << endl;
 
 	TiXmlElement *animNode = mMeshWriter.openTag( "animation" );
 	animNode->SetAttribute( "name", name );
 	animNode->SetAttribute( "length", StringUtil::toString( (float)animInfo.numFrames / (float)animInfo.framesPerSecond ) );
 
+	// Shared geometry is animated by a single track for the whole mesh
+	int numTracks = mGlobals.sharedGeometry ? 1 : (int)mSubMeshSurfaces.size();
 	mMeshWriter.openTag( "tracks" );
-	for ( int i = 0; i < mModel.header.numMeshes; i++ )
+	if ( mGlobals.sharedGeometry )
+	{
+		buildTrack( -1, animInfo );
+	}
+	else
 	{
-		buildTrack( i, animInfo );
+		for ( int i = 0; i < numTracks; i++ )
+		{
+			buildTrack( i, animInfo );
+		}
 	}
 	mMeshWriter.closeTag();
 
+	if ( mContext.stats )
+		mContext.stats->addAnimation( name, numTracks, (long long)numTracks * animInfo.numFrames );
+
 	mMeshWriter.closeTag();
 }
 
-void Q3ModelToMesh::buildTrack( int meshIndex, const AnimationInfo &animInfo )
+void Q3ModelToMesh::buildTrack( int subMeshIndex, const AnimationInfo &animInfo )
 {
-	const MD3Mesh &mesh = mModel.meshes[meshIndex];
-
 	TiXmlElement *trackNode = mMeshWriter.openTag( "track" );
-	trackNode->SetAttribute( "target", "submesh" );
-	trackNode->SetAttribute( "type", "morph" );
-	trackNode->SetAttribute( "index", meshIndex );
+	if ( subMeshIndex < 0 )
+	{
+		trackNode->SetAttribute( "target", "mesh" );
+		trackNode->SetAttribute( "type", "morph" );
+	}
+	else
+	{
+		trackNode->SetAttribute( "target", "submesh" );
+		trackNode->SetAttribute( "type", "morph" );
+		trackNode->SetAttribute( "index", subMeshIndex );
+	}
+	const IndexList &surfaces = subMeshIndex < 0 ? mSharedSurfaces : mSubMeshSurfaces[subMeshIndex];
 
 	float time = 0.0f;
 	float timePerFrame = 1.0f / (float)animInfo.framesPerSecond;
@@ -214,7 +627,7 @@ void Q3ModelToMesh::buildTrack( int meshIndex, const AnimationInfo &animInfo )
 	mMeshWriter.openTag( "keyframes" );
 	for ( int i = 0; i < animInfo.numFrames; i++ )
 	{
-		buildKeyframe( mesh, animInfo.startFrame + i, time );
+		buildKeyframe( surfaces, animInfo.startFrame + i, time );
 		time += timePerFrame;
 	}
 	mMeshWriter.closeTag();
@@ -222,41 +635,63 @@ void Q3ModelToMesh::buildTrack( int meshIndex, const AnimationInfo &animInfo )
 	mMeshWriter.closeTag();
 }
 
-void Q3ModelToMesh::buildKeyframe( const MD3Mesh &mesh, int frame, float time )
+void Q3ModelToMesh::buildKeyframe( const IndexList &surfaces, int frame, float time )
 {
-	cout << "Building frame " << frame << " for SubMesh '" << mesh.header.name << "'" << endl;
+	const MD3Mesh &firstMesh = mModel.meshes[surfaces[0]];
+	if ( !mModel.getVertices( firstMesh, frame ) )
+	{
+		mLog << "[Warning] Frame " << frame << " does not exist, skipping it" << endl;
+		return;
+	}
+
+	if ( mContext.logLevel >= LOG_DEBUG )
+		mLog << "Building frame " << frame << " for SubMesh '" << firstMesh.header.name << "'" << endl;
 
 	TiXmlElement *kfNode = mMeshWriter.openTag( "keyframe" );
 	kfNode->SetAttribute( "time", StringUtil::toString( time ) );
 
-	const MD3Vertex *verts = &mesh.vertices[frame * mesh.header.numVertices];
 	Vector3 position, normal;
 
-	for ( int i = 0; i < mesh.header.numVertices; i++ )
+	for ( size_t s = 0; s < surfaces.size(); s++ )
 	{
-		const MD3Vertex &vertex = verts[i];
-		convertPosition( vertex.position, position );
-		convertNormal( vertex.normal, normal );
+		const MD3Mesh &mesh = mModel.meshes[surfaces[s]];
+		const MD3Vertex *verts = mModel.getVertices( mesh, frame );
+		const IndexList &vertexOrder = mVertexOrders[surfaces[s]];
 
-		TiXmlElement *posNode = mMeshWriter.openTag( "position" );
-		posNode->SetAttribute( "x", StringUtil::toString( position.x ) );
-		posNode->SetAttribute( "y", StringUtil::toString( position.y ) );
-		posNode->SetAttribute( "z", StringUtil::toString( position.z ) );
-		mMeshWriter.closeTag();
-		
-		if ( mIncludeNormals )
+		int numVertices = vertexOrder.empty() ? mesh.header.numVertices : (int)vertexOrder.size();
+		for ( int i = 0; i < numVertices; i++ )
 		{
-			TiXmlElement *normNode = mMeshWriter.openTag( "normal" );
-			normNode->SetAttribute( "x", StringUtil::toString( normal.x ) );
-			normNode->SetAttribute( "y", StringUtil::toString( normal.y ) );
-			normNode->SetAttribute( "z", StringUtil::toString( normal.z ) );
+			const MD3Vertex &vertex = verts[vertexOrder.empty() ? i : vertexOrder[i]];
+			convertPosition( vertex.position, position );
+			convertNormal( vertex.normal, normal );
+
+			TiXmlElement *posNode = mMeshWriter.openTag( "position" );
+			posNode->SetAttribute( "x", StringUtil::toString( position.x ) );
+			posNode->SetAttribute( "y", StringUtil::toString( position.y ) );
+			posNode->SetAttribute( "z", StringUtil::toString( position.z ) );
 			mMeshWriter.closeTag();
+			
+			if ( mIncludeNormals )
+			{
+				TiXmlElement *normNode = mMeshWriter.openTag( "normal" );
+				normNode->SetAttribute( "x", StringUtil::toString( normal.x ) );
+				normNode->SetAttribute( "y", StringUtil::toString( normal.y ) );
+				normNode->SetAttribute( "z", StringUtil::toString( normal.z ) );
+				mMeshWriter.closeTag();
+			}
 		}
 	}
 
 	mMeshWriter.closeTag();
 }
 
+void Q3ModelToMesh::getPositions( const MD3Mesh &mesh, const MD3Vertex *verts, PositionList &positions )
+{
+	positions.resize( mesh.header.numVertices );
+	for ( int i = 0; i < mesh.header.numVertices; i++ )
+		convertPosition( verts[i].position, positions[i] );
+}
+
 void Q3ModelToMesh::convertPosition( const short position[3], Vector3 &dest )
 {
 	dest.x = (float)position[0] * MD3_SCALE;
@@ -269,14 +704,7 @@ void Q3ModelToMesh::convertPosition( const short position[3], Vector3 &dest )
 
 void Q3ModelToMesh::convertNormal( const short &normal, Vector3 &dest )
 {
-	double lat = (double)( ( normal >> 8 ) & 0xFF ) / 255.0;
-	double lng = (double)( normal & 0xFF ) / 255.0;
-	lat *= 6.2831853;
-	lng *= 6.2831853;
-
-	dest.x = (float)( cos(lat) * sin(lng) );
-	dest.y = (float)( sin(lat) * sin(lng) );
-	dest.z = (float)( cos(lng) );
+	dest = Quake::md3Normal( normal );
 	
 	if ( mGlobals.convertCoords )
 		Quake::convertVector( dest );	
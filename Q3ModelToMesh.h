@@ -25,14 +25,20 @@ THE SOFTWARE.
 #define __Q3MODELTOMESH_H__
 
 #include "XmlWriter.h"
+#include "ConversionContext.h"
 #include "MD3Model.h"
 #include "Animation.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+#include "EdgeListBuilder.h"
+#include "GeometryCleaner.h"
 #include "vector.h"
 
 class Q3ModelToMesh
 {
 public:
-	Q3ModelToMesh( const GlobalOptions &globals );
+	Q3ModelToMesh( const GlobalOptions &globals, ConversionContext &context );
 
 	bool build();
 
@@ -44,21 +50,51 @@ public:
 	void setIncludeNormals( bool enable ) { mIncludeNormals = enable; }
 
 private:
+	bool loadModel();
+
 	void convert();
 
-	void buildSubMesh( const MD3Mesh &mesh );
-	void buildFace( const MD3Triangle &triangle );
-	void buildVertexBuffers( const MD3Mesh &mesh );
-	void buildVertex( const MD3Vertex &vert, const MD3TexCoord &texCoord );
+	/**
+	Welds the vertices of a surface that match in position and normal in every loaded frame
+	and in their texture coordinates, then drops the triangles without area. The welded
+	vertices stay in place until optimizeFaces leaves out the ones no triangle uses.
+	*/
+	void cleanupGeometry( MD3Mesh &mesh );
+
+	string getMaterialName( const MD3Mesh &mesh ) const;
+
+	/**
+	Decides which surfaces go into each submesh: surfaces sharing a material end up in one
+	submesh when merging is enabled, otherwise every surface gets its own.
+	*/
+	void groupSurfaces();
+
+	int getNumVertices( const IndexList &surfaces ) const;
+
+	/**
+	Optimises the faces of every surface in a submesh and joins them, leaving the submesh's
+	faces and levels of detail ready to be written after any shared geometry.
+	*/
+	void optimizeSubMesh( int subMeshIndex );
+	void buildSubMesh( int subMeshIndex );
+	void optimizeFaces( const MD3Mesh &mesh, IndexList &indices, IndexList &vertexOrder, vector<IndexList> &lodFaces );
+	void buildFace( const int indices[3] );
+	void generateTangents();
+	void generateTangents( const MD3Mesh &mesh, TangentList &tangents );
+	void buildVertexBuffers( const IndexList &surfaces );
+	void buildVertex( const MD3Vertex &vert, const MD3TexCoord &texCoord, const Tangent *tangent );
 
 	void buildAnimation( const string &name, const AnimationInfo &animInfo );
-	void buildTrack( int meshIndex, const AnimationInfo &animInfo );
-	void buildKeyframe( const MD3Mesh &mesh, int frame, float time );
+	void buildTrack( int subMeshIndex, const AnimationInfo &animInfo );	// A negative index targets the shared geometry
+	void buildKeyframe( const IndexList &surfaces, int frame, float time );
 	
+	void getPositions( const MD3Mesh &mesh, const MD3Vertex *verts, PositionList &positions );
 	void convertPosition( const short position[3], Vector3 &dest );
 	void convertNormal( const short &normal, Vector3 &dest );
 
 	const GlobalOptions &mGlobals;
+	ConversionContext &mContext;
+	ostream &mLog;
 
 	XmlWriter mMeshWriter;
 
@@ -70,6 +106,15 @@ private:
 	bool mIncludeNormals;
 
 	MD3Model mModel;
+
+	// Old index of every written vertex, per surface; empty if the vertices weren't reordered
+	vector<IndexList> mVertexOrders;
+	vector<IndexList> mSubMeshSurfaces;	// Surfaces written into each submesh, in order
+	vector<IndexList> mSubMeshFaces;	// Per submesh, as written
+	IndexList mSharedSurfaces;	// Surfaces in the shared vertex buffer, in order; empty unless shared
+	vector< vector<IndexList> > mLodFaces;	// Per submesh and level of detail
+	EdgeListBuilder mEdgeLists;
+	vector<TangentList> mTangents;	// Per surface, in the original vertex order; empty unless enabled
 };
 
 #endif
@@ -37,6 +37,32 @@ void Quake::convertVector( Vector3 &v )
 	v.z = -tmp;
 }
 
+// Decodes every possible latitude/longitude encoded MD3 normal once, on first use
+static const Vector3 *buildMD3NormalTable()
+{
+	static Vector3 table[65536];
+
+	for ( int i = 0; i < 65536; i++ )
+	{
+		double lat = (double)( ( i >> 8 ) & 0xFF ) / 255.0;
+		double lng = (double)( i & 0xFF ) / 255.0;
+		lat *= 6.2831853;
+		lng *= 6.2831853;
+
+		table[i].x = (float)( cos(lat) * sin(lng) );
+		table[i].y = (float)( sin(lat) * sin(lng) );
+		table[i].z = (float)( cos(lng) );
+	}
+
+	return table;
+}
+
+const Vector3 &Quake::md3Normal( short normal )
+{
+	static const Vector3 *table = buildMD3NormalTable();
+	return table[(unsigned short)normal];
+}
+
 void Quake::convertQuaternion( Quaternion &q )
 {
 	static const Quaternion trsf( -0.707107f, 0.707107f, 0, 0 );
@@ -35,6 +35,7 @@ class Quake
 public:
 	static void convertVector( Vector3 &v );
 	static void convertQuaternion( Quaternion &q );
+	static const Vector3 &md3Normal( short normal );
 	
 	static const float md2VertexNormals[MD2_NUMVERTEXNORMALS][3];
 };
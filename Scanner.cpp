@@ -0,0 +1,152 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "Scanner.h"
+#include "ModelInfo.h"
+#include "Storage.h"
+#include "ThreadPool.h"
+
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static bool isModelFile( const string &filename )
+{
+	string extension = StringUtil::getExtension( filename );
+	return extension == "md2" || extension == "md3" || extension == "md5mesh" || extension == "md5anim";
+}
+
+Scanner::Scanner( const string &directory, int numThreads ):
+	mDirectory( directory ), mNumThreads( numThreads )
+{
+}
+
+bool Scanner::findFiles( const string &directory )
+{
+	DIR *dir = opendir( directory.c_str() );
+	if ( !dir )
+	{
+		cerr << "[Warning] Could not open directory '" << directory << "'" << endl;
+		return false;
+	}
+
+	struct dirent *entry;
+	while ( (entry = readdir( dir )) )
+	{
+		if ( !strcmp( entry->d_name, "." ) || !strcmp( entry->d_name, ".." ) )
+			continue;
+
+		// Symbolic links aren't followed, so links back up the tree can't cause a loop
+		string path = directory + "/" + entry->d_name;
+		struct stat info;
+		if ( lstat( path.c_str(), &info ) != 0 )
+			continue;
+
+		if ( S_ISDIR( info.st_mode ) )
+			findFiles( path );
+		else if ( S_ISREG( info.st_mode ) && isModelFile( path ) )
+			mFiles.push_back( path );
+	}
+
+	closedir( dir );
+	return true;
+}
+
+string Scanner::inspect( const string &path ) const
+{
+	ostringstream record;
+	record << "{\"path\": " << StringUtil::toJSON( path );
+
+	FileInputSource input;
+	string data;
+	if ( !input.read( path, data ) )
+	{
+		record << ", \"error\": \"Could not read file\"}";
+		return record.str();
+	}
+
+	char hash[32];
+	snprintf( hash, sizeof( hash ), "%016llx", StringUtil::hash( data.data(), data.size() ) );
+	record << ", \"size\": " << data.size() << ", \"hash\": \"" << hash << "\", ";
+
+	ModelInfo info;
+	if ( info.read( data.data(), data.size(), path ) )
+	{
+		info.writeJSON( record );
+	}
+	else
+	{
+		record << "\"format\": \"" << ModelInfo::getFormatName( info.format ) << "\", \"error\": \"" 
+			<< (info.format == ModelInfo::FORMAT_UNKNOWN ? "Unknown file format" : "Invalid file") << "\"";
+	}
+
+	record << "}";
+	return record.str();
+}
+
+bool Scanner::run( ostream &os )
+{
+	if ( !findFiles( mDirectory ) )
+		return false;
+
+	std::sort( mFiles.begin(), mFiles.end() );
+
+	// Every task fills in its own record, so they need no locking
+	vector<string> records( mFiles.size() );
+	{
+		ThreadPool pool( mNumThreads );
+		for ( size_t i = 0; i < mFiles.size(); i++ )
+		{
+			pool.submit( [this, i, &records]()
+			{
+				records[i] = inspect( mFiles[i] );
+			} );
+		}
+		pool.wait();
+	}
+
+	for ( size_t i = 0; i < records.size(); i++ )
+		os << records[i] << "\n";
+	os.flush();
+
+	cerr << "Scanned " << records.size() << " model files" << endl;
+	return true;
+}
+
+#else
+
+Scanner::Scanner( const string &directory, int numThreads ):
+	mDirectory( directory ), mNumThreads( numThreads )
+{
+}
+
+bool Scanner::run( ostream & )
+{
+	cout << "[Error] Scanning directories is not supported on this platform" << endl;
+	return false;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __SCANNER_H__
+#define __SCANNER_H__
+
+#include "Common.h"
+
+/**
+Builds an inventory of every md2, md3, md5mesh and md5anim file below a directory.
+Files are inspected in parallel with ModelInfo, which only reads headers and name
+tables, and each file gets one line of JSON with its path, size, content hash and
+everything ModelInfo found. Lines are written in path order, so inventories of the
+same directory can be compared.
+*/
+class Scanner
+{
+public:
+	Scanner( const string &directory, int numThreads = 0 );
+
+	bool run( ostream &os );
+
+private:
+	bool findFiles( const string &directory );
+	string inspect( const string &path ) const;
+
+	string mDirectory;
+	int mNumThreads;
+	vector<string> mFiles;
+};
+
+#endif	// __SCANNER_H__
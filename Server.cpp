@@ -0,0 +1,441 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "Server.h"
+#include "Converter.h"
+#include "ThreadPool.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static volatile sig_atomic_t sStopRequested = 0;
+
+// Writing to this pipe wakes up the thread waiting in poll(), after a stop signal or a finished request
+static int sWakeFd = -1;
+
+static void wakeUp()
+{
+	char c = 0;
+	while ( write( sWakeFd, &c, 1 ) < 0 && errno == EINTR )
+		;
+}
+
+static void onStopSignal( int )
+{
+	sStopRequested = 1;
+	wakeUp();
+}
+
+static bool sendAll( int fd, const string &data )
+{
+	size_t sent = 0;
+	while ( sent < data.size() )
+	{
+		ssize_t result = send( fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL );
+		if ( result < 0 && errno == EINTR )
+			continue;
+		if ( result <= 0 )
+			return false;
+		sent += result;
+	}
+	return true;
+}
+
+// Appends whatever arrived on the socket to 'pending', fails once the client has disconnected
+static bool receiveMore( int fd, string &pending )
+{
+	char buffer[65536];
+	ssize_t result;
+	do
+	{
+		result = recv( fd, buffer, sizeof( buffer ), 0 );
+	} while ( result < 0 && errno == EINTR );
+
+	if ( result <= 0 )
+		return false;
+
+	pending.append( buffer, result );
+	return true;
+}
+
+/**
+Sends everything written to the conversion log back to the client as LOG lines. The
+lines are sent together whenever the log is flushed, which the Converter does after
+every mesh.
+*/
+class SocketLogBuffer : public std::streambuf
+{
+public:
+	SocketLogBuffer( int fd ): mFd( fd ) {}
+	~SocketLogBuffer() { flushLine(); sync(); }
+
+protected:
+	int overflow( int c )
+	{
+		if ( c == EOF )
+			return 0;
+
+		// Progress indicators use carriage returns, treat those as line ends as well
+		if ( c == '\n' || c == '\r' )
+			flushLine();
+		else
+			mLine += (char)c;
+		return c;
+	}
+
+	int sync()
+	{
+		if ( !mPending.empty() )
+		{
+			sendAll( mFd, mPending );
+			mPending.clear();
+		}
+		return 0;
+	}
+
+private:
+	void flushLine()
+	{
+		if ( mLine.empty() )
+			return;
+
+		mPending += "LOG " + mLine + "\n";
+		mLine.clear();
+	}
+
+	int mFd;
+	string mLine;
+	string mPending;
+};
+
+/**
+Writes files to disk and tells the client about every file that was written.
+*/
+class ReportingOutputSink : public FileOutputSink
+{
+public:
+	ReportingOutputSink( int fd, const string &baseDir ):
+		FileOutputSink( baseDir ), mFd( fd ), mBaseDir( baseDir ) {}
+
+	bool write( const string &name, const string &data )
+	{
+		if ( !FileOutputSink::write( name, data ) )
+			return false;
+
+		sendAll( mFd, "OUTPUT " + FileInputSource::resolvePath( mBaseDir, name ) + "\n" );
+		return true;
+	}
+
+private:
+	int mFd;
+	string mBaseDir;
+};
+
+Server::Server( const string &socketPath, int numThreads ):
+	mSocketPath( socketPath ), mNumThreads( numThreads ), mTraceLog( NULL ), mWorkers( NULL ), mStopping( false )
+{
+}
+
+bool Server::run()
+{
+	struct sockaddr_un addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sun_family = AF_UNIX;
+	if ( mSocketPath.size() >= sizeof( addr.sun_path ) )
+	{
+		cout << "[Error] Socket path '" << mSocketPath << "' is too long" << endl;
+		return false;
+	}
+	strcpy( addr.sun_path, mSocketPath.c_str() );
+
+	// Clean up after a previous server that didn't shut down properly
+	struct stat info;
+	if ( lstat( mSocketPath.c_str(), &info ) == 0 && S_ISSOCK( info.st_mode ) )
+		unlink( mSocketPath.c_str() );
+
+	int listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( listenFd < 0 )
+	{
+		cout << "[Error] Could not create socket: " << strerror( errno ) << endl;
+		return false;
+	}
+
+	if ( bind( listenFd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 || listen( listenFd, SOMAXCONN ) < 0 )
+	{
+		cout << "[Error] Could not listen on '" << mSocketPath << "': " << strerror( errno ) << endl;
+		close( listenFd );
+		return false;
+	}
+
+	int wakeFds[2];
+	if ( pipe( wakeFds ) < 0 )
+	{
+		cout << "[Error] Could not create pipe: " << strerror( errno ) << endl;
+		close( listenFd );
+		return false;
+	}
+	fcntl( wakeFds[0], F_SETFL, O_NONBLOCK );
+	fcntl( wakeFds[1], F_SETFL, O_NONBLOCK );
+	sWakeFd = wakeFds[1];
+
+	// Only the main thread should see the stop signals, so they reliably interrupt poll()
+	sigset_t stopSignals, oldMask;
+	sigemptyset( &stopSignals );
+	sigaddset( &stopSignals, SIGINT );
+	sigaddset( &stopSignals, SIGTERM );
+	pthread_sigmask( SIG_BLOCK, &stopSignals, &oldMask );
+
+	ThreadPool pool( mNumThreads );
+	mWorkers = &pool;
+
+	pthread_sigmask( SIG_SETMASK, &oldMask, NULL );
+
+	struct sigaction action;
+	memset( &action, 0, sizeof( action ) );
+	action.sa_handler = onStopSignal;
+	sigemptyset( &action.sa_mask );
+	sigaction( SIGINT, &action, NULL );
+	sigaction( SIGTERM, &action, NULL );
+	signal( SIGPIPE, SIG_IGN );
+
+	cout << "Listening on '" << mSocketPath << "' with " << pool.getNumThreads() << " worker threads" << endl;
+
+	// Requests are read here, and only complete requests go to the workers, so clients
+	// that keep a connection open without sending anything don't tie up a worker
+	ConnectionMap connections;
+	vector<struct pollfd> pollFds;
+	while ( !sStopRequested )
+	{
+		pollFds.clear();
+		struct pollfd listenPoll = { listenFd, POLLIN, 0 };
+		struct pollfd wakePoll = { wakeFds[0], POLLIN, 0 };
+		pollFds.push_back( listenPoll );
+		pollFds.push_back( wakePoll );
+		for ( ConnectionMap::const_iterator iter = connections.begin(); iter != connections.end(); ++iter )
+		{
+			if ( iter->second.busy )
+				continue;
+
+			struct pollfd clientPoll = { iter->first, POLLIN, 0 };
+			pollFds.push_back( clientPoll );
+		}
+
+		if ( poll( &pollFds[0], pollFds.size(), -1 ) < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+
+			cout << "[Error] poll() failed: " << strerror( errno ) << endl;
+			break;
+		}
+
+		if ( pollFds[1].revents )
+		{
+			char buffer[256];
+			while ( read( wakeFds[0], buffer, sizeof( buffer ) ) > 0 )
+				;
+		}
+
+		// Connections whose request is done can go on with the next one
+		vector< pair<int, bool> > finished;
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			finished.swap( mFinished );
+		}
+		for ( size_t i = 0; i < finished.size(); i++ )
+		{
+			int fd = finished[i].first;
+			Connection &connection = connections[fd];
+			connection.busy = false;
+			if ( !finished[i].second || !startRequests( fd, connection, pool ) )
+			{
+				close( fd );
+				connections.erase( fd );
+			}
+		}
+
+		if ( pollFds[0].revents & POLLIN )
+		{
+			int fd = accept( listenFd, NULL, NULL );
+			if ( fd >= 0 )
+			{
+				connections[fd].busy = false;
+			}
+			else if ( errno != EINTR && errno != ECONNABORTED && errno != EAGAIN )
+			{
+				cout << "[Error] accept() failed: " << strerror( errno ) << endl;
+				break;
+			}
+		}
+
+		for ( size_t i = 2; i < pollFds.size(); i++ )
+		{
+			if ( !pollFds[i].revents )
+				continue;
+
+			int fd = pollFds[i].fd;
+			Connection &connection = connections[fd];
+			if ( !receiveMore( fd, connection.pending ) || !startRequests( fd, connection, pool ) )
+			{
+				close( fd );
+				connections.erase( fd );
+			}
+		}
+	}
+
+	cout << "Shutting down" << endl;
+	close( listenFd );
+	unlink( mSocketPath.c_str() );
+
+	// Disconnect every client, so conversions that are still running stop talking to theirs
+	mStopping = true;
+	for ( ConnectionMap::const_iterator iter = connections.begin(); iter != connections.end(); ++iter )
+		shutdown( iter->first, SHUT_RDWR );
+
+	pool.wait();
+	mWorkers = NULL;
+	mFinished.clear();
+	mStopping = false;
+
+	for ( ConnectionMap::const_iterator iter = connections.begin(); iter != connections.end(); ++iter )
+		close( iter->first );
+
+	sWakeFd = -1;
+	close( wakeFds[0] );
+	close( wakeFds[1] );
+	return true;
+}
+
+bool Server::startRequests( int fd, Connection &connection, ThreadPool &pool )
+{
+	string &pending = connection.pending;
+	while ( !connection.busy )
+	{
+		size_t pos = pending.find( '\n' );
+		if ( pos == string::npos )
+			return true;
+
+		string line = pending.substr( 0, pos );
+		if ( !line.empty() && line[line.size() - 1] == '\r' )
+			line.erase( line.size() - 1 );
+
+		if ( line.empty() )
+		{
+			pending.erase( 0, pos + 1 );
+			continue;
+		}
+
+		// CONVERT <length> <directory>
+		if ( line.compare( 0, 8, "CONVERT " ) != 0 )
+		{
+			pending.erase( 0, pos + 1 );
+			if ( !sendAll( fd, "ERROR Unknown request\n" ) )
+				return false;
+			continue;
+		}
+
+		char *directory = NULL;
+		unsigned long length = strtoul( line.c_str() + 8, &directory, 10 );
+		while ( *directory == ' ' )
+			directory++;
+
+		// Wait for the rest of the configuration
+		if ( pending.size() - (pos + 1) < length )
+			return true;
+
+		string config = pending.substr( pos + 1, length );
+		pending.erase( 0, pos + 1 + length );
+
+		connection.busy = true;
+		string dir = directory;
+		pool.submit( [this, fd, dir, config]()
+		{
+			// Requests still waiting for a worker at shutdown are dropped
+			bool connected = false;
+			if ( !mStopping )
+			{
+				bool success = handleConvert( fd, dir, config );
+				connected = sendAll( fd, success ? "DONE OK\n" : "DONE FAILED\n" );
+			}
+
+			{
+				std::lock_guard<std::mutex> lock( mMutex );
+				mFinished.push_back( make_pair( fd, connected ) );
+			}
+			wakeUp();
+		} );
+	}
+	return true;
+}
+
+bool Server::handleConvert( int fd, const string &directory, const string &config )
+{
+	FileInputSource input( directory, &mFileCache );
+	ReportingOutputSink output( fd, directory );
+
+	SocketLogBuffer logBuffer( fd );
+	ostream log( &logBuffer );
+
+	// Tangents are computed on the same workers as the requests, rather than on a pool of
+	// their own for every conversion
+	Converter converter( input, output, &log );
+	converter.setParseCache( &mParseCache );
+	converter.setWorkers( mWorkers );
+
+	Profiler profiler;
+	if ( mTraceLog )
+	{
+		profiler.setTraceLog( mTraceLog );
+		converter.setProfiler( &profiler );
+	}
+
+	return converter.convert( config );
+}
+
+#else
+
+Server::Server( const string &socketPath, int numThreads ):
+	mSocketPath( socketPath ), mNumThreads( numThreads ), mTraceLog( NULL ), mWorkers( NULL ), mStopping( false )
+{
+}
+
+bool Server::run()
+{
+	cout << "[Error] Server mode is not supported on this platform" << endl;
+	return false;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include "Storage.h"
+#include "ParsedInputCache.h"
+
+#include <atomic>
+
+class TraceLog;
+class ThreadPool;
+
+/**
+Long-running conversion service listening on a Unix domain socket. Keeping a single
+process around saves the start-up cost per conversion, and lets input files and
+parsed animations that many conversions share stay in memory.
+
+The protocol is line based. A client sends
+
+	CONVERT <length> <directory>
+
+followed by exactly <length> bytes of configuration XML. File names in the
+configuration are resolved relative to <directory>, just like the command line tool
+resolves them relative to the configuration file. While the conversion runs, the
+server streams back any number of
+
+	LOG <message>
+	OUTPUT <path>
+
+lines, and finishes with either "DONE OK" or "DONE FAILED". A connection may send
+several requests in a row. Requests on different connections run in parallel.
+
+A single thread reads the requests of every connection and hands each complete request
+to a worker, so idle connections cost no worker. On shutdown the clients are disconnected
+and the conversions that are still running are allowed to finish; requests that are
+still waiting for a worker are dropped.
+*/
+class Server
+{
+public:
+	Server( const string &socketPath, int numThreads = 0 );
+
+	// Every conversion records its jobs and phases in the trace log, if one is set
+	void setTraceLog( TraceLog *traceLog ) { mTraceLog = traceLog; }
+
+	// Serves requests until the process receives SIGINT or SIGTERM
+	bool run();
+
+private:
+	struct Connection
+	{
+		string pending;	// Received, but not handled yet
+		bool busy;		// One of its requests is being handled by a worker
+	};
+	typedef map<int, Connection> ConnectionMap;
+
+	// Hands the complete requests in the connection's pending data to the workers, one at a time
+	bool startRequests( int fd, Connection &connection, ThreadPool &pool );
+	bool handleConvert( int fd, const string &directory, const string &config );
+
+	string mSocketPath;
+	int mNumThreads;
+	TraceLog *mTraceLog;
+	ThreadPool *mWorkers;
+	FileCache mFileCache;
+	ParsedInputCache mParseCache;
+
+	// Connections whose request a worker has finished, and whether they can still be used
+	vector< pair<int, bool> > mFinished;
+	std::mutex mMutex;
+	std::atomic<bool> mStopping;
+};
+
+#endif	// __SERVER_H__
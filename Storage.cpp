@@ -0,0 +1,446 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "Storage.h"
+
+#include <sys/stat.h>
+
+bool InputSource::readRange( const string &name, size_t offset, size_t length, string &data )
+{
+	if ( !read( name, data ) )
+		return false;
+
+	if ( offset >= data.size() )
+		data.clear();
+	else
+		data = data.substr( offset, length );
+	return true;
+}
+
+bool checkBlock( const BlockReader &readBlock, long long offset, size_t count, size_t elementSize, size_t &length )
+{
+	if ( offset < 0 || (elementSize > 0 && count > (~(size_t)0 - (size_t)offset) / elementSize) )
+		return false;
+
+	length = count * elementSize;
+
+	char last;
+	return length == 0 || readBlock( (size_t)offset + length - 1, 1, &last );
+}
+
+BlockReader InputSource::getBlockReader( const string &name )
+{
+	std::shared_ptr<string> block = std::make_shared<string>();
+	return [this, name, block]( size_t offset, size_t length, void *dest )
+	{
+		if ( !readRange( name, offset, length, *block ) || block->size() != length )
+			return false;
+
+		memcpy( dest, block->data(), length );
+		return true;
+	};
+}
+
+bool FileCache::find( const string &path, time_t modified, size_t size, string &data )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	EntryMap::const_iterator iter = mEntries.find( path );
+	if ( iter == mEntries.end() || iter->second.modified != modified || iter->second.data.size() != size )
+		return false;
+
+	data = iter->second.data;
+	return true;
+}
+
+bool FileCache::findRange( const string &path, time_t modified, size_t size, size_t offset, size_t length, string &data )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	EntryMap::const_iterator iter = mEntries.find( path );
+	if ( iter == mEntries.end() || iter->second.modified != modified || iter->second.data.size() != size )
+		return false;
+
+	if ( offset >= size )
+		data.clear();
+	else
+		data.assign( iter->second.data, offset, length );
+	return true;
+}
+
+void FileCache::store( const string &path, time_t modified, const string &data )
+{
+	if ( data.size() > mMaxSize )
+		return;
+
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	EntryMap::iterator iter = mEntries.find( path );
+	if ( iter != mEntries.end() )
+	{
+		mCurSize -= iter->second.data.size();
+		iter->second.modified = modified;
+		iter->second.data = data;
+		mCurSize += data.size();
+
+		// It's the newest entry now
+		mOrder.erase( std::find( mOrder.begin(), mOrder.end(), path ) );
+	}
+	else
+	{
+		Entry &entry = mEntries[path];
+		entry.modified = modified;
+		entry.data = data;
+		mCurSize += data.size();
+	}
+	mOrder.push_back( path );
+
+	// Throw out the oldest entries until we're within budget again, which the new entry
+	// on its own always is
+	while ( mCurSize > mMaxSize && mOrder.front() != path )
+	{
+		EntryMap::iterator oldest = mEntries.find( mOrder.front() );
+		mOrder.pop_front();
+
+		mCurSize -= oldest->second.data.size();
+		mEntries.erase( oldest );
+	}
+}
+
+string FileInputSource::resolvePath( const string &baseDir, const string &name )
+{
+	if ( baseDir.empty() || name.empty() )
+		return name;
+
+	// Leave absolute paths alone, including ones with a drive letter
+	if ( name[0] == '/' || name[0] == '\\' || name.find( ':' ) != string::npos )
+		return name;
+
+	char last = baseDir[baseDir.size() - 1];
+	if ( last == '/' || last == '\\' )
+		return baseDir + name;
+
+	return baseDir + "/" + name;
+}
+
+bool FileInputSource::read( const string &name, string &data )
+{
+	string path = resolvePath( mBaseDir, name );
+
+	struct stat info;
+	bool haveInfo = mCache && stat( path.c_str(), &info ) == 0;
+	if ( haveInfo && mCache->find( path, info.st_mtime, (size_t)info.st_size, data ) )
+		return true;
+
+	FILE *f = fopen( path.c_str(), "rb" );
+	if ( !f )
+		return false;
+
+	data.clear();
+
+	char buffer[65536];
+	size_t numRead;
+	while ( (numRead = fread( buffer, 1, sizeof( buffer ), f )) > 0 )
+		data.append( buffer, numRead );
+
+	bool success = !ferror( f );
+	fclose( f );
+
+	if ( success && haveInfo )
+		mCache->store( path, info.st_mtime, data );
+
+	return success;
+}
+
+bool FileInputSource::readRange( const string &name, size_t offset, size_t length, string &data )
+{
+	string path = resolvePath( mBaseDir, name );
+
+	struct stat info;
+	if ( mCache && stat( path.c_str(), &info ) == 0 && 
+		mCache->findRange( path, info.st_mtime, (size_t)info.st_size, offset, length, data ) )
+	{
+		return true;
+	}
+
+	FILE *f = fopen( path.c_str(), "rb" );
+	if ( !f )
+		return false;
+
+	data.clear();
+
+	// Nothing is allocated for the part of the range past the end of the file
+	bool success = (fseek( f, 0, SEEK_END ) == 0);
+	long size = success ? ftell( f ) : -1;
+	success = success && size >= 0 && fseek( f, (long)offset, SEEK_SET ) == 0;
+	if ( success && offset < (size_t)size )
+	{
+		length = MIN( length, (size_t)size - offset );
+		data.resize( length );
+		data.resize( fread( &data[0], 1, length, f ) );
+		success = !ferror( f );
+	}
+	fclose( f );
+
+	return success;
+}
+
+BlockReader FileInputSource::getBlockReader( const string &name )
+{
+	string path = resolvePath( mBaseDir, name );
+
+	struct stat info;
+	string empty;
+	if ( mCache && stat( path.c_str(), &info ) == 0 && 
+		mCache->findRange( path, info.st_mtime, (size_t)info.st_size, 0, 0, empty ) )
+	{
+		return InputSource::getBlockReader( name );
+	}
+
+	FILE *f = fopen( path.c_str(), "rb" );
+	if ( !f )
+		return []( size_t, size_t, void * ) { return false; };
+
+	std::shared_ptr<FILE> file( f, fclose );
+	return [file]( size_t offset, size_t length, void *dest )
+	{
+		return fseek( file.get(), (long)offset, SEEK_SET ) == 0 && fread( dest, 1, length, file.get() ) == length;
+	};
+}
+
+bool FileOutputSink::write( const string &name, const string &data )
+{
+	string path = FileInputSource::resolvePath( mBaseDir, name );
+
+	FILE *f = fopen( path.c_str(), "wb" );
+	if ( !f )
+		return false;
+
+	bool success = (fwrite( data.data(), 1, data.size(), f ) == data.size());
+	if ( fclose( f ) != 0 )
+		success = false;
+
+	return success;
+}
+
+PrefetchInputSource::PrefetchInputSource( InputSource &source )
+: mSource( source ), mStopping( false )
+{
+	mThread = std::thread( &PrefetchInputSource::readerLoop, this );
+}
+
+PrefetchInputSource::~PrefetchInputSource()
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mStopping = true;
+	}
+	mChanged.notify_all();
+	mThread.join();
+}
+
+void PrefetchInputSource::prefetch( const string &name )
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		if ( mFiles.count( name ) )
+			return;
+
+		File &file = mFiles[name];
+		file.done = false;
+		file.success = false;
+		mQueue.push_back( name );
+	}
+	mChanged.notify_all();
+}
+
+bool PrefetchInputSource::read( const string &name, string &data )
+{
+	std::unique_lock<std::mutex> lock( mMutex );
+
+	FileMap::iterator iter = mFiles.find( name );
+	if ( iter == mFiles.end() )
+	{
+		lock.unlock();
+		return mSource.read( name, data );
+	}
+
+	// Still queued, rather than waiting for the files ahead of it just read it here
+	std::deque<string>::iterator queued = std::find( mQueue.begin(), mQueue.end(), name );
+	if ( queued != mQueue.end() )
+	{
+		mQueue.erase( queued );
+		mFiles.erase( iter );
+		lock.unlock();
+		return mSource.read( name, data );
+	}
+
+	while ( !iter->second.done )
+		mChanged.wait( lock );
+
+	// Each prefetched file is handed out once, a second read goes to the source again
+	bool success = iter->second.success;
+	data.swap( iter->second.data );
+	mFiles.erase( iter );
+	return success;
+}
+
+void PrefetchInputSource::readerLoop()
+{
+	std::unique_lock<std::mutex> lock( mMutex );
+	for (;;)
+	{
+		while ( !mStopping && mQueue.empty() )
+			mChanged.wait( lock );
+		if ( mStopping )
+			return;
+
+		string name = mQueue.front();
+		mQueue.pop_front();
+
+		lock.unlock();
+		string data;
+		bool success = mSource.read( name, data );
+		lock.lock();
+
+		FileMap::iterator iter = mFiles.find( name );
+		if ( iter != mFiles.end() )
+		{
+			iter->second.done = true;
+			iter->second.success = success;
+			iter->second.data.swap( data );
+		}
+		mChanged.notify_all();
+	}
+}
+
+BackgroundOutputSink::BackgroundOutputSink( OutputSink &sink, size_t maxPending )
+: mSink( sink ), mMaxPending( maxPending > 0 ? maxPending : 1 ), mWriting( false ), mFailed( false ), mStopping( false )
+{
+	mThread = std::thread( &BackgroundOutputSink::writerLoop, this );
+}
+
+BackgroundOutputSink::~BackgroundOutputSink()
+{
+	flush();
+
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mStopping = true;
+	}
+	mChanged.notify_all();
+	mThread.join();
+}
+
+bool BackgroundOutputSink::write( const string &name, const string &data )
+{
+	std::unique_lock<std::mutex> lock( mMutex );
+	while ( mQueue.size() >= mMaxPending )
+		mChanged.wait( lock );
+
+	if ( mFailed )
+		return false;
+
+	mQueue.push_back( make_pair( name, data ) );
+	mChanged.notify_all();
+	return true;
+}
+
+bool BackgroundOutputSink::flush()
+{
+	std::unique_lock<std::mutex> lock( mMutex );
+	while ( !mQueue.empty() || mWriting )
+		mChanged.wait( lock );
+
+	bool success = !mFailed;
+	mFailed = false;
+	return success;
+}
+
+void BackgroundOutputSink::writerLoop()
+{
+	std::unique_lock<std::mutex> lock( mMutex );
+	for (;;)
+	{
+		while ( !mStopping && mQueue.empty() )
+			mChanged.wait( lock );
+		if ( mQueue.empty() )
+			return;
+
+		pair<string, string> file;
+		file.swap( mQueue.front() );
+		mQueue.pop_front();
+		mWriting = true;
+
+		lock.unlock();
+		bool success = mSink.write( file.first, file.second );
+		lock.lock();
+
+		mWriting = false;
+		if ( !success )
+			mFailed = true;
+		mChanged.notify_all();
+	}
+}
+
+bool MemoryInputSource::read( const string &name, string &data )
+{
+	StringMap::const_iterator iter = mBuffers.find( name );
+	if ( iter == mBuffers.end() )
+		return false;
+
+	data = iter->second;
+	return true;
+}
+
+bool MemoryInputSource::readRange( const string &name, size_t offset, size_t length, string &data )
+{
+	StringMap::const_iterator iter = mBuffers.find( name );
+	if ( iter == mBuffers.end() )
+		return false;
+
+	if ( offset >= iter->second.size() )
+		data.clear();
+	else
+		data.assign( iter->second, offset, length );
+	return true;
+}
+
+BlockReader MemoryInputSource::getBufferReader( const char *data, size_t size )
+{
+	return [data, size]( size_t offset, size_t length, void *dest )
+	{
+		if ( offset > size || length > size - offset )
+			return false;
+
+		memcpy( dest, data + offset, length );
+		return true;
+	};
+}
+
+bool MemoryOutputSink::write( const string &name, const string &data )
+{
+	mOutputs[name] = data;
+	return true;
+}
@@ -0,0 +1,271 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __STORAGE_H__
+#define __STORAGE_H__
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <ctime>
+#include <functional>
+#include <memory>
+
+/**
+Copies length bytes of a file from offset into dest, and fails if the file is too short.
+The model loaders read through one of these, so they only read the parts they use.
+*/
+typedef std::function<bool( size_t offset, size_t length, void *dest )> BlockReader;
+
+// Makes sure count elements at offset fit in the file before anything is allocated for them,
+// so a corrupt header can't ask for more memory than the file holds. Their size goes into length.
+bool checkBlock( const BlockReader &readBlock, long long offset, size_t count, size_t elementSize, size_t &length );
+
+/**
+Supplies the contents of named input files (models, animations, animation.cfg files)
+to the converters. The name is whatever the configuration refers to; it's up to the
+implementation to decide what it maps onto.
+*/
+class InputSource
+{
+public:
+	virtual ~InputSource() {}
+
+	virtual bool read( const string &name, string &data ) = 0;
+
+	// Reads up to length bytes from offset, fewer if the file ends first. By default the whole
+	// file is read and the range cut out of it; sources that can seek only read the range.
+	virtual bool readRange( const string &name, size_t offset, size_t length, string &data );
+
+	// Reads blocks of the file through readRange(), sources that can keep the file open override this
+	virtual BlockReader getBlockReader( const string &name );
+
+	// Tells the source that the file will be read soon, so it can start reading it in the background
+	virtual void prefetch( const string & ) {}
+};
+
+/**
+Receives the contents of every file produced by the converters.
+*/
+class OutputSink
+{
+public:
+	virtual ~OutputSink() {}
+
+	virtual bool write( const string &name, const string &data ) = 0;
+
+	// Waits until every file has been written, returns false if any of them couldn't be
+	virtual bool flush() { return true; }
+};
+
+/**
+Keeps the contents of recently read input files around, so a long-running process
+doesn't have to go back to disk for files that many conversions share. An entry is
+only reused if the file's modification time and size haven't changed since.
+Safe to share between threads.
+*/
+class FileCache
+{
+public:
+	FileCache( size_t maxSize = 256 * 1024 * 1024 ): mMaxSize( maxSize ), mCurSize( 0 ) {}
+
+	bool find( const string &path, time_t modified, size_t size, string &data );
+	bool findRange( const string &path, time_t modified, size_t size, size_t offset, size_t length, string &data );
+	void store( const string &path, time_t modified, const string &data );
+
+private:
+	struct Entry
+	{
+		time_t modified;
+		string data;
+	};
+	typedef map<string, Entry> EntryMap;
+
+	EntryMap mEntries;
+	std::deque<string> mOrder;	// Oldest entry first
+	size_t mMaxSize;
+	size_t mCurSize;
+	std::mutex mMutex;
+};
+
+/**
+Reads input files from disk. Relative file names are resolved against the base
+directory if one is given, or the current working directory otherwise.
+*/
+class FileInputSource : public InputSource
+{
+public:
+	FileInputSource( const string &baseDir = "", FileCache *cache = NULL ):
+		mBaseDir( baseDir ), mCache( cache ) {}
+
+	bool read( const string &name, string &data );
+
+	// Ranges come from the cache if the whole file is in it, but aren't stored in it
+	bool readRange( const string &name, size_t offset, size_t length, string &data );
+
+	// Keeps the file open for as long as the reader is around, unless it's in the cache
+	BlockReader getBlockReader( const string &name );
+
+	static string resolvePath( const string &baseDir, const string &name );
+
+private:
+	string mBaseDir;
+	FileCache *mCache;
+};
+
+/**
+Writes output files to disk. Relative file names are resolved against the base
+directory if one is given, or the current working directory otherwise.
+*/
+class FileOutputSink : public OutputSink
+{
+public:
+	FileOutputSink( const string &baseDir = "" ): mBaseDir( baseDir ) {}
+
+	bool write( const string &name, const string &data );
+
+private:
+	string mBaseDir;
+};
+
+/**
+Reads the files it is told about through prefetch() on a background thread, ahead of
+the conversion that needs them, so reading and converting overlap. Files that weren't
+prefetched are read directly. Ranges are always read from the underlying source, which
+is used from both threads; a file that is read in ranges shouldn't be prefetched.
+*/
+class PrefetchInputSource : public InputSource
+{
+public:
+	PrefetchInputSource( InputSource &source );
+	~PrefetchInputSource();
+
+	bool read( const string &name, string &data );
+	bool readRange( const string &name, size_t offset, size_t length, string &data ) { return mSource.readRange( name, offset, length, data ); }
+	BlockReader getBlockReader( const string &name ) { return mSource.getBlockReader( name ); }
+	void prefetch( const string &name );
+
+private:
+	struct File
+	{
+		bool done;
+		bool success;
+		string data;
+	};
+	typedef map<string, File> FileMap;
+
+	void readerLoop();
+
+	InputSource &mSource;
+	std::deque<string> mQueue;	// files waiting to be read by the background thread
+	FileMap mFiles;				// files that are queued, being read or ready
+	std::mutex mMutex;
+	std::condition_variable mChanged;
+	bool mStopping;
+	std::thread mThread;
+};
+
+/**
+Writes output files on a background thread, so the conversion can carry on with the
+next mesh while the previous one is being written. At most maxPending files wait to
+be written; write() blocks while the queue is full. Because writing happens later,
+write() only fails if an earlier file couldn't be written; call flush() to find out
+whether every file was written.
+*/
+class BackgroundOutputSink : public OutputSink
+{
+public:
+	BackgroundOutputSink( OutputSink &sink, size_t maxPending = 2 );
+	~BackgroundOutputSink();
+
+	bool write( const string &name, const string &data );
+	bool flush();
+
+private:
+	void writerLoop();
+
+	OutputSink &mSink;
+	std::deque< pair<string, string> > mQueue;
+	size_t mMaxPending;
+	bool mWriting;
+	bool mFailed;
+	std::mutex mMutex;
+	std::condition_variable mChanged;
+	bool mStopping;
+	std::thread mThread;
+};
+
+/**
+Serves input files from buffers that were handed to it beforehand.
+*/
+class MemoryInputSource : public InputSource
+{
+public:
+	void add( const string &name, const string &data ) { mBuffers[name] = data; }
+	void add( const string &name, const char *data, size_t size ) { mBuffers[name].assign( data, size ); }
+
+	bool read( const string &name, string &data );
+	bool readRange( const string &name, size_t offset, size_t length, string &data );
+
+	// Reads blocks straight out of a buffer, which has to stay around as long as the reader
+	static BlockReader getBufferReader( const char *data, size_t size );
+
+private:
+	StringMap mBuffers;
+};
+
+/**
+Keeps every output file in memory, so the caller can pick them up after conversion.
+*/
+class MemoryOutputSink : public OutputSink
+{
+public:
+	bool write( const string &name, const string &data );
+
+	const StringMap &getOutputs() const { return mOutputs; }
+	void clear() { mOutputs.clear(); }
+
+private:
+	StringMap mOutputs;
+};
+
+/**
+Hands every output file straight to a user-supplied function.
+*/
+class CallbackOutputSink : public OutputSink
+{
+public:
+	typedef bool (*Callback)( const string &name, const string &data, void *userData );
+
+	CallbackOutputSink( Callback callback, void *userData = NULL ):
+		mCallback( callback ), mUserData( userData ) {}
+
+	bool write( const string &name, const string &data ) { return mCallback( name, data, mUserData ); }
+
+private:
+	Callback mCallback;
+	void *mUserData;
+};
+
+#endif	// __STORAGE_H__
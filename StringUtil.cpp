@@ -31,8 +31,15 @@ string StringUtil::toString( const char *str, size_t len )
 
 string StringUtil::toString( float f )
 {
-	static char tmp[32];
-	sprintf( tmp, "%f", f );
+	char tmp[64];
+	snprintf( tmp, sizeof( tmp ), "%f", f );
+	return string( tmp );
+}
+
+string StringUtil::toString( int i )
+{
+	char tmp[16];
+	snprintf( tmp, sizeof( tmp ), "%d", i );
 	return string( tmp );
 }
 
@@ -47,6 +54,17 @@ string StringUtil::getExtension( const string &filename )
 	return ext;
 }
 
+unsigned long long StringUtil::hash( const char *data, size_t len )
+{
+	unsigned long long h = 14695981039346656037ULL;
+	for ( size_t i = 0; i < len; i++ )
+	{
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
 string StringUtil::stripQuotes( const string &str )
 {
 	size_t len = str.size();
@@ -56,3 +74,31 @@ string StringUtil::stripQuotes( const string &str )
 
 	return str;
 }
+
+string StringUtil::toJSON( const string &str )
+{
+	string result = "\"";
+	for ( size_t i = 0; i < str.size(); i++ )
+	{
+		unsigned char c = str[i];
+		switch ( c )
+		{
+		case '\"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if ( c < 0x20 )
+			{
+				char tmp[8];
+				snprintf( tmp, sizeof( tmp ), "\\u%04x", c );
+				result += tmp;
+			}
+			else
+				result += (char)c;
+		}
+	}
+	result += "\"";
+	return result;
+}
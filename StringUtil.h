@@ -31,9 +31,16 @@ class StringUtil
 public:
 	static string toString( const char *str, size_t len );
 	static string toString( float f );
+	static string toString( int i );
 
 	static string getExtension( const string &filename );
 	static string stripQuotes( const string &str );
+
+	// Quotes and escapes a string for use in a JSON document
+	static string toJSON( const string &str );
+
+	// 64-bit FNV-1a hash of a block of data
+	static unsigned long long hash( const char *data, size_t len );
 };
 
 #endif	// __STRINGUTIL_H__
@@ -0,0 +1,74 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "TangentGenerator.h"
+
+void TangentGenerator::generate( const IndexList &indices, const PositionList &positions, const PositionList &normals, 
+	const vector<float> &texCoords, TangentList &tangents )
+{
+	size_t numVertices = positions.size();
+	vector<Vector3> uDirections( numVertices ), vDirections( numVertices );
+
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		int i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+		Vector3 edge1 = positions[i1] - positions[i0];
+		Vector3 edge2 = positions[i2] - positions[i0];
+		float s1 = texCoords[i1 * 2] - texCoords[i0 * 2], t1 = texCoords[i1 * 2 + 1] - texCoords[i0 * 2 + 1];
+		float s2 = texCoords[i2 * 2] - texCoords[i0 * 2], t2 = texCoords[i2 * 2 + 1] - texCoords[i0 * 2 + 1];
+
+		// Triangles whose texture coordinates lie on a line give no direction
+		float area = s1 * t2 - s2 * t1;
+		if ( area == 0.0f )
+			continue;
+
+		float scale = 1.0f / area;
+		Vector3 uDirection = (edge1 * t2 - edge2 * t1) * scale;
+		Vector3 vDirection = (edge2 * s1 - edge1 * s2) * scale;
+		for ( int corner = 0; corner < 3; corner++ )
+		{
+			uDirections[indices[i + corner]] += uDirection;
+			vDirections[indices[i + corner]] += vDirection;
+		}
+	}
+
+	tangents.resize( numVertices );
+	for ( size_t i = 0; i < numVertices; i++ )
+	{
+		const Vector3 &normal = normals[i];
+		Tangent &tangent = tangents[i];
+
+		// Gram-Schmidt orthogonalise
+		tangent.direction = uDirections[i] - normal * normal.dotProduct( uDirections[i] );
+		if ( tangent.direction.normalise() <= 0.0f )
+		{
+			// Any direction along the surface will do
+			Vector3 axis = fabsf( normal.x ) < 0.9f ? Vector3( 1, 0, 0 ) : Vector3( 0, 1, 0 );
+			tangent.direction = axis - normal * normal.dotProduct( axis );
+			tangent.direction.normalise();
+		}
+
+		tangent.handedness = normal.crossProduct( tangent.direction ).dotProduct( vDirections[i] ) < 0.0f ? -1.0f : 1.0f;
+	}
+}
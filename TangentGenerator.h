@@ -0,0 +1,58 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __TANGENTGENERATOR_H__
+#define __TANGENTGENERATOR_H__
+
+#include "Common.h"
+#include "vector.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+struct Tangent
+{
+	Vector3 direction;
+	float handedness;	// -1 where the texture is mirrored, so that the binormal is cross( normal, direction ) * handedness
+};
+typedef vector<Tangent> TangentList;
+
+/**
+Computes per-vertex tangents for normal mapping, following Eric Lengyel's method: every
+triangle adds the directions in which its texture's u and v coordinates increase to its
+vertices, and each vertex's u direction is then made perpendicular to its normal. The
+sign of the v direction relative to the normal's cross product gives the handedness.
+Vertices are not split where mirrored texture halves meet, so such vertices get the
+average of both sides.
+*/
+class TangentGenerator
+{
+public:
+	/**
+	texCoords holds a u and v coordinate per vertex. Vertices without a usable triangle get
+	an arbitrary tangent perpendicular to their normal.
+	*/
+	static void generate( const IndexList &indices, const PositionList &positions, const PositionList &normals, 
+		const vector<float> &texCoords, TangentList &tangents );
+};
+
+#endif	// __TANGENTGENERATOR_H__
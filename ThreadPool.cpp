@@ -0,0 +1,140 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool( int numThreads ):
+	mNumBusy( 0 ), mStopping( false )
+{
+	if ( numThreads <= 0 )
+		numThreads = getDefaultNumThreads();
+
+	for ( int i = 0; i < numThreads; i++ )
+		mThreads.push_back( std::thread( &ThreadPool::workerLoop, this ) );
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mStopping = true;
+	}
+	mTaskAvailable.notify_all();
+
+	for ( size_t i = 0; i < mThreads.size(); i++ )
+		mThreads[i].join();
+}
+
+void ThreadPool::submit( const Task &task )
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mTasks.push_back( task );
+	}
+	mTaskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock( mMutex );
+	while ( !mTasks.empty() || mNumBusy > 0 )
+		mAllDone.wait( lock );
+}
+
+void ThreadPool::parallelFor( int count, const std::function<void( int )> &task )
+{
+	struct Batch
+	{
+		int next;
+		int numDone;
+		std::mutex mutex;
+		std::condition_variable allDone;
+	};
+
+	// Helpers that only get to run after the batch is finished find nothing left to do,
+	// so they must not depend on anything that goes away when this function returns
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	batch->next = 0;
+	batch->numDone = 0;
+
+	const std::function<void( int )> *taskPtr = &task;
+	auto runTasks = [batch, taskPtr, count]()
+	{
+		std::unique_lock<std::mutex> lock( batch->mutex );
+		while ( batch->next < count )
+		{
+			int index = batch->next++;
+
+			lock.unlock();
+			(*taskPtr)( index );
+			lock.lock();
+
+			if ( ++batch->numDone == count )
+				batch->allDone.notify_all();
+		}
+	};
+
+	int numHelpers = min( count - 1, getNumThreads() );
+	for ( int i = 0; i < numHelpers; i++ )
+		submit( runTasks );
+
+	runTasks();
+
+	std::unique_lock<std::mutex> lock( batch->mutex );
+	while ( batch->numDone < count )
+		batch->allDone.wait( lock );
+}
+
+int ThreadPool::getDefaultNumThreads()
+{
+	int numThreads = (int)std::thread::hardware_concurrency();
+	return (numThreads > 0 ? numThreads : 1);
+}
+
+void ThreadPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock( mMutex );
+	for (;;)
+	{
+		while ( mTasks.empty() && !mStopping )
+			mTaskAvailable.wait( lock );
+
+		if ( mTasks.empty() )
+			break;	// Stopping and nothing left to do
+
+		Task task = mTasks.front();
+		mTasks.pop_front();
+		mNumBusy++;
+
+		lock.unlock();
+		task();
+		lock.lock();
+
+		mNumBusy--;
+		if ( mTasks.empty() && mNumBusy == 0 )
+			mAllDone.notify_all();
+	}
+}
@@ -0,0 +1,71 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <memory>
+
+/**
+A fixed set of worker threads that execute submitted tasks in FIFO order.
+*/
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	ThreadPool( int numThreads = 0 );
+	~ThreadPool();
+
+	void submit( const Task &task );
+
+	// Blocks until every submitted task has finished
+	void wait();
+
+	// Runs task( 0 ) to task( count - 1 ) on the workers and the calling thread, and returns once
+	// all of them have finished. Unlike wait() it doesn't wait for other tasks, and the calling
+	// thread keeps working when every worker is busy, so tasks on the pool may call it as well.
+	void parallelFor( int count, const std::function<void( int )> &task );
+
+	int getNumThreads() const { return (int)mThreads.size(); }
+
+	static int getDefaultNumThreads();
+
+private:
+	void workerLoop();
+
+	vector<std::thread> mThreads;
+	std::deque<Task> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mTaskAvailable;
+	std::condition_variable mAllDone;
+	int mNumBusy;
+	bool mStopping;
+};
+
+#endif	// __THREADPOOL_H__
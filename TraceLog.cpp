@@ -0,0 +1,84 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "TraceLog.h"
+#include "Profiler.h"
+
+TraceLog::TraceLog():
+	mEpoch( Profiler::getWallTime() )
+{
+}
+
+int TraceLog::getThreadIndex()
+{
+	// Small sequential numbers are easier to read than system thread ids
+	std::thread::id id = std::this_thread::get_id();
+	map<std::thread::id, int>::iterator iter = mThreads.find( id );
+	if ( iter != mThreads.end() )
+		return iter->second;
+
+	int index = (int)mThreads.size() + 1;
+	mThreads[id] = index;
+	return index;
+}
+
+void TraceLog::addEvent( const string &name, const char *category, double startTime, double duration )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	Event event;
+	event.name = name;
+	event.category = category;
+	event.startTime = startTime;
+	event.duration = duration;
+	event.thread = getThreadIndex();
+	mEvents.push_back( event );
+}
+
+void TraceLog::write( ostream &os ) const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	char times[128];
+	os << "{\"traceEvents\": [";
+
+	for ( size_t i = 0; i < mEvents.size(); i++ )
+	{
+		const Event &event = mEvents[i];
+		snprintf( times, sizeof( times ), "\"ts\": %.3f, \"dur\": %.3f", 
+			(event.startTime - mEpoch) * 1e6, event.duration * 1e6 );
+
+		os << (i > 0 ? "," : "") << "\n  {\"name\": " << StringUtil::toJSON( event.name ) 
+			<< ", \"cat\": \"" << event.category << "\", \"ph\": \"X\", " << times 
+			<< ", \"pid\": 1, \"tid\": " << event.thread << "}";
+	}
+
+	for ( map<std::thread::id, int>::const_iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter )
+	{
+		os << (mEvents.empty() && iter == mThreads.begin() ? "" : ",") 
+			<< "\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << iter->second 
+			<< ", \"args\": {\"name\": \"Thread " << iter->second << "\"}}";
+	}
+
+	os << "\n],\n\"displayTimeUnit\": \"ms\"}\n";
+}
@@ -0,0 +1,64 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __TRACELOG_H__
+#define __TRACELOG_H__
+
+#include "Common.h"
+#include <mutex>
+#include <thread>
+
+/**
+Collects timed events from any number of threads, and writes them in the Chrome trace
+event format, which can be loaded in chrome://tracing, Perfetto or Speedscope. Events
+are normally added by a Profiler, for every job and phase it records.
+*/
+class TraceLog
+{
+public:
+	TraceLog();
+
+	// Times are in seconds, as returned by Profiler::getWallTime()
+	void addEvent( const string &name, const char *category, double startTime, double duration );
+
+	void write( ostream &os ) const;
+
+private:
+	struct Event
+	{
+		string name;
+		const char *category;
+		double startTime;
+		double duration;
+		int thread;
+	};
+
+	int getThreadIndex();
+
+	mutable std::mutex mMutex;
+	vector<Event> mEvents;
+	map<std::thread::id, int> mThreads;
+	double mEpoch;
+};
+
+#endif	// __TRACELOG_H__
@@ -0,0 +1,516 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#include "Common.h"
+#include "UringStorage.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <cerrno>
+#endif
+
+static const unsigned RING_ENTRIES = 64;
+static const size_t CHUNK_SIZE = 1024 * 1024;	// Largest read or write handed to the kernel at once
+
+/**
+A file that is being read or written through the ring. It may only be deleted once
+none of its requests are pending anymore, since the kernel owns the buffer until then.
+*/
+struct UringFile
+{
+	int fd;
+	string data;
+	int pending;	// Requests that haven't completed yet
+	bool failed;
+};
+
+/**
+One read or write of a range of a file. The ring resubmits partial transfers until
+the whole range has been transferred.
+*/
+struct UringRequest
+{
+	UringFile *file;
+	bool write;
+	char *buffer;
+	size_t length;
+	unsigned long long offset;
+#ifdef __linux__
+	struct iovec vector;
+#endif
+};
+
+/**
+Bare io_uring built on the system calls, as liburing can't be relied upon to be
+installed. Requests are queued with push(), handed to the kernel with submit() and
+collected one at a time with wait(). Not thread safe. On other platforms the ring
+never opens, so its users fall back to regular file access.
+*/
+class IoRing
+{
+public:
+	IoRing( unsigned entries );
+	~IoRing();
+
+	bool isOpen() const { return mFd >= 0; }
+
+	// Returns false if the ring is full, wait for a request to complete before trying again
+	bool push( UringRequest *request );
+	bool submit();
+
+	// Returns the next completed request, or NULL if nothing is left to wait for
+	UringRequest *wait( bool &success );
+
+private:
+	int mFd;
+	char *mSqRing;
+	char *mCqRing;
+	void *mSqes;
+	size_t mSqRingSize;
+	size_t mCqRingSize;
+	size_t mSqesSize;
+	unsigned *mSqHead, *mSqTail, *mSqMask, *mSqArray;
+	unsigned *mCqHead, *mCqTail, *mCqMask;
+	void *mCqes;
+	unsigned mEntries;
+	unsigned mQueued;
+	unsigned mInFlight;
+};
+
+#ifdef __linux__
+
+IoRing::IoRing( unsigned entries ):
+	mFd( -1 ), mSqRing( NULL ), mCqRing( NULL ), mSqes( NULL ), mQueued( 0 ), mInFlight( 0 )
+{
+	io_uring_params params;
+	memset( &params, 0, sizeof( params ) );
+	int fd = (int)syscall( __NR_io_uring_setup, entries, &params );
+	if ( fd < 0 )
+		return;
+
+	mSqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+	mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+	mSqesSize = params.sq_entries * sizeof( io_uring_sqe );
+
+	void *sqRing = mmap( NULL, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+	void *cqRing = mmap( NULL, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING );
+	void *sqes = mmap( NULL, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+	if ( sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED )
+	{
+		if ( sqRing != MAP_FAILED ) munmap( sqRing, mSqRingSize );
+		if ( cqRing != MAP_FAILED ) munmap( cqRing, mCqRingSize );
+		if ( sqes != MAP_FAILED ) munmap( sqes, mSqesSize );
+		close( fd );
+		return;
+	}
+
+	mFd = fd;
+	mSqRing = (char*)sqRing;
+	mCqRing = (char*)cqRing;
+	mSqes = sqes;
+	mSqHead = (unsigned*)(mSqRing + params.sq_off.head);
+	mSqTail = (unsigned*)(mSqRing + params.sq_off.tail);
+	mSqMask = (unsigned*)(mSqRing + params.sq_off.ring_mask);
+	mSqArray = (unsigned*)(mSqRing + params.sq_off.array);
+	mCqHead = (unsigned*)(mCqRing + params.cq_off.head);
+	mCqTail = (unsigned*)(mCqRing + params.cq_off.tail);
+	mCqMask = (unsigned*)(mCqRing + params.cq_off.ring_mask);
+	mCqes = mCqRing + params.cq_off.cqes;
+	mEntries = params.sq_entries;
+}
+
+IoRing::~IoRing()
+{
+	if ( !isOpen() )
+		return;
+
+	munmap( mSqRing, mSqRingSize );
+	munmap( mCqRing, mCqRingSize );
+	munmap( mSqes, mSqesSize );
+	close( mFd );
+}
+
+bool IoRing::push( UringRequest *request )
+{
+	// Never have more requests outstanding than the completion queue can hold
+	if ( !isOpen() || mQueued + mInFlight >= mEntries )
+		return false;
+
+	unsigned tail = *mSqTail;
+	unsigned index = tail & *mSqMask;
+
+	request->vector.iov_base = request->buffer;
+	request->vector.iov_len = request->length;
+
+	io_uring_sqe *sqe = (io_uring_sqe*)mSqes + index;
+	memset( sqe, 0, sizeof( *sqe ) );
+	sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+	sqe->fd = request->file->fd;
+	sqe->addr = (uintptr_t)&request->vector;
+	sqe->len = 1;
+	sqe->off = request->offset;
+	sqe->user_data = (uintptr_t)request;
+
+	mSqArray[index] = index;
+	__atomic_store_n( mSqTail, tail + 1, __ATOMIC_RELEASE );
+	mQueued++;
+	return true;
+}
+
+bool IoRing::submit()
+{
+	while ( mQueued > 0 )
+	{
+		int numSubmitted = (int)syscall( __NR_io_uring_enter, mFd, mQueued, 0, 0, NULL, 0 );
+		if ( numSubmitted < 0 && errno == EINTR )
+			continue;
+		if ( numSubmitted <= 0 )
+			return false;
+
+		mQueued -= numSubmitted;
+		mInFlight += numSubmitted;
+	}
+
+	return true;
+}
+
+UringRequest *IoRing::wait( bool &success )
+{
+	if ( !isOpen() )
+		return NULL;
+
+	for (;;)
+	{
+		unsigned head = *mCqHead;
+		if ( head != __atomic_load_n( mCqTail, __ATOMIC_ACQUIRE ) )
+		{
+			io_uring_cqe *cqe = (io_uring_cqe*)mCqes + (head & *mCqMask);
+			UringRequest *request = (UringRequest*)(uintptr_t)cqe->user_data;
+			int result = cqe->res;
+			__atomic_store_n( mCqHead, head + 1, __ATOMIC_RELEASE );
+			mInFlight--;
+
+			// Carry on with the rest of the range after an interruption or a partial transfer
+			if ( result == -EINTR || result == -EAGAIN || (result > 0 && (size_t)result < request->length) )
+			{
+				if ( result > 0 )
+				{
+					request->buffer += result;
+					request->length -= result;
+					request->offset += result;
+				}
+
+				if ( push( request ) && submit() )
+					continue;
+
+				success = false;
+				return request;
+			}
+
+			// Reading nothing at all means the file shrank since it was opened
+			success = (result >= 0 && (size_t)result == request->length);
+			return request;
+		}
+
+		submit();
+		if ( mInFlight == 0 )
+			return NULL;
+
+		if ( syscall( __NR_io_uring_enter, mFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 ) < 0 && errno != EINTR )
+			return NULL;
+	}
+}
+
+static int openForReading( const string &path, size_t &size )
+{
+	int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( fd < 0 )
+		return -1;
+
+	struct stat info;
+	if ( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) )
+	{
+		close( fd );
+		return -1;
+	}
+
+	size = (size_t)info.st_size;
+	return fd;
+}
+
+static int openForWriting( const string &path )
+{
+	return open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+}
+
+static bool closeFile( int fd )
+{
+	return close( fd ) == 0;
+}
+
+#else
+
+IoRing::IoRing( unsigned ): mFd( -1 ) {}
+IoRing::~IoRing() {}
+bool IoRing::push( UringRequest * ) { return false; }
+bool IoRing::submit() { return false; }
+UringRequest *IoRing::wait( bool & ) { return NULL; }
+
+static int openForReading( const string &, size_t & ) { return -1; }
+static int openForWriting( const string & ) { return -1; }
+static bool closeFile( int ) { return true; }
+
+#endif
+
+// Waits for one request to complete and updates its file
+static bool collect( IoRing *ring )
+{
+	bool success = false;
+	UringRequest *request = ring->wait( success );
+	if ( !request )
+		return false;
+
+	request->file->pending--;
+	if ( !success )
+		request->file->failed = true;
+
+	delete request;
+	return true;
+}
+
+// Queues reads or writes covering the whole buffer of the file
+static void queueTransfers( IoRing *ring, UringFile *file, bool write )
+{
+	for ( size_t offset = 0; offset < file->data.size(); offset += CHUNK_SIZE )
+	{
+		UringRequest *request = new UringRequest;
+		request->file = file;
+		request->write = write;
+		request->buffer = &file->data[offset];
+		request->length = min( CHUNK_SIZE, file->data.size() - offset );
+		request->offset = offset;
+
+		// Make room by collecting completed requests while the ring is full
+		bool queued;
+		while ( !(queued = ring->push( request )) && collect( ring ) )
+			;
+
+		if ( !queued )
+		{
+			delete request;
+			file->failed = true;
+			break;
+		}
+
+		file->pending++;
+	}
+
+	ring->submit();
+}
+
+// Waits until all requests of the file have completed
+static bool waitFor( IoRing *ring, UringFile *file )
+{
+	while ( file->pending > 0 )
+	{
+		if ( !collect( ring ) )
+		{
+			file->failed = true;
+			break;
+		}
+	}
+
+	return !file->failed;
+}
+
+// Closes and deletes the file, returns false if it wasn't transferred completely
+static bool release( UringFile *file )
+{
+	bool success = !file->failed;
+	if ( file->fd >= 0 && !closeFile( file->fd ) )
+		success = false;
+
+	// Should the ring have broken down, the kernel may still use the buffer, so leave it be
+	if ( file->pending == 0 )
+		delete file;
+
+	return success;
+}
+
+UringInputSource::UringInputSource( const string &baseDir ):
+	mFallback( baseDir ), mBaseDir( baseDir ), mRing( new IoRing( RING_ENTRIES ) )
+{
+}
+
+UringInputSource::~UringInputSource()
+{
+	for ( FileMap::iterator iter = mFiles.begin(); iter != mFiles.end(); ++iter )
+	{
+		waitFor( mRing, iter->second );
+		release( iter->second );
+	}
+
+	delete mRing;
+}
+
+bool UringInputSource::isSupported()
+{
+	IoRing ring( 1 );
+	return ring.isOpen();
+}
+
+void UringInputSource::prefetch( const string &name )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if ( !mRing->isOpen() || mFiles.count( name ) )
+		return;
+
+	// Files that can't be opened are left to read(), which reports the failure
+	size_t size = 0;
+	int fd = openForReading( FileInputSource::resolvePath( mBaseDir, name ), size );
+	if ( fd < 0 )
+		return;
+
+	UringFile *file = new UringFile;
+	file->fd = fd;
+	file->data.resize( size );
+	file->pending = 0;
+	file->failed = false;
+	mFiles[name] = file;
+
+	queueTransfers( mRing, file, false );
+}
+
+bool UringInputSource::read( const string &name, string &data )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	FileMap::iterator iter = mFiles.find( name );
+	if ( iter == mFiles.end() )
+		return mFallback.read( name, data );
+
+	// Each prefetched file is handed out once, a second read goes to the disk again
+	UringFile *file = iter->second;
+	mFiles.erase( iter );
+
+	bool success = waitFor( mRing, file );
+	if ( success )
+		data.swap( file->data );
+
+	if ( !release( file ) || !success )
+		return mFallback.read( name, data );
+
+	return true;
+}
+
+UringOutputSink::UringOutputSink( const string &baseDir, size_t maxPending ):
+	mFallback( baseDir ), mBaseDir( baseDir ), mRing( new IoRing( RING_ENTRIES ) ),
+	mMaxPending( maxPending > 0 ? maxPending : 1 ), mFailed( false )
+{
+}
+
+UringOutputSink::~UringOutputSink()
+{
+	flush();
+	delete mRing;
+}
+
+void UringOutputSink::retire()
+{
+	for ( std::deque<UringFile*>::iterator iter = mFiles.begin(); iter != mFiles.end(); )
+	{
+		if ( (*iter)->pending > 0 )
+		{
+			++iter;
+			continue;
+		}
+
+		if ( !release( *iter ) )
+			mFailed = true;
+		iter = mFiles.erase( iter );
+	}
+}
+
+bool UringOutputSink::write( const string &name, const string &data )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if ( !mRing->isOpen() )
+		return mFallback.write( name, data );
+
+	retire();
+	while ( mFiles.size() >= mMaxPending && collect( mRing ) )
+		retire();
+
+	if ( mFailed )
+		return false;
+
+	int fd = openForWriting( FileInputSource::resolvePath( mBaseDir, name ) );
+	if ( fd < 0 )
+		return false;
+
+	UringFile *file = new UringFile;
+	file->fd = fd;
+	file->data = data;
+	file->pending = 0;
+	file->failed = false;
+	mFiles.push_back( file );
+
+	queueTransfers( mRing, file, true );
+	return true;
+}
+
+bool UringOutputSink::flush()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	for (;;)
+	{
+		retire();
+		if ( mFiles.empty() )
+			break;
+
+		if ( !collect( mRing ) )
+		{
+			// The ring broke down, whatever is left won't be written
+			for ( size_t i = 0; i < mFiles.size(); i++ )
+			{
+				mFiles[i]->failed = true;
+				release( mFiles[i] );
+			}
+			mFiles.clear();
+			mFailed = true;
+			break;
+		}
+	}
+
+	bool success = !mFailed;
+	mFailed = false;
+	return success;
+}
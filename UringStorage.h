@@ -0,0 +1,91 @@
+/*
+-------------------------------------------------------------------------------
+Copyright (c) 2009-2010 Nico de Poel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-------------------------------------------------------------------------------
+*/
+#ifndef __URINGSTORAGE_H__
+#define __URINGSTORAGE_H__
+
+#include "Storage.h"
+
+class IoRing;
+struct UringFile;
+
+/**
+Reads input files through a Linux io_uring. prefetch() opens the file and submits reads
+of its whole contents without waiting for them, so the kernel fetches the file while the
+previous mesh is being converted; read() then only waits for whatever hasn't arrived yet.
+Files that weren't prefetched or couldn't be read this way, and ranges of files, are read
+with a FileInputSource.
+Use isSupported() to find out whether the running kernel provides io_uring.
+*/
+class UringInputSource : public InputSource
+{
+public:
+	UringInputSource( const string &baseDir = "" );
+	~UringInputSource();
+
+	bool read( const string &name, string &data );
+	bool readRange( const string &name, size_t offset, size_t length, string &data ) { return mFallback.readRange( name, offset, length, data ); }
+	BlockReader getBlockReader( const string &name ) { return mFallback.getBlockReader( name ); }
+	void prefetch( const string &name );
+
+	static bool isSupported();
+
+private:
+	typedef map<string, UringFile*> FileMap;
+
+	FileInputSource mFallback;
+	string mBaseDir;
+	IoRing *mRing;
+	FileMap mFiles;
+	std::mutex mMutex;
+};
+
+/**
+Writes output files through a Linux io_uring. write() opens the file and submits the
+writes of its contents, after which the conversion carries on while the kernel writes
+the file. At most maxPending files are being written at once. Like BackgroundOutputSink,
+write() only fails if the file couldn't be created or an earlier file couldn't be written;
+flush() waits for every file and tells whether all of them were written.
+*/
+class UringOutputSink : public OutputSink
+{
+public:
+	UringOutputSink( const string &baseDir = "", size_t maxPending = 4 );
+	~UringOutputSink();
+
+	bool write( const string &name, const string &data );
+	bool flush();
+
+private:
+	void retire();
+
+	FileOutputSink mFallback;
+	string mBaseDir;
+	IoRing *mRing;
+	std::deque<UringFile*> mFiles;
+	size_t mMaxPending;
+	bool mFailed;
+	std::mutex mMutex;
+};
+
+#endif	// __URINGSTORAGE_H__
@@ -181,35 +181,53 @@ BuildFrameSkeleton (const struct joint_info_t *jointInfos,
 int
 ReadMD5Anim (const char *filename, struct md5_anim_t *anim)
 {
-  FILE *fp = NULL;
+  char *data;
+  size_t size;
+  int result;
+
+  if (!LoadMD5File (filename, &data, &size))
+    {
+      fprintf (stderr, "error: couldn't open \"%s\"!\n", filename);
+      return 0;
+    }
+
+  result = ReadMD5AnimBuffer (data, size, anim);
+  if (!result)
+    fprintf (stderr, "Error: bad animation version\n");
+
+  free (data);
+  return result;
+}
+
+/**
+ * Load an MD5 animation from a memory buffer.
+ */
+int
+ReadMD5AnimBuffer (const char *data, size_t size, struct md5_anim_t *anim)
+{
+  struct md5_stream_t stream;
   char buff[512];
   struct joint_info_t *jointInfos = NULL;
   struct baseframe_joint_t *baseFrame = NULL;
   float *animFrameData = NULL;
   int version;
-  int numAnimatedComponents;
+  int numAnimatedComponents = 0;
   int frame_index;
   int i;
 
-  fp = fopen (filename, "rb");
-  if (!fp)
-    {
-      fprintf (stderr, "error: couldn't open \"%s\"!\n", filename);
-      return 0;
-    }
+  stream.data = data;
+  stream.size = size;
+  stream.pos = 0;
 
-  while (!feof (fp))
-    {
-      /* Read whole line */
-      fgets (buff, sizeof (buff), fp);
+  memset (anim, 0, sizeof (struct md5_anim_t));
 
+  while (Stream_Gets (buff, sizeof (buff), &stream))
+    {
       if (sscanf (buff, " MD5Version %d", &version) == 1)
 	{
 	  if (version != 10)
 	    {
 	      /* Bad version */
-	      fprintf (stderr, "Error: bad animation version\n");
-	      fclose (fp);
 	      return 0;
 	    }
 	}
@@ -262,7 +280,7 @@ ReadMD5Anim (const char *filename, struct md5_anim_t *anim)
 	  for (i = 0; i < anim->num_joints; ++i)
 	    {
 	      /* Read whole line */
-	      fgets (buff, sizeof (buff), fp);
+	      Stream_Gets (buff, sizeof (buff), &stream);
 
 	      /* Read joint info */
 	      sscanf (buff, " %s %d %d %d", jointInfos[i].name, &jointInfos[i].parent,
@@ -274,7 +292,7 @@ ReadMD5Anim (const char *filename, struct md5_anim_t *anim)
 	  for (i = 0; i < anim->num_frames; ++i)
 	    {
 	      /* Read whole line */
-	      fgets (buff, sizeof (buff), fp);
+	      Stream_Gets (buff, sizeof (buff), &stream);
 
 	      /* Read bounding box */
 	      sscanf (buff, " ( %f %f %f ) ( %f %f %f )",
@@ -288,7 +306,7 @@ ReadMD5Anim (const char *filename, struct md5_anim_t *anim)
 	  for (i = 0; i < anim->num_joints; ++i)
 	    {
 	      /* Read whole line */
-	      fgets (buff, sizeof (buff), fp);
+	      Stream_Gets (buff, sizeof (buff), &stream);
 
 	      /* Read base frame joint */
 	      if (sscanf (buff, " ( %f %f %f ) ( %f %f %f )",
@@ -301,11 +319,12 @@ ReadMD5Anim (const char *filename, struct md5_anim_t *anim)
 		}
 	    }
 	}
-      else if (sscanf (buff, " frame %d", &frame_index) == 1)
+      else if ((sscanf (buff, " frame %d", &frame_index) == 1)
+	       && (frame_index >= 0) && (frame_index < anim->num_frames))
 	{
 	  /* Read frame data */
 	  for (i = 0; i < numAnimatedComponents; ++i)
-	    fscanf (fp, "%f", &animFrameData[i]);
+	    Stream_ReadFloat (&stream, &animFrameData[i]);
 
 	  /* Build frame skeleton from the collected data */
 	  BuildFrameSkeleton (jointInfos, baseFrame, animFrameData,
@@ -313,8 +332,6 @@ ReadMD5Anim (const char *filename, struct md5_anim_t *anim)
 	}
   }
 
-  fclose (fp);
-
   /* Free temporary data allocated */
   if (animFrameData)
     free (animFrameData);
@@ -358,6 +375,45 @@ FreeAnim (struct md5_anim_t *anim)
     }
 }
 
+/**
+ * Make a deep copy of an animation.  The copy has to be freed
+ * with FreeAnim() like any other animation.
+ */
+void
+CopyAnim (const struct md5_anim_t *in, struct md5_anim_t *out)
+{
+  int i, j;
+
+  memset (out, 0, sizeof (struct md5_anim_t));
+  out->num_frames = in->num_frames;
+  out->num_joints = in->num_joints;
+  out->frameRate = in->frameRate;
+
+  if (in->skelFrames)
+    {
+      out->skelFrames = (struct md5_joint_t **)
+	malloc (sizeof (struct md5_joint_t*) * in->num_frames);
+
+      for (i = 0; i < in->num_frames; ++i)
+	{
+	  out->skelFrames[i] = (struct md5_joint_t *)
+	    malloc (sizeof (struct md5_joint_t) * in->num_joints);
+
+	  for (j = 0; j < in->num_joints; ++j)
+	    out->skelFrames[i][j] = in->skelFrames[i][j];
+	}
+    }
+
+  if (in->bboxes)
+    {
+      out->bboxes = (struct md5_bbox_t *)
+	malloc (sizeof (struct md5_bbox_t) * in->num_frames);
+
+      for (i = 0; i < in->num_frames; ++i)
+	out->bboxes[i] = in->bboxes[i];
+    }
+}
+
 /**
  * Smoothly interpolate two skeletons
  */
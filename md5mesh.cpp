@@ -32,42 +32,152 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <ctype.h>
 
 #include "md5model.h"
 
 #pragma warning(disable:4996)
 
 /**
- * Load an MD5 model from file.
+ * Read a whole file into a newly allocated buffer.  The caller
+ * has to free the buffer.
  */
 int
-ReadMD5Model (const char *filename, struct md5_model_t *mdl)
+LoadMD5File (const char *filename, char **data, size_t *size)
 {
   FILE *fp;
-  char buff[512];
-  int version;
-  int curr_mesh = 0;
-  int i;
+  long length;
 
   fp = fopen (filename, "rb");
   if (!fp)
+    return 0;
+
+  fseek (fp, 0, SEEK_END);
+  length = ftell (fp);
+  fseek (fp, 0, SEEK_SET);
+
+  if (length < 0)
     {
-      fprintf (stderr, "Error: couldn't open \"%s\"!\n", filename);
+      fclose (fp);
       return 0;
     }
 
-  while (!feof (fp))
+  *data = (char *)malloc (length + 1);
+  *size = fread (*data, 1, length, fp);
+  (*data)[*size] = '\0';
+
+  fclose (fp);
+  return 1;
+}
+
+/**
+ * fgets() for an in-memory stream.  Returns NULL when the end of
+ * the stream has been reached.
+ */
+char *
+Stream_Gets (char *buff, int len, struct md5_stream_t *stream)
+{
+  int i = 0;
+
+  if (stream->pos >= stream->size)
+    return NULL;
+
+  while ((i < len - 1) && (stream->pos < stream->size))
     {
-      /* Read whole line */
-      fgets (buff, sizeof (buff), fp);
+      char c = stream->data[stream->pos++];
+      buff[i++] = c;
+
+      if (c == '\n')
+	break;
+    }
+
+  buff[i] = '\0';
+  return buff;
+}
+
+/**
+ * feof() for an in-memory stream.
+ */
+int
+Stream_Eof (const struct md5_stream_t *stream)
+{
+  return (stream->pos >= stream->size);
+}
+
+/**
+ * fscanf (fp, "%f", f) for an in-memory stream.
+ */
+int
+Stream_ReadFloat (struct md5_stream_t *stream, float *f)
+{
+  char token[64];
+  int i = 0;
+
+  /* Skip leading white space */
+  while ((stream->pos < stream->size) && isspace ((unsigned char)stream->data[stream->pos]))
+    stream->pos++;
 
+  while ((i < (int)sizeof (token) - 1) && (stream->pos < stream->size)
+	 && !isspace ((unsigned char)stream->data[stream->pos]))
+    token[i++] = stream->data[stream->pos++];
+
+  token[i] = '\0';
+  if (i == 0)
+    return 0;
+
+  *f = (float)atof (token);
+  return 1;
+}
+
+/**
+ * Load an MD5 model from file.
+ */
+int
+ReadMD5Model (const char *filename, struct md5_model_t *mdl)
+{
+  char *data;
+  size_t size;
+  int result;
+
+  if (!LoadMD5File (filename, &data, &size))
+    {
+      fprintf (stderr, "Error: couldn't open \"%s\"!\n", filename);
+      return 0;
+    }
+
+  result = ReadMD5ModelBuffer (data, size, mdl);
+  if (!result)
+    fprintf (stderr, "Error: bad model version\n");
+
+  free (data);
+  return result;
+}
+
+/**
+ * Load an MD5 model from a memory buffer.
+ */
+int
+ReadMD5ModelBuffer (const char *data, size_t size, struct md5_model_t *mdl)
+{
+  struct md5_stream_t stream;
+  char buff[512];
+  int version;
+  int curr_mesh = 0;
+  int i;
+
+  stream.data = data;
+  stream.size = size;
+  stream.pos = 0;
+
+  memset (mdl, 0, sizeof (struct md5_model_t));
+
+  while (Stream_Gets (buff, sizeof (buff), &stream))
+    {
       if (sscanf (buff, " MD5Version %d", &version) == 1)
 	{
 	  if (version != 10)
 	    {
 	      /* Bad version */
-	      fprintf (stderr, "Error: bad model version\n");
-	      fclose (fp);
 	      return 0;
 	    }
 	}
@@ -97,7 +207,7 @@ ReadMD5Model (const char *filename, struct md5_model_t *mdl)
 	      struct md5_joint_t *joint = &mdl->baseSkel[i];
 
 	      /* Read whole line */
-	      fgets (buff, sizeof (buff), fp);
+	      Stream_Gets (buff, sizeof (buff), &stream);
 
 	      if (sscanf (buff, "%s %d ( %f %f %f ) ( %f %f %f )",
 			  joint->name, &joint->parent, &joint->pos[0],
@@ -109,7 +219,7 @@ ReadMD5Model (const char *filename, struct md5_model_t *mdl)
 		}
 	    }
 	}
-      else if (strncmp (buff, "mesh {", 6) == 0)
+      else if ((strncmp (buff, "mesh {", 6) == 0) && (curr_mesh < mdl->num_meshes))
 	{
 	  struct md5_mesh_t *mesh = &mdl->meshes[curr_mesh];
 	  int vert_index = 0;
@@ -118,10 +228,10 @@ ReadMD5Model (const char *filename, struct md5_model_t *mdl)
 	  float fdata[4];
 	  int idata[3];
 
-	  while ((buff[0] != '}') && !feof (fp))
+	  while ((buff[0] != '}') && !Stream_Eof (&stream))
 	    {
 	      /* Read whole line */
-	      fgets (buff, sizeof (buff), fp);
+	      Stream_Gets (buff, sizeof (buff), &stream);
 
 	      if (strstr (buff, "shader "))
 		{
@@ -203,8 +313,6 @@ ReadMD5Model (const char *filename, struct md5_model_t *mdl)
 	}
     }
 
-  fclose (fp);
-
   return 1;
 }
 
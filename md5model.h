@@ -109,6 +109,14 @@ struct md5_anim_t
   struct md5_bbox_t *bboxes;
 };
 
+/* In-memory text stream the parsers read from */
+struct md5_stream_t
+{
+  const char *data;
+  size_t size;
+  size_t pos;
+};
+
 /* Animation info */
 struct anim_info_t
 {
@@ -123,6 +131,8 @@ struct anim_info_t
  * md5mesh prototypes
  */
 int ReadMD5Model (const char *filename, struct md5_model_t *mdl);
+int ReadMD5ModelBuffer (const char *data, size_t size,
+			struct md5_model_t *mdl);
 void FreeModel (struct md5_model_t *mdl);
 void PrepareMesh (struct md5_mesh_t *mesh,
 		  const struct md5_joint_t *skeleton);
@@ -135,7 +145,10 @@ void FreeVertexArrays ();
 int CheckAnimValidity (const struct md5_model_t *mdl,
 		       const struct md5_anim_t *anim);
 int ReadMD5Anim (const char *filename, struct md5_anim_t *anim);
+int ReadMD5AnimBuffer (const char *data, size_t size,
+		       struct md5_anim_t *anim);
 void FreeAnim (struct md5_anim_t *anim);
+void CopyAnim (const struct md5_anim_t *in, struct md5_anim_t *out);
 void InterpolateSkeletons (const struct md5_joint_t *skelA,
 			   const struct md5_joint_t *skelB,
 			   int num_joints, float interp,
@@ -143,7 +156,11 @@ void InterpolateSkeletons (const struct md5_joint_t *skelA,
 void Animate (const struct md5_anim_t *anim,
 	      struct anim_info_t *animInfo, double dt);
 
-// Utility function
+// Utility functions
 void Quat_computeW (Quaternion &q);
+int LoadMD5File (const char *filename, char **data, size_t *size);
+char *Stream_Gets (char *buff, int len, struct md5_stream_t *stream);
+int Stream_Eof (const struct md5_stream_t *stream);
+int Stream_ReadFloat (struct md5_stream_t *stream, float *f);
 
 #endif /* __MD5MODEL_H__ */
@@ -47,6 +47,11 @@ public:
 		return out;
 	}
 
+	float dotProduct( const Vector3 &other ) const
+	{
+		return x * other.x + y * other.y + z * other.z;
+	}
+
 	float normalise();
 
 	float operator[]( const size_t i ) const